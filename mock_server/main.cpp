@@ -0,0 +1,115 @@
+#include "mock_server.h"
+
+#include <polymer/memory.h>
+#include <polymer/platform/args.h>
+#include <polymer/platform/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+namespace polymer {
+
+Platform g_Platform;
+
+static u8* MockAllocate(size_t size) {
+  return (u8*)malloc(size);
+}
+
+static void MockFree(u8* ptr) {
+  free(ptr);
+}
+
+static void PrintMockUsage() {
+  printf("Polymer mock server\n\n");
+  printf("Usage:\n\tpolymer_mock_server [OPTIONS]\n\n");
+  printf("OPTIONS:\n");
+  printf("\t--port\t\t\tPort to listen on. Default: 25565\n");
+  printf("\t--view-distance\t\tChunk radius sent around the player. Default: 12\n");
+  printf("\t--compression\t\tCompression threshold in bytes. Default: 256\n");
+  printf("\t--no-compression\tSend packets uncompressed.\n");
+  printf("\t--chunk-rate\t\tMaximum chunks sent per second. Default: the rate the client requests\n");
+  printf("\t--section-updates\tUpdateSectionBlocks packets per second. Default: 0\n");
+  printf("\t--section-size\t\tBlocks changed by each UpdateSectionBlocks. Default: 64\n");
+  printf("\t--block-updates\t\tBlockUpdate packets per second. Default: 0\n");
+  printf("\t--players\t\tFake players added to the player list. Default: 0\n");
+  printf("\t--player-updates\tPlayer latency updates per second. Default: 0\n");
+  printf("\t--seed\t\t\tTerrain seed. Default: 1\n");
+  printf("\t--variety\t\tDistinct underground blocks, which controls palette widths. Default: 4\n");
+}
+
+static bool GetArgInt(const ArgParser& args, const char* name, s32* value) {
+  String str = args.GetValue(String((char*)name));
+
+  if (str.size == 0) return false;
+
+  *value = (s32)strtol(str.data, nullptr, 10);
+  return true;
+}
+
+static bool GetArgFloat(const ArgParser& args, const char* name, float* value) {
+  String str = args.GetValue(String((char*)name));
+
+  if (str.size == 0) return false;
+
+  *value = strtof(str.data, nullptr);
+  return true;
+}
+
+} // namespace polymer
+
+int main(int argc, char* argv[]) {
+  using namespace polymer;
+  using namespace polymer::mock;
+
+  g_Platform.Allocate = MockAllocate;
+  g_Platform.Free = MockFree;
+
+  ArgParser args = ArgParser::Parse(argc, argv);
+
+  if (args.HasValue(POLY_STR("help")) || args.HasValue(POLY_STR("h"))) {
+    PrintMockUsage();
+    return 0;
+  }
+
+  MockServerConfig config;
+  s32 value = 0;
+
+  if (GetArgInt(args, "port", &value)) config.port = (u16)value;
+  if (GetArgInt(args, "view-distance", &value)) config.view_distance = value;
+  if (GetArgInt(args, "compression", &value)) config.compression_threshold = value;
+  if (args.HasValue(POLY_STR("no-compression"))) config.compression_threshold = -1;
+  if (GetArgInt(args, "section-size", &value)) config.section_update_size = (u32)value;
+  if (GetArgInt(args, "players", &value)) config.player_count = (u32)value;
+  if (GetArgInt(args, "seed", &value)) config.seed = (u32)value;
+  if (GetArgInt(args, "variety", &value)) config.block_variety = (u32)value;
+
+  GetArgFloat(args, "chunk-rate", &config.chunk_rate);
+  GetArgFloat(args, "section-updates", &config.section_update_rate);
+  GetArgFloat(args, "block-updates", &config.block_update_rate);
+  GetArgFloat(args, "player-updates", &config.player_update_rate);
+
+#ifdef _WIN32
+  WSADATA wsa;
+
+  if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+    fprintf(stderr, "Failed to initialize WinSock.\n");
+    return 1;
+  }
+#endif
+
+  MemoryArena arena = CreateArena(Megabytes(16));
+  MockServer* server = arena.Construct<MockServer>(arena, config);
+
+  if (!server->Listen()) {
+    return 1;
+  }
+
+  server->Run();
+
+  return 0;
+}
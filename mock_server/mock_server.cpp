@@ -0,0 +1,796 @@
+#include "mock_server.h"
+
+#include <lib/miniz.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <WS2tcpip.h>
+#include <Windows.h>
+#define POLY_EWOULDBLOCK WSAEWOULDBLOCK
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define closesocket close
+#define POLY_EWOULDBLOCK EWOULDBLOCK
+#endif
+
+namespace polymer {
+namespace mock {
+
+constexpr size_t kBufferSize = 65536 * 64;
+constexpr size_t kInflateBufferSize = Megabytes(2);
+// Large enough for a full ChunkData packet with light.
+constexpr size_t kMaxPacketSize = Kilobytes(512);
+
+constexpr auto kTickTime = std::chrono::milliseconds(50);
+constexpr u64 kTicksPerSecond = 20;
+constexpr u64 kKeepAliveTicks = kTicksPerSecond * 10;
+
+// The vanilla server sends at most this many chunks in one batch.
+constexpr size_t kMaxBatchSize = 64;
+constexpr size_t kMaxUnacknowledgedBatches = 2;
+
+// Serverbound status packets aren't used by the client, so they don't have protocol ids.
+constexpr u64 kStatusRequestId = 0;
+constexpr u64 kStatusPingId = 1;
+
+enum PlayerInfoAction {
+  PlayerInfoAction_Add = (1 << 0),
+  PlayerInfoAction_Gamemode = (1 << 2),
+  PlayerInfoAction_Listed = (1 << 3),
+  PlayerInfoAction_Latency = (1 << 4),
+};
+
+static int GetLastErrorCode() {
+#ifdef _WIN32
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+static void SetNonBlocking(SocketType fd) {
+#ifdef _WIN32
+  unsigned long mode = 1;
+  ioctlsocket(fd, FIONBIO, &mode);
+#else
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+static inline s32 GetChunkCoord(double position) {
+  return (s32)floor(position / 16.0);
+}
+
+MockServer::MockServer(MemoryArena& arena, const MockServerConfig& config)
+    : arena(arena), config(config), terrain(arena, config.seed, config.block_variety),
+      read_buffer(AllocateMirroredBuffer(kBufferSize), kBufferSize),
+      write_buffer(AllocateMirroredBuffer(kBufferSize), kBufferSize), builder(arena, kMaxPacketSize) {
+  if (this->config.view_distance > kMaxViewDistance) this->config.view_distance = kMaxViewDistance;
+  if (this->config.view_distance < 2) this->config.view_distance = 2;
+  if (this->config.section_update_size < 1) this->config.section_update_size = 1;
+  if (this->config.section_update_size > 4096) this->config.section_update_size = 4096;
+
+  inflate_buffer = arena.Allocate(kInflateBufferSize);
+
+  random_state = config.seed * 0x9E3779B9u + 1;
+}
+
+bool MockServer::Listen() {
+  if (!read_buffer.data || !write_buffer.data || !inflate_buffer) {
+    fprintf(stderr, "Failed to allocate server buffers.\n");
+    return false;
+  }
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+  if (listen_fd < 0) {
+    fprintf(stderr, "Failed to create socket.\n");
+    return false;
+  }
+
+  int reuse = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+  sockaddr_in address = {};
+
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(config.port);
+
+  if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0) {
+    fprintf(stderr, "Failed to bind port %hu: %d\n", config.port, GetLastErrorCode());
+    return false;
+  }
+
+  if (listen(listen_fd, 1) != 0) {
+    fprintf(stderr, "Failed to listen on port %hu: %d\n", config.port, GetLastErrorCode());
+    return false;
+  }
+
+  printf("Mock server listening on port %hu.\n", config.port);
+  fflush(stdout);
+
+  return true;
+}
+
+void MockServer::Run() {
+  while (Accept()) {
+    Serve();
+  }
+}
+
+bool MockServer::Accept() {
+  client_fd = accept(listen_fd, nullptr, nullptr);
+
+  if (client_fd < 0) {
+    fprintf(stderr, "Failed to accept client: %d\n", GetLastErrorCode());
+    return false;
+  }
+
+  int no_delay = 1;
+  setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+
+  SetNonBlocking(client_fd);
+
+  printf("Client connected.\n");
+  fflush(stdout);
+
+  return true;
+}
+
+void MockServer::ResetSession() {
+  state = ProtocolState::Handshake;
+  compression = false;
+  connected = true;
+  view_distance = config.view_distance;
+
+  builder.SetCompressionThreshold(-1);
+  builder.buffer.read_offset = builder.buffer.write_offset = 0;
+
+  read_buffer.read_offset = read_buffer.write_offset = 0;
+  write_buffer.read_offset = write_buffer.write_offset = 0;
+
+  has_center = false;
+  loaded_count = 0;
+  pending_count = pending_index = 0;
+
+  client_chunk_rate = 9.0f;
+  unacknowledged_batches = 0;
+
+  chunk_budget = section_update_budget = block_update_budget = player_update_budget = 0.0f;
+  tick_count = 0;
+
+  stats = {};
+  stats_time = Clock::now();
+}
+
+void MockServer::Serve() {
+  ResetSession();
+
+  Clock::time_point next_tick = Clock::now();
+
+  while (connected) {
+    if (!Receive()) break;
+
+    Clock::time_point now = Clock::now();
+
+    if (now >= next_tick) {
+      if (state == ProtocolState::Play) {
+        Tick();
+      }
+
+      next_tick += kTickTime;
+
+      // Don't try to catch up on ticks that were missed while the server was stalled.
+      if (next_tick < now) next_tick = now + kTickTime;
+    }
+
+    if (!Flush()) break;
+
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(next_tick - Clock::now()).count();
+    if (wait < 0) wait = 0;
+
+    fd_set read_set;
+    fd_set write_set;
+
+    FD_ZERO(&read_set);
+    FD_ZERO(&write_set);
+    FD_SET(client_fd, &read_set);
+
+    if (write_buffer.read_offset != write_buffer.write_offset) {
+      FD_SET(client_fd, &write_set);
+    }
+
+    timeval timeout = {(long)(wait / 1000000), (long)(wait % 1000000)};
+
+    select((int)client_fd + 1, &read_set, &write_set, nullptr, &timeout);
+  }
+
+  closesocket(client_fd);
+  client_fd = -1;
+
+  printf("Client disconnected.\n");
+  fflush(stdout);
+}
+
+bool MockServer::Receive() {
+  RingBuffer* rb = &read_buffer;
+
+  while (true) {
+    size_t used_size = (rb->write_offset + rb->size - rb->read_offset) % rb->size;
+    size_t free_size = rb->size - used_size - 1;
+
+    if (free_size == 0) break;
+
+    // The read buffer is mirrored, so it's free to receive past the end of the buffer.
+    int bytes_recv = recv(client_fd, (char*)rb->data + rb->write_offset, (int)free_size, 0);
+
+    if (bytes_recv == 0) {
+      return false;
+    } else if (bytes_recv < 0) {
+      int err = GetLastErrorCode();
+
+      if (err == POLY_EWOULDBLOCK) break;
+
+      fprintf(stderr, "Unexpected socket error: %d\n", err);
+      return false;
+    }
+
+    rb->write_offset = (rb->write_offset + bytes_recv) % rb->size;
+  }
+
+  return FramePackets();
+}
+
+bool MockServer::FramePackets() {
+  RingBuffer* rb = &read_buffer;
+
+  while (connected && rb->read_offset != rb->write_offset) {
+    size_t offset_snapshot = rb->read_offset;
+    u64 pkt_size = 0;
+
+    if (!rb->ReadVarInt(&pkt_size) || rb->GetReadAmount() < pkt_size) {
+      rb->read_offset = offset_snapshot;
+      break;
+    }
+
+    size_t target_offset = (rb->read_offset + (size_t)pkt_size) % rb->size;
+
+    // The read buffer is mirrored, so the packet can be read without wrapping.
+    RingBuffer packet(rb->data + rb->read_offset, rb->size);
+
+    packet.write_offset = (size_t)pkt_size;
+
+    if (compression) {
+      u64 data_size = 0;
+
+      if (!packet.ReadVarInt(&data_size)) return false;
+
+      if (data_size > 0) {
+        mz_ulong inflated_size = kInflateBufferSize;
+        int result = mz_uncompress(inflate_buffer, &inflated_size, packet.data + packet.read_offset,
+                                   (mz_ulong)(packet.write_offset - packet.read_offset));
+
+        if (result != MZ_OK) {
+          fprintf(stderr, "Failed to inflate client packet.\n");
+          return false;
+        }
+
+        packet = RingBuffer(inflate_buffer, kInflateBufferSize);
+        packet.write_offset = inflated_size;
+      }
+    }
+
+    HandlePacket(packet);
+
+    rb->read_offset = target_offset;
+  }
+
+  return connected;
+}
+
+void MockServer::HandlePacket(RingBuffer& rb) {
+  u64 pkt_id = 0;
+
+  if (!rb.ReadVarInt(&pkt_id)) return;
+
+  switch (state) {
+  case ProtocolState::Handshake:
+    HandleHandshake(rb, pkt_id);
+    break;
+  case ProtocolState::Status:
+    HandleStatus(rb, pkt_id);
+    break;
+  case ProtocolState::Login:
+    HandleLogin(rb, pkt_id);
+    break;
+  case ProtocolState::Configuration:
+    HandleConfiguration(rb, pkt_id);
+    break;
+  case ProtocolState::Play:
+    HandlePlay(rb, pkt_id);
+    break;
+  }
+}
+
+void MockServer::HandleHandshake(RingBuffer& rb, u64 pkt_id) {
+  if (pkt_id != (u64)outbound::handshake::ProtocolId::Handshake) return;
+
+  u64 version = 0;
+  rb.ReadVarInt(&version);
+
+  // Server address and port.
+  rb.ReadStringView();
+  rb.ReadU16();
+
+  u64 next_state = 0;
+  rb.ReadVarInt(&next_state);
+
+  // Transfers are treated like a normal login.
+  state = next_state == 1 ? ProtocolState::Status : ProtocolState::Login;
+
+  if (version != kProtocolVersion) {
+    printf("Client is using protocol %u instead of %u.\n", (u32)version, kProtocolVersion);
+  }
+}
+
+void MockServer::HandleStatus(RingBuffer& rb, u64 pkt_id) {
+  if (pkt_id == kStatusRequestId) {
+    char response[512];
+    int length = snprintf(response, sizeof(response),
+                          "{\"version\":{\"name\":\"1.21.4\",\"protocol\":%u},\"players\":{\"max\":%u,\"online\":%u},"
+                          "\"description\":{\"text\":\"Polymer mock server\"}}",
+                          kProtocolVersion, config.player_count + 1, config.player_count);
+
+    builder.WriteString(response, (size_t)length);
+    Send((u32)inbound::status::ProtocolId::Response);
+  } else if (pkt_id == kStatusPingId) {
+    builder.WriteU64(rb.ReadU64());
+    Send((u32)inbound::status::ProtocolId::Pong);
+  }
+}
+
+void MockServer::HandleLogin(RingBuffer& rb, u64 pkt_id) {
+  using outbound::login::ProtocolId;
+
+  switch ((ProtocolId)pkt_id) {
+  case ProtocolId::LoginStart: {
+    String username = rb.ReadStringView();
+    String uuid = rb.ReadRawStringView(16);
+
+    if (username.size == 0 || uuid.size != 16) {
+      connected = false;
+      break;
+    }
+
+    printf("Logging in '%.*s'.\n", (int)username.size, username.data);
+
+    if (config.compression_threshold >= 0) {
+      builder.WriteVarInt(config.compression_threshold);
+      Send((u32)inbound::login::ProtocolId::SetCompression);
+
+      // The client only sends packets in response to ours, so everything it sends from here on is compressed.
+      builder.SetCompressionThreshold(config.compression_threshold);
+      compression = true;
+    }
+
+    builder.WriteRawString(uuid);
+    builder.WriteString(username);
+    builder.WriteVarInt(0); // Properties
+    Send((u32)inbound::login::ProtocolId::LoginSuccess);
+  } break;
+  case ProtocolId::LoginAcknowledged: {
+    state = ProtocolState::Configuration;
+
+    builder.WriteVarInt(1);
+    builder.WriteString(POLY_STR("minecraft"));
+    builder.WriteString(POLY_STR("core"));
+    builder.WriteString(POLY_STR("1.21.4"));
+    Send((u32)inbound::configuration::ProtocolId::KnownPacks);
+  } break;
+  default:
+    break;
+  }
+}
+
+void MockServer::HandleConfiguration(RingBuffer& rb, u64 pkt_id) {
+  using outbound::configuration::ProtocolId;
+
+  switch ((ProtocolId)pkt_id) {
+  case ProtocolId::ClientInformation: {
+    rb.ReadStringView(); // Locale
+    u8 client_view_distance = rb.ReadU8();
+
+    // Like vanilla, the view distance is the smaller of the server's and the client's.
+    if (client_view_distance >= 2 && client_view_distance < view_distance) {
+      view_distance = client_view_distance;
+    }
+  } break;
+  case ProtocolId::KnownPacks: {
+    // The client fills in every core dimension type that is sent without data.
+    builder.WriteString(POLY_STR("minecraft:dimension_type"));
+    builder.WriteVarInt(1);
+    builder.WriteString(POLY_STR("minecraft:overworld"));
+    builder.WriteU8(0);
+    Send((u32)inbound::configuration::ProtocolId::RegistryData);
+
+    Send((u32)inbound::configuration::ProtocolId::Finish);
+  } break;
+  case ProtocolId::AcknowledgeFinish: {
+    state = ProtocolState::Play;
+    StartPlay();
+  } break;
+  default:
+    break;
+  }
+}
+
+void MockServer::HandlePlay(RingBuffer& rb, u64 pkt_id) {
+  using outbound::play::ProtocolId;
+
+  switch ((ProtocolId)pkt_id) {
+  case ProtocolId::ChunkBatchReceived: {
+    float chunks_per_tick = rb.ReadFloat();
+
+    // Same limits as vanilla.
+    if (!(chunks_per_tick >= 0.01f)) chunks_per_tick = 0.01f;
+    if (chunks_per_tick > 64.0f) chunks_per_tick = 64.0f;
+
+    client_chunk_rate = chunks_per_tick;
+
+    if (unacknowledged_batches > 0) --unacknowledged_batches;
+  } break;
+  case ProtocolId::PlayPositionAndRotation: {
+    double x = rb.ReadDouble();
+    rb.ReadDouble();
+    double z = rb.ReadDouble();
+
+    SetCenter(GetChunkCoord(x), GetChunkCoord(z));
+  } break;
+  default:
+    break;
+  }
+}
+
+void MockServer::Send(u32 pkt_id) {
+  builder.Commit(write_buffer, pkt_id);
+}
+
+size_t MockServer::GetWriteBufferFreeSize() const {
+  size_t used_size = (write_buffer.write_offset + write_buffer.size - write_buffer.read_offset) % write_buffer.size;
+
+  return write_buffer.size - used_size - 1;
+}
+
+bool MockServer::Flush() {
+  RingBuffer* wb = &write_buffer;
+
+  while (wb->read_offset != wb->write_offset) {
+    // The write buffer is mirrored, so the pending data is always contiguous.
+    size_t pending = (wb->write_offset + wb->size - wb->read_offset) % wb->size;
+    int bytes_sent = send(client_fd, (char*)wb->data + wb->read_offset, (int)pending, 0);
+
+    if (bytes_sent < 0) {
+      int err = GetLastErrorCode();
+
+      if (err == POLY_EWOULDBLOCK) break;
+
+      fprintf(stderr, "Unexpected socket error: %d\n", err);
+      return false;
+    }
+
+    wb->read_offset = (wb->read_offset + bytes_sent) % wb->size;
+    stats.bytes += bytes_sent;
+  }
+
+  return true;
+}
+
+void MockServer::StartPlay() {
+  using inbound::play::ProtocolId;
+
+  builder.WriteU32(1); // Entity id
+  builder.WriteU8(0);  // Hardcore
+  builder.WriteVarInt(1);
+  builder.WriteString(POLY_STR("minecraft:overworld"));
+  builder.WriteVarInt(config.player_count + 1);
+  builder.WriteVarInt(view_distance);
+  builder.WriteVarInt(view_distance); // Simulation distance
+  builder.WriteU8(0);                 // Reduced debug info
+  builder.WriteU8(1);                 // Respawn screen
+  builder.WriteU8(0);                 // Limited crafting
+  builder.WriteVarInt(0);             // Dimension type
+  builder.WriteString(POLY_STR("minecraft:overworld"));
+  builder.WriteU64(0);    // Hashed seed
+  builder.WriteU8(3);     // Spectator so the client can fly around and load chunks.
+  builder.WriteU8(0xFF);  // Previous gamemode
+  builder.WriteU8(0);     // Debug
+  builder.WriteU8(0);     // Flat
+  builder.WriteU8(0);     // Death location
+  builder.WriteVarInt(0); // Portal cooldown
+  builder.WriteVarInt(63);
+  builder.WriteU8(0); // Enforces secure chat
+  Send((u32)ProtocolId::Login);
+
+  if (config.player_count > 0) {
+    SendPlayerInfo(PlayerInfoAction_Add | PlayerInfoAction_Gamemode | PlayerInfoAction_Listed |
+                       PlayerInfoAction_Latency,
+                   0, config.player_count);
+  }
+
+  // Start waiting for level chunks.
+  builder.WriteU8(13);
+  builder.WriteFloat(0.0f);
+  Send((u32)ProtocolId::GameEvent);
+
+  SetCenter(0, 0);
+
+  builder.WriteVarInt(1); // Teleport id
+  builder.WriteDouble(8.5);
+  builder.WriteDouble(terrain.GetHeight(8, 8) + 2.0);
+  builder.WriteDouble(8.5);
+  builder.WriteDouble(0.0);
+  builder.WriteDouble(0.0);
+  builder.WriteDouble(0.0);
+  builder.WriteFloat(0.0f);
+  builder.WriteFloat(0.0f);
+  builder.WriteU32(0); // Absolute position
+  Send((u32)ProtocolId::PlayerPositionAndLook);
+
+  stats = {};
+  stats_time = Clock::now();
+
+  printf("Client entered play with a view distance of %d.\n", view_distance);
+  fflush(stdout);
+}
+
+void MockServer::Tick() {
+  ++tick_count;
+
+  if (tick_count % kKeepAliveTicks == 0) {
+    builder.WriteU64(tick_count);
+    Send((u32)inbound::play::ProtocolId::KeepAlive);
+  }
+
+  if (pending_index < pending_count && unacknowledged_batches < kMaxUnacknowledgedBatches) {
+    float rate = client_chunk_rate;
+
+    if (config.chunk_rate > 0.0f && config.chunk_rate / kTicksPerSecond < rate) {
+      rate = config.chunk_rate / kTicksPerSecond;
+    }
+
+    chunk_budget += rate;
+    if (chunk_budget > kMaxBatchSize) chunk_budget = kMaxBatchSize;
+
+    size_t count = (size_t)chunk_budget;
+
+    if (count > 0) {
+      chunk_budget -= count;
+      SendChunkBatch(count);
+    }
+  }
+
+  // Updates are only sent for chunks the client has, and they stop while the socket is backed up.
+  constexpr size_t kUpdateSpace = Kilobytes(64);
+
+  if (loaded_count > 0) {
+    section_update_budget += config.section_update_rate / kTicksPerSecond;
+    block_update_budget += config.block_update_rate / kTicksPerSecond;
+
+    while (section_update_budget >= 1.0f && GetWriteBufferFreeSize() > kUpdateSpace) {
+      SendSectionUpdate();
+      section_update_budget -= 1.0f;
+    }
+
+    while (block_update_budget >= 1.0f && GetWriteBufferFreeSize() > kUpdateSpace) {
+      SendBlockUpdate();
+      block_update_budget -= 1.0f;
+    }
+  }
+
+  if (config.player_count > 0) {
+    player_update_budget += config.player_update_rate / kTicksPerSecond;
+
+    while (player_update_budget >= 1.0f && GetWriteBufferFreeSize() > kUpdateSpace) {
+      SendPlayerInfo(PlayerInfoAction_Latency, Random() % config.player_count, 1);
+      player_update_budget -= 1.0f;
+    }
+  }
+
+  if (Clock::now() - stats_time >= std::chrono::seconds(1)) {
+    PrintStats();
+  }
+}
+
+void MockServer::SendChunkBatch(size_t count) {
+  using inbound::play::ProtocolId;
+
+  Send((u32)ProtocolId::ChunkBatchStart);
+
+  size_t sent = 0;
+
+  while (sent < count && pending_index < pending_count && GetWriteBufferFreeSize() > kMaxPacketSize) {
+    ChunkCoord coord = pending[pending_index++];
+
+    terrain.WriteChunkData(builder, coord.x, coord.z);
+    Send((u32)ProtocolId::ChunkData);
+
+    loaded[loaded_count++] = coord;
+    ++sent;
+  }
+
+  builder.WriteVarInt(sent);
+  Send((u32)ProtocolId::ChunkBatchFinished);
+
+  ++unacknowledged_batches;
+  stats.chunks += sent;
+}
+
+void MockServer::SendSectionUpdate() {
+  ChunkCoord coord = loaded[Random() % loaded_count];
+
+  // Edit around the surface where the client is most likely to be meshing.
+  s32 surface_y = terrain.GetHeight(coord.x * 16 + 8, coord.z * 16 + 8);
+  s32 section_y = (surface_y >> 4) + (s32)(Random() % 3) - 1;
+
+  u64 position = (((u64)coord.x & 0x3FFFFF) << 42) | (((u64)coord.z & 0x3FFFFF) << 20) | ((u64)section_y & 0xFFFFF);
+
+  builder.WriteU64(position);
+  builder.WriteVarInt(config.section_update_size);
+
+  for (u32 i = 0; i < config.section_update_size; ++i) {
+    u32 index = Random() & 0xFFF;
+    u32 bid = (Random() & 1) ? kAirId : kStoneId + Random() % terrain.block_variety;
+
+    // The record index is packed as x, z, y while the block index is y, z, x.
+    u64 record = ((u64)bid << 12) | ((index & 0x0F) << 8) | (((index >> 4) & 0x0F) << 4) | (index >> 8);
+
+    builder.WriteVarInt(record);
+  }
+
+  Send((u32)inbound::play::ProtocolId::UpdateSectionBlocks);
+
+  ++stats.section_updates;
+}
+
+void MockServer::SendBlockUpdate() {
+  ChunkCoord coord = loaded[Random() % loaded_count];
+
+  s32 x = coord.x * 16 + (s32)(Random() & 0x0F);
+  s32 z = coord.z * 16 + (s32)(Random() & 0x0F);
+  s32 y = terrain.GetHeight(x, z) + 1 - (s32)(Random() % 3);
+
+  u32 bid = (Random() & 1) ? kAirId : kStoneId + Random() % terrain.block_variety;
+  u64 position = (((u64)x & 0x3FFFFFF) << 38) | (((u64)z & 0x3FFFFFF) << 12) | ((u64)y & 0xFFF);
+
+  builder.WriteU64(position);
+  builder.WriteVarInt(bid);
+  Send((u32)inbound::play::ProtocolId::BlockUpdate);
+
+  ++stats.block_updates;
+}
+
+void MockServer::SendPlayerInfo(u8 actions, u32 first_player, u32 count) {
+  builder.WriteU8(actions);
+  builder.WriteVarInt(count);
+
+  for (u32 i = first_player; i < first_player + count; ++i) {
+    // Fake version 4 uuids that are unique per player.
+    builder.WriteU64(0x504F4C594D455240ULL);
+    builder.WriteU64(0x8000000000000000ULL | i);
+
+    if (actions & PlayerInfoAction_Add) {
+      char name[16];
+      int length = snprintf(name, sizeof(name), "player%u", i);
+
+      builder.WriteString(name, (size_t)length);
+      builder.WriteVarInt(0); // Properties
+    }
+
+    if (actions & PlayerInfoAction_Gamemode) {
+      builder.WriteVarInt(0);
+    }
+
+    if (actions & PlayerInfoAction_Listed) {
+      builder.WriteU8(1);
+    }
+
+    if (actions & PlayerInfoAction_Latency) {
+      builder.WriteVarInt(Random() % 300);
+    }
+  }
+
+  Send((u32)inbound::play::ProtocolId::PlayerInfoUpdate);
+
+  stats.player_updates += count;
+}
+
+void MockServer::SetCenter(s32 chunk_x, s32 chunk_z) {
+  if (has_center && chunk_x == center_x && chunk_z == center_z) return;
+
+  has_center = true;
+  center_x = chunk_x;
+  center_z = chunk_z;
+
+  builder.WriteVarInt((u32)chunk_x);
+  builder.WriteVarInt((u32)chunk_z);
+  Send((u32)inbound::play::ProtocolId::SetCenterChunk);
+
+  s32 distance = view_distance;
+  s32 width = distance * 2 + 1;
+  // Chunks that the client already has around the new center, indexed relative to the view.
+  bool present[kMaxTrackedChunks] = {};
+
+  size_t kept_count = 0;
+
+  for (size_t i = 0; i < loaded_count; ++i) {
+    ChunkCoord coord = loaded[i];
+    s32 dx = coord.x - chunk_x;
+    s32 dz = coord.z - chunk_z;
+
+    if (dx < -distance || dx > distance || dz < -distance || dz > distance) {
+      builder.WriteU32((u32)coord.z);
+      builder.WriteU32((u32)coord.x);
+      Send((u32)inbound::play::ProtocolId::UnloadChunk);
+      continue;
+    }
+
+    present[(dz + distance) * width + (dx + distance)] = true;
+    loaded[kept_count++] = coord;
+  }
+
+  loaded_count = kept_count;
+  pending_count = pending_index = 0;
+
+  // Queue everything that's missing in rings around the center so the nearest chunks are sent first.
+  for (s32 ring = 0; ring <= distance; ++ring) {
+    for (s32 dz = -ring; dz <= ring; ++dz) {
+      for (s32 dx = -ring; dx <= ring; ++dx) {
+        // Only visit the outline of the ring.
+        if (dz != -ring && dz != ring && dx != -ring && dx != ring) continue;
+        if (present[(dz + distance) * width + (dx + distance)]) continue;
+
+        pending[pending_count++] = ChunkCoord{chunk_x + dx, chunk_z + dz};
+      }
+    }
+  }
+}
+
+void MockServer::PrintStats() {
+  float elapsed = std::chrono::duration_cast<std::chrono::duration<float>>(Clock::now() - stats_time).count();
+
+  printf("chunks/s: %.1f section updates/s: %.1f block updates/s: %.1f player updates/s: %.1f sent: %.1f KB/s "
+         "loaded: %zu pending: %zu\n",
+         stats.chunks / elapsed, stats.section_updates / elapsed, stats.block_updates / elapsed,
+         stats.player_updates / elapsed, stats.bytes / elapsed / 1024.0f, loaded_count, pending_count - pending_index);
+  fflush(stdout);
+
+  stats = {};
+  stats_time = Clock::now();
+}
+
+u32 MockServer::Random() {
+  // xorshift32
+  u32 x = random_state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  random_state = x;
+  return x;
+}
+
+} // namespace mock
+} // namespace polymer
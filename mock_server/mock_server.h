@@ -0,0 +1,153 @@
+#ifndef POLYMER_MOCK_SERVER_MOCK_SERVER_H_
+#define POLYMER_MOCK_SERVER_MOCK_SERVER_H_
+
+#include "terrain.h"
+
+#include <polymer/buffer.h>
+#include <polymer/memory.h>
+#include <polymer/packet_builder.h>
+#include <polymer/protocol.h>
+#include <polymer/types.h>
+
+#include <chrono>
+
+namespace polymer {
+namespace mock {
+
+#ifdef _WIN64
+using SocketType = long long;
+#else
+using SocketType = int;
+#endif
+
+constexpr s32 kMaxViewDistance = 32;
+constexpr size_t kMaxTrackedChunks = (kMaxViewDistance * 2 + 1) * (kMaxViewDistance * 2 + 1);
+
+struct MockServerConfig {
+  u16 port = 25565;
+  s32 view_distance = 12;
+  // Negative disables compression.
+  s32 compression_threshold = 256;
+
+  // Upper limit on chunks sent per second. Zero leaves it up to the rate the client asks for.
+  float chunk_rate = 0.0f;
+
+  // UpdateSectionBlocks packets per second and the block count in each one.
+  float section_update_rate = 0.0f;
+  u32 section_update_size = 64;
+  // BlockUpdate packets per second.
+  float block_update_rate = 0.0f;
+
+  // Fake players that get added to the tab list, and latency updates per second for them.
+  u32 player_count = 0;
+  float player_update_rate = 0.0f;
+
+  u32 seed = 1;
+  u32 block_variety = 4;
+};
+
+struct ChunkCoord {
+  s32 x;
+  s32 z;
+};
+
+// Serves one client at a time with a generated world. It speaks just enough of the protocol to get the client through
+// login and configuration and into play, then streams chunks and updates at the configured rates.
+struct MockServer {
+  MockServer(MemoryArena& arena, const MockServerConfig& config);
+
+  bool Listen();
+  // Accepts and serves clients until the listen socket fails.
+  void Run();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  bool Accept();
+  void Serve();
+  void ResetSession();
+
+  bool Receive();
+  bool Flush();
+  bool FramePackets();
+  void HandlePacket(RingBuffer& rb);
+  void HandleHandshake(RingBuffer& rb, u64 pkt_id);
+  void HandleStatus(RingBuffer& rb, u64 pkt_id);
+  void HandleLogin(RingBuffer& rb, u64 pkt_id);
+  void HandleConfiguration(RingBuffer& rb, u64 pkt_id);
+  void HandlePlay(RingBuffer& rb, u64 pkt_id);
+
+  void Send(u32 pkt_id);
+  size_t GetWriteBufferFreeSize() const;
+
+  void StartPlay();
+  void Tick();
+  void SendChunkBatch(size_t count);
+  void SendSectionUpdate();
+  void SendBlockUpdate();
+  void SendPlayerInfo(u8 actions, u32 first_player, u32 count);
+  void SetCenter(s32 chunk_x, s32 chunk_z);
+  void PrintStats();
+
+  u32 Random();
+
+  MemoryArena& arena;
+  MockServerConfig config;
+  TerrainGenerator terrain;
+
+  SocketType listen_fd = -1;
+  SocketType client_fd = -1;
+
+  RingBuffer read_buffer;
+  RingBuffer write_buffer;
+  PacketBuilder builder;
+  // Inbound packets are inflated into this when the client compresses them.
+  u8* inflate_buffer;
+
+  ProtocolState state = ProtocolState::Handshake;
+  bool compression = false;
+  bool connected = false;
+
+  // The configured view distance lowered to the client's for this connection.
+  s32 view_distance = 0;
+
+  s32 center_x = 0;
+  s32 center_z = 0;
+  bool has_center = false;
+
+  ChunkCoord loaded[kMaxTrackedChunks];
+  size_t loaded_count = 0;
+  // Chunks waiting to be sent, nearest first.
+  ChunkCoord pending[kMaxTrackedChunks];
+  size_t pending_count = 0;
+  size_t pending_index = 0;
+
+  // Chunks per tick that the client asked for in its last ChunkBatchReceived.
+  float client_chunk_rate = 9.0f;
+  size_t unacknowledged_batches = 0;
+
+  // Fractional amounts of each rate that carry over to the next tick.
+  float chunk_budget = 0.0f;
+  float section_update_budget = 0.0f;
+  float block_update_budget = 0.0f;
+  float player_update_budget = 0.0f;
+
+  u64 tick_count = 0;
+  u32 random_state = 0;
+
+  struct Stats {
+    size_t chunks;
+    size_t section_updates;
+    size_t block_updates;
+    size_t player_updates;
+    size_t bytes;
+  };
+
+  Stats stats = {};
+  Clock::time_point stats_time;
+};
+
+} // namespace mock
+} // namespace polymer
+
+#endif
@@ -0,0 +1,256 @@
+#include "terrain.h"
+
+namespace polymer {
+namespace mock {
+
+// Bits per entry for the global block state palette in 1.21.4.
+constexpr u8 kDirectBits = 15;
+
+static inline u32 Hash(s32 x, s32 y, s32 z, u32 seed) {
+  u32 h = seed ^ ((u32)x * 0x27D4EB2Du) ^ ((u32)y * 0x165667B1u) ^ ((u32)z * 0x9E3779B1u);
+
+  h ^= h >> 15;
+  h *= 0x85EBCA77u;
+  h ^= h >> 13;
+  h *= 0xC2B2AE3Du;
+  h ^= h >> 16;
+
+  return h;
+}
+
+static inline s32 FloorDiv(s32 value, s32 divisor) {
+  return (value >= 0 ? value : value - divisor + 1) / divisor;
+}
+
+// Smoothed value noise in the range [0, 1].
+static float ValueNoise(s32 x, s32 z, s32 cell_size, u32 seed) {
+  s32 cell_x = FloorDiv(x, cell_size);
+  s32 cell_z = FloorDiv(z, cell_size);
+
+  float tx = (float)(x - cell_x * cell_size) / cell_size;
+  float tz = (float)(z - cell_z * cell_size) / cell_size;
+
+  tx = tx * tx * (3.0f - 2.0f * tx);
+  tz = tz * tz * (3.0f - 2.0f * tz);
+
+  float v00 = (Hash(cell_x, 0, cell_z, seed) & 0xFFFF) / 65535.0f;
+  float v10 = (Hash(cell_x + 1, 0, cell_z, seed) & 0xFFFF) / 65535.0f;
+  float v01 = (Hash(cell_x, 0, cell_z + 1, seed) & 0xFFFF) / 65535.0f;
+  float v11 = (Hash(cell_x + 1, 0, cell_z + 1, seed) & 0xFFFF) / 65535.0f;
+
+  float top = v00 + (v10 - v00) * tx;
+  float bottom = v01 + (v11 - v01) * tx;
+
+  return top + (bottom - top) * tz;
+}
+
+TerrainGenerator::TerrainGenerator(MemoryArena& arena, u32 seed, u32 block_variety)
+    : seed(seed), block_variety(block_variety), section_buffer(arena, Kilobytes(256)) {
+  if (this->block_variety < 1) this->block_variety = 1;
+}
+
+s32 TerrainGenerator::GetHeight(s32 x, s32 z) const {
+  float hills = ValueNoise(x, z, 48, seed);
+  float detail = ValueNoise(x, z, 12, seed * 31 + 7);
+
+  return 48 + (s32)(hills * 48.0f + detail * 8.0f);
+}
+
+u32 TerrainGenerator::GetBlock(s32 x, s32 y, s32 z, s32 height) const {
+  if (y > height) return kAirId;
+  if (y == height) return kGrassId;
+  if (y > height - 4) return kDirtId;
+
+  if (block_variety <= 1) return kStoneId;
+
+  // The lowest block state ids are all simple blocks, starting with the stone variants.
+  return kStoneId + Hash(x, y, z, seed) % block_variety;
+}
+
+void TerrainGenerator::WriteChunkData(PacketBuilder& builder, s32 chunk_x, s32 chunk_z) {
+  min_height = 0x7FFFFFFF;
+
+  for (s32 z = 0; z < 16; ++z) {
+    for (s32 x = 0; x < 16; ++x) {
+      s32 height = GetHeight(chunk_x * 16 + x, chunk_z * 16 + z);
+
+      heights[z][x] = height;
+
+      if (height < min_height) min_height = height;
+    }
+  }
+
+  builder.WriteU32((u32)chunk_x);
+  builder.WriteU32((u32)chunk_z);
+
+  // Empty heightmaps compound.
+  builder.WriteU8(0x0A);
+  builder.WriteU8(0x00);
+
+  section_buffer.read_offset = section_buffer.write_offset = 0;
+
+  for (size_t i = 0; i < kSectionCount; ++i) {
+    WriteSection(chunk_x, chunk_z, i);
+  }
+
+  builder.WriteVarInt(section_buffer.write_offset);
+  builder.WriteRawString((char*)section_buffer.data, section_buffer.write_offset);
+
+  // No block entities.
+  builder.WriteVarInt(0);
+
+  WriteLight(builder);
+}
+
+void TerrainGenerator::WriteSection(s32 chunk_x, s32 chunk_z, size_t section_index) {
+  RingBuffer& out = section_buffer;
+
+  s32 base_y = kWorldMinY + (s32)section_index * 16;
+  size_t palette_count = 0;
+  u16 block_count = 0;
+
+  for (s32 y = 0; y < 16; ++y) {
+    for (s32 z = 0; z < 16; ++z) {
+      for (s32 x = 0; x < 16; ++x) {
+        u32 bid = GetBlock(chunk_x * 16 + x, base_y + y, chunk_z * 16 + z, heights[z][x]);
+
+        blocks[y * 256 + z * 16 + x] = bid;
+
+        if (bid != kAirId) ++block_count;
+
+        // Past the indirect limit the palette is only used to know that the section is direct.
+        if (palette_count <= polymer_array_count(palette)) {
+          size_t index = 0;
+
+          while (index < palette_count && palette[index] != bid) {
+            ++index;
+          }
+
+          if (index == palette_count) {
+            if (palette_count < polymer_array_count(palette)) palette[index] = bid;
+            ++palette_count;
+          }
+
+          indices[y * 256 + z * 16 + x] = (u8)index;
+        }
+      }
+    }
+  }
+
+  out.WriteU16(block_count);
+
+  if (palette_count == 1) {
+    out.WriteU8(0);
+    out.WriteVarInt(palette[0]);
+    out.WriteVarInt(0);
+  } else {
+    bool indirect = palette_count <= polymer_array_count(palette);
+    u8 bits = kDirectBits;
+
+    if (indirect) {
+      bits = 4;
+
+      while (((size_t)1 << bits) < palette_count) {
+        ++bits;
+      }
+
+      out.WriteU8(bits);
+      out.WriteVarInt(palette_count);
+
+      for (size_t i = 0; i < palette_count; ++i) {
+        out.WriteVarInt(palette[i]);
+      }
+    } else {
+      out.WriteU8(bits);
+    }
+
+    size_t per_long = 64 / bits;
+    size_t long_count = (polymer_array_count(blocks) + per_long - 1) / per_long;
+
+    out.WriteVarInt(long_count);
+
+    for (size_t i = 0; i < long_count; ++i) {
+      u64 value = 0;
+
+      for (size_t j = 0; j < per_long; ++j) {
+        size_t block_index = i * per_long + j;
+
+        if (block_index >= polymer_array_count(blocks)) break;
+
+        u64 entry = indirect ? indices[block_index] : blocks[block_index];
+
+        value |= entry << (j * bits);
+      }
+
+      out.WriteU64(value);
+    }
+  }
+
+  // Single value biome container with the first biome.
+  out.WriteU8(0);
+  out.WriteVarInt(0);
+  out.WriteVarInt(0);
+}
+
+void TerrainGenerator::WriteLight(PacketBuilder& builder) {
+  u64 sky_mask = 0;
+  u64 empty_sky_mask = 0;
+  u64 all_sections = (1ULL << kLightSectionCount) - 1;
+
+  for (size_t i = 0; i < kLightSectionCount; ++i) {
+    s32 base_y = kWorldMinY + ((s32)i - 1) * 16;
+
+    // Sections that are completely underground are dark, so they are sent as empty.
+    if (base_y + 15 <= min_height) {
+      empty_sky_mask |= 1ULL << i;
+    } else {
+      sky_mask |= 1ULL << i;
+    }
+  }
+
+  // Sky light mask, block light mask, empty sky light mask, empty block light mask.
+  builder.WriteVarInt(1);
+  builder.WriteU64(sky_mask);
+  builder.WriteVarInt(0);
+  builder.WriteVarInt(1);
+  builder.WriteU64(empty_sky_mask);
+  builder.WriteVarInt(1);
+  builder.WriteU64(all_sections);
+
+  size_t sky_count = 0;
+
+  for (size_t i = 0; i < kLightSectionCount; ++i) {
+    if (sky_mask & (1ULL << i)) ++sky_count;
+  }
+
+  builder.WriteVarInt(sky_count);
+
+  u8 nibbles[2048];
+
+  for (size_t i = 0; i < kLightSectionCount; ++i) {
+    if (!(sky_mask & (1ULL << i))) continue;
+
+    s32 base_y = kWorldMinY + ((s32)i - 1) * 16;
+
+    // Everything above the surface is fully lit and everything at or below it is dark.
+    for (s32 y = 0; y < 16; ++y) {
+      for (s32 z = 0; z < 16; ++z) {
+        for (s32 x = 0; x < 16; x += 2) {
+          u8 low = base_y + y > heights[z][x] ? 0x0F : 0;
+          u8 high = base_y + y > heights[z][x + 1] ? 0xF0 : 0;
+
+          nibbles[(y * 256 + z * 16 + x) / 2] = low | high;
+        }
+      }
+    }
+
+    builder.WriteVarInt(sizeof(nibbles));
+    builder.WriteRawString((char*)nibbles, sizeof(nibbles));
+  }
+
+  // No block light arrays.
+  builder.WriteVarInt(0);
+}
+
+} // namespace mock
+} // namespace polymer
@@ -0,0 +1,55 @@
+#ifndef POLYMER_MOCK_SERVER_TERRAIN_H_
+#define POLYMER_MOCK_SERVER_TERRAIN_H_
+
+#include <polymer/buffer.h>
+#include <polymer/memory.h>
+#include <polymer/packet_builder.h>
+#include <polymer/types.h>
+
+namespace polymer {
+namespace mock {
+
+// The overworld that the client falls back to when the registry data doesn't include the dimension.
+constexpr s32 kWorldMinY = -64;
+constexpr size_t kSectionCount = 24;
+// Light is also sent for the section below and above the world.
+constexpr size_t kLightSectionCount = kSectionCount + 2;
+
+// Block state ids for 1.21.4.
+constexpr u32 kAirId = 0;
+constexpr u32 kStoneId = 1;
+constexpr u32 kGrassId = 9;
+constexpr u32 kDirtId = 10;
+
+// Procedural hills with a configurable number of distinct underground blocks. The variety controls how wide the
+// section palettes get, so it can be used to push the client onto its wider storage paths.
+struct TerrainGenerator {
+  u32 seed;
+  u32 block_variety;
+
+  TerrainGenerator(MemoryArena& arena, u32 seed, u32 block_variety);
+
+  s32 GetHeight(s32 x, s32 z) const;
+  u32 GetBlock(s32 x, s32 y, s32 z, s32 height) const;
+
+  // Writes the body of a ChunkData packet, which includes the light data.
+  void WriteChunkData(PacketBuilder& builder, s32 chunk_x, s32 chunk_z);
+
+private:
+  void WriteSection(s32 chunk_x, s32 chunk_z, size_t section_index);
+  void WriteLight(PacketBuilder& builder);
+
+  RingBuffer section_buffer;
+
+  s32 heights[16][16];
+  s32 min_height;
+
+  u32 blocks[16 * 16 * 16];
+  u8 indices[16 * 16 * 16];
+  u32 palette[256];
+};
+
+} // namespace mock
+} // namespace polymer
+
+#endif
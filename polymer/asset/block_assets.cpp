@@ -62,6 +62,10 @@ struct AssetParser {
   u8* texture_images;
   bool* texture_mipping_configs;
 
+  u8* texture_animation_indices;
+  u32 texture_animations[render::kMaxTextureAnimations];
+  size_t texture_animation_count;
+
   AssetParser(MemoryArena* arena, BlockRegistry* registry, ZipArchive& archive)
       : arena(arena), registry(registry), archive(archive), model_count(0), parsed_block_map(*arena),
         texture_id_map(*arena) {}
@@ -72,6 +76,7 @@ struct AssetParser {
   bool ParseBlocks(MemoryArena* perm_arena, const char* blocks_filename);
 
   size_t LoadTextures();
+  u8 GetAnimationIndex(const BlockTextureDescriptor& descriptor);
 
   void ResolveModel(ParsedBlockModel& model);
   void ResolveModels(MemoryArena& perm_arena);
@@ -297,6 +302,20 @@ bool BlockAssetLoader::Load(render::VulkanRenderer& renderer, ZipArchive& archiv
 
   size_t texture_count = parser.texture_count;
 
+  if (texture_count > render::kChunkVertexMaxTextures) {
+    fprintf(stderr, "Too many block textures (%zu). Chunk vertices can only address %u.\n", texture_count,
+            render::kChunkVertexMaxTextures);
+    return false;
+  }
+
+  assets->texture_count = texture_count;
+  assets->texture_animation_indices = memory_arena_push_type_count(&perm_arena, u8, texture_count);
+  memcpy(assets->texture_animation_indices, parser.texture_animation_indices, texture_count);
+
+  assets->texture_animation_count = parser.texture_animation_count;
+  assets->texture_animations = memory_arena_push_type_count(&perm_arena, u32, parser.texture_animation_count);
+  memcpy(assets->texture_animations, parser.texture_animations, sizeof(u32) * parser.texture_animation_count);
+
   assets->block_textures = renderer.CreateTextureArray(16, 16, texture_count);
 
   if (!assets->block_textures) {
@@ -444,6 +463,11 @@ size_t AssetParser::LoadTextures() {
   // any amount.
   this->texture_images = memory_arena_push_type_count(arena, u8, kTextureSize * state_count * 4);
   this->texture_mipping_configs = memory_arena_push_type_count(arena, bool, state_count * 4);
+  this->texture_animation_indices = memory_arena_push_type_count(arena, u8, state_count * 4);
+
+  // The first animation is reserved for static textures.
+  this->texture_animations[0] = 1 | (1 << 8);
+  this->texture_animation_count = 1;
 
   u32 current_texture_id = 0;
 
@@ -546,12 +570,14 @@ size_t AssetParser::LoadTextures() {
       full_texture_id_map->Insert(full_texture_name, descriptor);
 
       bool brighten_mipping = IsBrightenedMipping(texture_name);
+      u8 animation_index = GetAnimationIndex(descriptor);
 
       s32 image_pitch = width * 4;
       s32 texture_pitch = 16 * 4;
 
       for (u32 j = 0; j < descriptor.count; ++j) {
         texture_mipping_configs[current_texture_id] = brighten_mipping;
+        texture_animation_indices[current_texture_id] = animation_index;
         u8* destination = texture_images + (current_texture_id * kTextureSize);
 
         u32 image_index = j;
@@ -579,6 +605,27 @@ size_t AssetParser::LoadTextures() {
   return current_texture_id;
 }
 
+u8 AssetParser::GetAnimationIndex(const BlockTextureDescriptor& descriptor) {
+  if (descriptor.count <= 1) return 0;
+
+  u32 frame_count = descriptor.count > 0xFF ? 0xFF : descriptor.count;
+  u32 packed = frame_count | (descriptor.animation_time << 8) | (descriptor.interpolated << 23);
+
+  for (size_t i = 0; i < texture_animation_count; ++i) {
+    if (texture_animations[i] == packed) {
+      return (u8)i;
+    }
+  }
+
+  if (texture_animation_count >= render::kMaxTextureAnimations) {
+    fprintf(stderr, "Too many unique texture animations. Texture will be static.\n");
+    return 0;
+  }
+
+  texture_animations[texture_animation_count] = packed;
+  return (u8)texture_animation_count++;
+}
+
 static u32 GetHighestStateId(json_object_s* root) {
   u32 highest_id = 0;
 
@@ -45,6 +45,13 @@ struct BlockAssets {
   TextureDescriptorMap* texture_descriptor_map = nullptr;
   render::VulkanTexture* block_textures = nullptr;
   world::BlockRegistry* block_registry = nullptr;
+
+  size_t texture_count = 0;
+  // Index into texture_animations for every texture id. Zero is a static texture.
+  u8* texture_animation_indices = nullptr;
+  // Unique animations packed as frame count | frametime << 8 | interpolated << 23.
+  u32* texture_animations = nullptr;
+  size_t texture_animation_count = 0;
 };
 
 struct BlockAssetLoader {
@@ -1,11 +1,14 @@
 #include <polymer/buffer.h>
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 // TODO: Endianness
 
 #ifdef _MSC_VER
+#include <intrin.h>
+
 #define bswap_16(x) _byteswap_ushort(x)
 #define bswap_32(x) _byteswap_ulong(x)
 #define bswap_64(x) _byteswap_uint64(x)
@@ -17,6 +20,14 @@
 
 namespace polymer {
 
+static inline void AdvanceRead(RingBuffer& buffer, size_t amount) {
+  buffer.read_offset += amount;
+
+  if (buffer.read_offset >= buffer.size) {
+    buffer.read_offset -= buffer.size;
+  }
+}
+
 RingBuffer::RingBuffer(MemoryArena& arena, size_t size) {
   if (size > 0) {
     this->data = arena.Allocate(size);
@@ -234,6 +245,12 @@ u8 RingBuffer::ReadU8() {
 }
 
 u16 RingBuffer::ReadU16() {
+  if (mirrored) {
+    u16 result = LoadBigEndianU16(this->data + this->read_offset);
+    AdvanceRead(*this, sizeof(result));
+    return result;
+  }
+
   size_t read_remaining = this->size - this->read_offset;
   u16 result = 0;
 
@@ -248,6 +265,12 @@ u16 RingBuffer::ReadU16() {
 }
 
 u32 RingBuffer::ReadU32() {
+  if (mirrored) {
+    u32 result = LoadBigEndianU32(this->data + this->read_offset);
+    AdvanceRead(*this, sizeof(result));
+    return result;
+  }
+
   size_t read_remaining = this->size - this->read_offset;
   u32 result = 0;
 
@@ -262,6 +285,12 @@ u32 RingBuffer::ReadU32() {
 }
 
 u64 RingBuffer::ReadU64() {
+  if (mirrored) {
+    u64 result = LoadBigEndianU64(this->data + this->read_offset);
+    AdvanceRead(*this, sizeof(result));
+    return result;
+  }
+
   size_t read_remaining = this->size - this->read_offset;
   u64 result = 0;
 
@@ -276,6 +305,26 @@ u64 RingBuffer::ReadU64() {
 }
 
 bool RingBuffer::ReadVarInt(u64* value) {
+  if (mirrored) {
+    size_t available = GetReadAmount();
+    const u8* buf = this->data + this->read_offset;
+    u64 result = 0;
+
+    // VarLongs are at most 10 bytes.
+    for (size_t i = 0; i < 10 && i < available; ++i) {
+      result |= (u64)(buf[i] & 0x7F) << (i * 7);
+
+      if (!(buf[i] & 0x80)) {
+        *value = result;
+        AdvanceRead(*this, i + 1);
+        return true;
+      }
+    }
+
+    *value = 0;
+    return false;
+  }
+
   size_t previous_offset = this->read_offset;
   int shift = 0;
 
@@ -310,6 +359,15 @@ bool RingBuffer::ReadVarInt(u64* value) {
 }
 
 float RingBuffer::ReadFloat() {
+  if (mirrored) {
+    u32 int_rep = LoadBigEndianU32(this->data + this->read_offset);
+    float result;
+
+    memcpy(&result, &int_rep, sizeof(result));
+    AdvanceRead(*this, sizeof(result));
+    return result;
+  }
+
   size_t read_remaining = this->size - this->read_offset;
   float result = 0;
 
@@ -337,6 +395,15 @@ float RingBuffer::ReadFloat() {
 }
 
 double RingBuffer::ReadDouble() {
+  if (mirrored) {
+    u64 int_rep = LoadBigEndianU64(this->data + this->read_offset);
+    double result;
+
+    memcpy(&result, &int_rep, sizeof(result));
+    AdvanceRead(*this, sizeof(result));
+    return result;
+  }
+
   size_t read_remaining = this->size - this->read_offset;
   double result = 0;
 
@@ -376,6 +443,12 @@ String RingBuffer::ReadAllocString(MemoryArena& arena) {
   result.data = (char*)arena.Allocate(length);
   result.size = length;
 
+  if (mirrored) {
+    memcpy(result.data, this->data + this->read_offset, (size_t)length);
+    AdvanceRead(*this, (size_t)length);
+    return result;
+  }
+
   size_t remaining = this->size - this->read_offset;
 
   if (remaining > length) {
@@ -411,6 +484,12 @@ size_t RingBuffer::ReadString(String* str) {
     return (size_t)length;
   }
 
+  if (mirrored) {
+    memcpy(str->data, this->data + this->read_offset, (size_t)length);
+    AdvanceRead(*this, (size_t)length);
+    return (size_t)length;
+  }
+
   size_t remaining = this->size - this->read_offset;
 
   if (remaining > length) {
@@ -444,6 +523,12 @@ String RingBuffer::ReadAllocRawString(MemoryArena& arena, size_t size) {
 }
 
 void RingBuffer::ReadRawString(String* str, size_t size) {
+  if (mirrored) {
+    memcpy(str->data, this->data + this->read_offset, size);
+    AdvanceRead(*this, size);
+    return;
+  }
+
   size_t remaining = this->size - this->read_offset;
 
   if (remaining > size) {
@@ -473,4 +558,170 @@ size_t GetVarIntSize(u64 value) {
   return index;
 }
 
+String RingBuffer::ReadStringView() {
+  size_t offset_snapshot = this->read_offset;
+  u64 length = 0;
+
+  if (!this->ReadVarInt(&length)) {
+    return {};
+  }
+
+  String result = ReadRawStringView((size_t)length);
+
+  if (result.size != length) {
+    this->read_offset = offset_snapshot;
+  }
+
+  return result;
+}
+
+String RingBuffer::ReadRawStringView(size_t size) {
+  u8* span = ReadSpan(size);
+
+  if (!span) return {};
+
+  return String((char*)span, size);
+}
+
+u8* RingBuffer::ReadSpan(size_t size) {
+  assert(mirrored);
+
+  if (GetReadAmount() < size) return nullptr;
+
+  u8* result = this->data + this->read_offset;
+
+  AdvanceRead(*this, size);
+
+  return result;
+}
+
+static inline size_t CountTrailingZeros(u64 value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+template <typename T, size_t kMaxBytes>
+static bool DecodeVarIntSpan(const u8* data, size_t size, T* values, size_t count, size_t* consumed) {
+  constexpr u64 kContinueBits = 0x8080808080808080ULL;
+
+  size_t offset = 0;
+  size_t index = 0;
+
+  while (index < count) {
+    // Palette ids are mostly 1-3 bytes and section update records are mostly 3-4 bytes, so anything up to 5 bytes is
+    // decoded from a single eight byte load. The stop bits mark the last byte of each value.
+    // This assumes a little-endian host like the rest of the buffer code.
+    if (offset + sizeof(u64) <= size) {
+      u64 word;
+      memcpy(&word, data + offset, sizeof(word));
+
+      u64 stops = ~word & kContinueBits;
+
+      if (stops == kContinueBits && index + 8 <= count) {
+        for (size_t i = 0; i < 8; ++i) {
+          values[index + i] = (T)((word >> (i * 8)) & 0x7F);
+        }
+
+        index += 8;
+        offset += 8;
+        continue;
+      }
+
+      if (stops != 0) {
+        size_t length = (CountTrailingZeros(stops) >> 3) + 1;
+
+        if (length <= 5) {
+          u64 value = (word & 0x7F) | ((word >> 1) & (0x7FULL << 7)) | ((word >> 2) & (0x7FULL << 14)) |
+                      ((word >> 3) & (0x7FULL << 21)) | ((word >> 4) & (0x7FULL << 28));
+
+          values[index++] = (T)(value & ((1ULL << (length * 7)) - 1));
+          offset += length;
+          continue;
+        }
+      }
+    }
+
+    // Long values and the last few bytes of the span go through the byte loop.
+    u64 value = 0;
+    size_t i = 0;
+
+    for (; i < kMaxBytes && offset + i < size; ++i) {
+      u8 byte = data[offset + i];
+
+      value |= (u64)(byte & 0x7F) << (i * 7);
+
+      if (!(byte & 0x80)) break;
+    }
+
+    if (i == kMaxBytes || offset + i >= size) return false;
+
+    values[index++] = (T)value;
+    offset += i + 1;
+  }
+
+  *consumed = offset;
+  return true;
+}
+
+bool DecodeVarInts(const u8* data, size_t size, u32* values, size_t count, size_t* consumed) {
+  return DecodeVarIntSpan<u32, 5>(data, size, values, count, consumed);
+}
+
+bool DecodeVarLongs(const u8* data, size_t size, u64* values, size_t count, size_t* consumed) {
+  return DecodeVarIntSpan<u64, 10>(data, size, values, count, consumed);
+}
+
+bool RingBuffer::ReadVarInts(u32* values, size_t count) {
+  if (mirrored) {
+    size_t consumed = 0;
+
+    if (!DecodeVarInts(this->data + this->read_offset, GetReadAmount(), values, count, &consumed)) return false;
+
+    AdvanceRead(*this, consumed);
+    return true;
+  }
+
+  size_t offset_snapshot = this->read_offset;
+
+  for (size_t i = 0; i < count; ++i) {
+    u64 value = 0;
+
+    if (!ReadVarInt(&value)) {
+      this->read_offset = offset_snapshot;
+      return false;
+    }
+
+    values[i] = (u32)value;
+  }
+
+  return true;
+}
+
+bool RingBuffer::ReadVarLongs(u64* values, size_t count) {
+  if (mirrored) {
+    size_t consumed = 0;
+
+    if (!DecodeVarLongs(this->data + this->read_offset, GetReadAmount(), values, count, &consumed)) return false;
+
+    AdvanceRead(*this, consumed);
+    return true;
+  }
+
+  size_t offset_snapshot = this->read_offset;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!ReadVarInt(values + i)) {
+      this->read_offset = offset_snapshot;
+      return false;
+    }
+  }
+
+  return true;
+}
+
 } // namespace polymer
@@ -4,11 +4,46 @@
 #include <polymer/memory.h>
 #include <polymer/types.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace polymer {
 
+// Loads big-endian values from unaligned memory.
+inline u16 LoadBigEndianU16(const u8* data) {
+  u16 value;
+  memcpy(&value, data, sizeof(value));
+#ifdef _MSC_VER
+  return _byteswap_ushort(value);
+#else
+  return __builtin_bswap16(value);
+#endif
+}
+
+inline u32 LoadBigEndianU32(const u8* data) {
+  u32 value;
+  memcpy(&value, data, sizeof(value));
+#ifdef _MSC_VER
+  return _byteswap_ulong(value);
+#else
+  return __builtin_bswap32(value);
+#endif
+}
+
+inline u64 LoadBigEndianU64(const u8* data) {
+  u64 value;
+  memcpy(&value, data, sizeof(value));
+#ifdef _MSC_VER
+  return _byteswap_uint64(value);
+#else
+  return __builtin_bswap64(value);
+#endif
+}
+
 // Simple circular buffer where the read and write methods assume there's space to operate
 // The only method that checks for read/write cursor wrapping is ReadVarInt.
-// This could be simplified greatly by using virtual memory wrapping.
+// Buffers over memory from AllocateMirroredBuffer can read straight across the end of the buffer, so their reads skip
+// the split paths and can return views into the buffer instead of copying.
 struct RingBuffer {
   size_t read_offset;
   size_t write_offset;
@@ -16,7 +51,11 @@ struct RingBuffer {
   size_t size;
   u8* data;
 
+  bool mirrored = false;
+
   RingBuffer(MemoryArena& arena, size_t size);
+  // Wraps mirrored memory without taking ownership of it.
+  RingBuffer(u8* data, size_t size) : read_offset(0), write_offset(0), size(size), data(data), mirrored(true) {}
 
   void WriteU8(u8 value);
   void WriteU16(u16 value);
@@ -43,12 +82,27 @@ struct RingBuffer {
   size_t ReadString(String* str);
   void ReadRawString(String* str, size_t size);
 
+  // These read in place and only work on mirrored buffers. The result points into the buffer, so it's only valid until
+  // that part of the buffer is written again. The result is empty if there isn't enough data.
+  String ReadStringView();
+  String ReadRawStringView(size_t size);
+  u8* ReadSpan(size_t size);
+
+  // Reads count VarInts or VarLongs in one call. The read offset is left alone if any of them fail to read.
+  bool ReadVarInts(u32* values, size_t count);
+  bool ReadVarLongs(u64* values, size_t count);
+
   size_t GetFreeSize() const;
   size_t GetReadAmount() const;
 };
 
 size_t GetVarIntSize(u64 value);
 
+// Decodes count VarInts or VarLongs from a contiguous span and stores the number of bytes used in consumed.
+// Returns false if the span ends early or a value is too long.
+bool DecodeVarInts(const u8* data, size_t size, u32* values, size_t count, size_t* consumed);
+bool DecodeVarLongs(const u8* data, size_t size, u64* values, size_t count, size_t* consumed);
+
 } // namespace polymer
 
 #endif
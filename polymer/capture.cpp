@@ -0,0 +1,139 @@
+#include <polymer/capture.h>
+
+#include <string.h>
+
+namespace polymer {
+
+bool PacketCapture::Open(const char* path) {
+  file = fopen(path, "wb");
+
+  if (!file) {
+    fprintf(stderr, "Failed to open capture file '%s'.\n", path);
+    return false;
+  }
+
+  CaptureHeader header = {};
+
+  header.magic = kCaptureMagic;
+  header.version = kCaptureVersion;
+  header.protocol_version = kProtocolVersion;
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1) {
+    fprintf(stderr, "Failed to write capture header.\n");
+    Close();
+    return false;
+  }
+
+  // Force a state record before the first packet.
+  state = ProtocolState::Handshake;
+  start_time = std::chrono::steady_clock::now();
+
+  return true;
+}
+
+void PacketCapture::Close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+u64 PacketCapture::GetTimestamp() const {
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+
+  return (u64)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+bool PacketCapture::WritePacket(u64 timestamp, ProtocolState packet_state, const u8* payload, size_t size,
+                                size_t data_size) {
+  if (!file) return false;
+
+  CaptureRecord record = {};
+
+  record.timestamp = timestamp;
+
+  if (packet_state != state) {
+    record.type = CaptureRecordType::State;
+    record.state = (u8)packet_state;
+
+    if (fwrite(&record, sizeof(record), 1, file) != 1) {
+      fprintf(stderr, "Failed to write capture record. Stopping capture.\n");
+      Close();
+      return false;
+    }
+
+    state = packet_state;
+  }
+
+  record.type = CaptureRecordType::Packet;
+  record.state = (u8)packet_state;
+  record.size = (u32)size;
+  record.data_size = (u32)data_size;
+
+  if (fwrite(&record, sizeof(record), 1, file) != 1 || fwrite(payload, 1, size, file) != size) {
+    fprintf(stderr, "Failed to write capture record. Stopping capture.\n");
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool CaptureReader::Open(const char* path) {
+  file = fopen(path, "rb");
+
+  if (!file) {
+    fprintf(stderr, "Failed to open capture file '%s'.\n", path);
+    return false;
+  }
+
+  CaptureHeader header = {};
+
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != kCaptureMagic) {
+    fprintf(stderr, "'%s' is not a capture file.\n", path);
+    Close();
+    return false;
+  }
+
+  if (header.version != kCaptureVersion) {
+    fprintf(stderr, "Capture file version %u is not supported.\n", header.version);
+    Close();
+    return false;
+  }
+
+  protocol_version = header.protocol_version;
+
+  if (protocol_version != kProtocolVersion) {
+    fprintf(stderr, "Capture was made with protocol %u, but the client uses %u. Replay may fail.\n", protocol_version,
+            kProtocolVersion);
+  }
+
+  return true;
+}
+
+void CaptureReader::Close() {
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+bool CaptureReader::ReadRecord(CaptureRecord* record) {
+  if (!file) return false;
+  if (fread(record, sizeof(*record), 1, file) != 1) return false;
+
+  if (record->type != CaptureRecordType::Packet && record->type != CaptureRecordType::State) {
+    fprintf(stderr, "Unknown capture record type %d.\n", (int)record->type);
+    return false;
+  }
+
+  return true;
+}
+
+bool CaptureReader::ReadPayload(u8* dest, size_t size) {
+  if (!file) return false;
+
+  return fread(dest, 1, size, file) == size;
+}
+
+} // namespace polymer
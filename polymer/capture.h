@@ -0,0 +1,71 @@
+#ifndef POLYMER_CAPTURE_H_
+#define POLYMER_CAPTURE_H_
+
+#include <polymer/protocol.h>
+#include <polymer/types.h>
+
+#include <chrono>
+#include <stdio.h>
+
+namespace polymer {
+
+// Capture files hold the inbound packets of a session after framing so they can be replayed without a server.
+// The file is a CaptureHeader followed by records until the end of the file. Everything is in native byte order.
+constexpr u32 kCaptureMagic = 0x50414350; // "PCAP"
+constexpr u32 kCaptureVersion = 1;
+
+struct CaptureHeader {
+  u32 magic;
+  u32 version;
+  u32 protocol_version;
+  u32 reserved;
+};
+
+enum class CaptureRecordType : u8 {
+  // Followed by size bytes of packet payload, which is still compressed if data_size is non-zero.
+  Packet,
+  // The packets after this are in the new protocol state. The first record of a capture is always a state record.
+  State,
+};
+
+struct CaptureRecord {
+  // Microseconds since the capture started.
+  u64 timestamp;
+  u32 size;
+  u32 data_size;
+  CaptureRecordType type;
+  // The ProtocolState of the packet.
+  u8 state;
+  u8 reserved[6];
+};
+
+// Written from the network thread as packets are committed, so records are in the exact order the server sent them.
+struct PacketCapture {
+  FILE* file = nullptr;
+  ProtocolState state = ProtocolState::Handshake;
+  std::chrono::steady_clock::time_point start_time;
+
+  bool Open(const char* path);
+  void Close();
+
+  u64 GetTimestamp() const;
+
+  bool WritePacket(u64 timestamp, ProtocolState state, const u8* payload, size_t size, size_t data_size);
+};
+
+struct CaptureReader {
+  FILE* file = nullptr;
+  u32 protocol_version = 0;
+
+  bool Open(const char* path);
+  void Close();
+
+  // Returns false at the end of the file or if the record is malformed.
+  bool ReadRecord(CaptureRecord* record);
+  // Reads the payload of the last packet record.
+  bool ReadPayload(u8* dest, size_t size);
+};
+
+} // namespace polymer
+
+#endif
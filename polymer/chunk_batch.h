@@ -0,0 +1,105 @@
+#ifndef POLYMER_CHUNK_BATCH_H_
+#define POLYMER_CHUNK_BATCH_H_
+
+#include <polymer/types.h>
+
+#include <chrono>
+
+namespace polymer {
+
+// Estimates how many chunks the client can take per tick, the same way the vanilla client does.
+// Each batch is timed from its start until its chunks have been meshed, and the time per chunk is folded into an
+// average that favors history. Samples are clamped so a single hitch can't swing the estimate too far.
+struct ChunkBatchTracker {
+  using Clock = std::chrono::steady_clock;
+
+  // Vanilla aims to spend this much of each tick on chunks.
+  constexpr static double kTargetNanosPerTick = 7000000.0;
+  constexpr static double kInitialNanosPerChunk = 2000000.0;
+  constexpr static double kClampCoefficient = 3.0;
+  constexpr static u32 kMaxOldSamplesWeight = 49;
+
+  constexpr static size_t kMaxPendingBatches = 16;
+  // Batches are acknowledged after this even if the mesher never caught up, such as when the window is minimized.
+  constexpr static auto kMaxAcknowledgeDelay = std::chrono::seconds(2);
+
+  struct PendingBatch {
+    Clock::time_point start_time;
+    Clock::time_point finish_time;
+    size_t chunk_count;
+    // The mesh backlog only includes this batch after a draw that happened after it finished.
+    u64 finish_draw;
+  };
+
+  double nanos_per_chunk = kInitialNanosPerChunk;
+  u32 old_samples_weight = 1;
+
+  Clock::time_point batch_start_time = Clock::now();
+
+  PendingBatch pending[kMaxPendingBatches];
+  size_t pending_count = 0;
+
+  inline void OnBatchStart() {
+    batch_start_time = Clock::now();
+  }
+
+  inline bool IsFull() const {
+    return pending_count >= kMaxPendingBatches;
+  }
+
+  // The tracker must not be full.
+  inline void OnBatchFinished(size_t chunk_count, u64 draw_count) {
+    PendingBatch* batch = pending + pending_count++;
+
+    batch->start_time = batch_start_time;
+    batch->finish_time = Clock::now();
+    batch->chunk_count = chunk_count;
+    batch->finish_draw = draw_count;
+  }
+
+  // Returns true when the oldest batch has been drawn and the mesh backlog is small enough to acknowledge it.
+  inline bool IsReady(size_t mesh_backlog, u64 draw_count, size_t max_backlog) const {
+    if (pending_count == 0) return false;
+
+    const PendingBatch& batch = pending[0];
+
+    if (Clock::now() - batch.finish_time >= kMaxAcknowledgeDelay) return true;
+
+    return draw_count > batch.finish_draw && mesh_backlog <= max_backlog;
+  }
+
+  // Finishes timing the oldest batch and returns the chunks per tick to report to the server.
+  inline float Acknowledge() {
+    if (pending_count == 0) return GetChunksPerTick();
+
+    PendingBatch batch = pending[0];
+
+    for (size_t i = 1; i < pending_count; ++i) {
+      pending[i - 1] = pending[i];
+    }
+
+    --pending_count;
+
+    if (batch.chunk_count > 0) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - batch.start_time);
+      double sample = (double)elapsed.count() / batch.chunk_count;
+
+      if (sample < nanos_per_chunk / kClampCoefficient) sample = nanos_per_chunk / kClampCoefficient;
+      if (sample > nanos_per_chunk * kClampCoefficient) sample = nanos_per_chunk * kClampCoefficient;
+
+      nanos_per_chunk = (nanos_per_chunk * old_samples_weight + sample) / (old_samples_weight + 1);
+
+      if (old_samples_weight < kMaxOldSamplesWeight) ++old_samples_weight;
+    }
+
+    return GetChunksPerTick();
+  }
+
+  inline float GetChunksPerTick() const {
+    return (float)(kTargetNanosPerTick / nanos_per_chunk);
+  }
+};
+
+} // namespace polymer
+
+#endif
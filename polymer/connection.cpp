@@ -44,54 +44,475 @@ Connection::Connection(MemoryArena& arena)
     : read_buffer(arena, 0), write_buffer(arena, 0), interpreter(nullptr), builder(arena) {}
 
 Connection::TickResult Connection::Tick() {
+  assert(interpreter);
+
+  // Grab the network result before interpreting so any packets queued before the connection ended are processed.
+  TickResult result = network_result.load(std::memory_order_acquire);
+
+  interpreter->Interpret();
+
+  // Publish everything written since the last tick, including responses from the interpreted packets.
+  size_t limit = write_buffer.write_offset;
+  bool published = limit != send_limit.load(std::memory_order_relaxed);
+
+  send_limit.store(limit, std::memory_order_seq_cst);
+  write_buffer.read_offset = send_offset.load(std::memory_order_acquire);
+
+  if (published) {
+    WakeNetwork();
+  }
+
+  tick_stats.recv_calls = (u32)counters.recv_calls.exchange(0, std::memory_order_relaxed);
+  tick_stats.send_calls = (u32)counters.send_calls.exchange(0, std::memory_order_relaxed);
+  tick_stats.wait_calls = (u32)counters.wait_calls.exchange(0, std::memory_order_relaxed);
+  tick_stats.wake_calls = (u32)counters.wake_calls.exchange(0, std::memory_order_relaxed);
+  tick_stats.bytes_received = counters.bytes_received.exchange(0, std::memory_order_relaxed);
+  tick_stats.bytes_sent = counters.bytes_sent.exchange(0, std::memory_order_relaxed);
+
+  if (result != TickResult::Success && this->connected) {
+    this->Disconnect();
+  }
+
+  return result;
+}
+
+bool Connection::StartNetworkThread() {
+  if (!poller.Initialize(fd)) {
+    return false;
+  }
+
+  send_limit.store(write_buffer.write_offset, std::memory_order_relaxed);
+  send_offset.store(write_buffer.read_offset, std::memory_order_relaxed);
+  network_result.store(TickResult::Success, std::memory_order_relaxed);
+  network_running.store(true, std::memory_order_release);
+
+  socket_readable = true;
+  send_blocked = false;
+  encrypted = false;
+
+  // Leave a core each for the game and network threads.
+  size_t hardware_threads = std::thread::hardware_concurrency();
+  size_t worker_count = hardware_threads > 2 ? hardware_threads - 2 : 1;
+
+  decode_pipeline.Start(packet_queue, ProtocolState::Login, worker_count);
+
+  network_thread = std::thread([this]() { RunNetwork(); });
+
+  return true;
+}
+
+bool Connection::StartReplay(const char* path, bool realtime) {
+  if (!replay.Open(path)) return false;
+
+  CaptureRecord record;
+
+  // The capture always starts with the state of its first packet.
+  if (!replay.ReadRecord(&record) || record.type != CaptureRecordType::State) {
+    fprintf(stderr, "Capture file '%s' is missing its initial state.\n", path);
+    replay.Close();
+    return false;
+  }
+
+  protocol_state = (ProtocolState)record.state;
+  replay_realtime = realtime;
+  interpreter->replaying = true;
+  connected = true;
+
+  send_limit.store(write_buffer.write_offset, std::memory_order_relaxed);
+  send_offset.store(write_buffer.read_offset, std::memory_order_relaxed);
+  network_result.store(TickResult::Success, std::memory_order_relaxed);
+  network_running.store(true, std::memory_order_release);
+
+  size_t hardware_threads = std::thread::hardware_concurrency();
+  size_t worker_count = hardware_threads > 2 ? hardware_threads - 2 : 1;
+
+  decode_pipeline.Start(packet_queue, protocol_state, worker_count);
+
+  network_thread = std::thread([this]() { RunReplay(); });
+
+  return true;
+}
+
+bool Connection::WaitReplay() {
+  // There is no socket, so everything the game thread publishes is considered sent.
+  send_offset.store(send_limit.load(std::memory_order_acquire), std::memory_order_release);
+
+  decode_pipeline.Commit();
+
+  std::this_thread::sleep_for(std::chrono::microseconds(500));
+
+  return network_running.load(std::memory_order_acquire);
+}
+
+void Connection::RunReplay() {
+  using namespace std::chrono;
+
   RingBuffer* rb = &read_buffer;
+  CaptureRecord record;
+
+  size_t packet_count = 0;
+  size_t byte_count = 0;
+  auto start = steady_clock::now();
+
+  TickResult result = TickResult::ConnectionClosed;
+  bool running = true;
+
+  while (running && replay.ReadRecord(&record)) {
+    if (record.type != CaptureRecordType::Packet) continue;
+
+    // Leave one byte free so a full buffer can be told apart from an empty one.
+    if (record.size >= rb->size) {
+      fprintf(stderr, "Captured packet of size %u is too large for the read buffer.\n", record.size);
+      result = TickResult::ConnectionError;
+      break;
+    }
+
+    if (replay_realtime) {
+      auto target = start + microseconds(record.timestamp);
+
+      while (running && steady_clock::now() < target) {
+        running = WaitReplay();
+      }
+    }
+
+    while (running && GetReadBufferFreeSize() < record.size) {
+      running = WaitReplay();
+    }
+
+    if (!running) break;
+
+    // The read buffer is mirrored, so the payload is free to run past the end of the buffer.
+    size_t source_offset = rb->write_offset;
+    u8* payload = rb->data + source_offset;
+
+    if (!replay.ReadPayload(payload, record.size)) {
+      fprintf(stderr, "Capture file ended in the middle of a packet.\n");
+      result = TickResult::ConnectionError;
+      break;
+    }
+
+    rb->write_offset = (rb->write_offset + record.size) % rb->size;
+
+    while (running && !decode_pipeline.Submit(payload, record.size, record.data_size, source_offset)) {
+      running = WaitReplay();
+    }
+
+    rb->read_offset = rb->write_offset;
+
+    ++packet_count;
+    byte_count += record.size;
+
+    // Publish right away so the game thread isn't left waiting on a full batch of jobs.
+    send_offset.store(send_limit.load(std::memory_order_acquire), std::memory_order_release);
+    decode_pipeline.Commit();
+  }
+
+  while (running && !decode_pipeline.IsIdle()) {
+    running = WaitReplay();
+  }
+
+  if (running) {
+    float elapsed = duration_cast<duration<float, std::milli>>(steady_clock::now() - start).count();
+
+    printf("Replayed %zu packets (%.2f MB) in %.2f ms.\n", packet_count, byte_count / (1024.0f * 1024.0f), elapsed);
+    fflush(stdout);
+  }
+
+  replay.Close();
+  network_result.store(result, std::memory_order_release);
+}
+
+void Connection::RunNetwork() {
+  while (network_running.load(std::memory_order_acquire)) {
+    bool progress = false;
+
+    if (!SendPending(&progress)) {
+      network_result.store(TickResult::ConnectionError, std::memory_order_release);
+      break;
+    }
+
+    TickResult result = ReceivePending(&progress);
+
+    if (result != TickResult::Success) {
+      network_result.store(result, std::memory_order_release);
+      break;
+    }
+
+    if (!progress) {
+      WaitNetwork();
+    }
+  }
+}
+
+void Connection::WaitNetwork() {
+  // When framing is blocked, the decode workers or the game thread are behind, so stop reading and let the server see
+  // backpressure.
+  bool want_read = !framing_blocked && !socket_readable && GetReadBufferFreeSize() > 0;
+  int timeout_ms = kIdleWaitMs;
+
+  // Finished jobs are only committed from this thread and the game thread doesn't wake it for queue space, so poll
+  // those quickly. Without wakeups, outbound packets are also only picked up by the timeout.
+  if (framing_blocked || !decode_pipeline.IsIdle() || !poller.CanWake()) {
+    timeout_ms = 1;
+  }
+
+  network_waiting.store(true, std::memory_order_seq_cst);
+
+  // Tick might have published right before it could see that this thread was about to wait.
+  if (!send_blocked &&
+      send_limit.load(std::memory_order_seq_cst) != send_offset.load(std::memory_order_relaxed)) {
+    network_waiting.store(false, std::memory_order_relaxed);
+    return;
+  }
+
+  counters.wait_calls.fetch_add(1, std::memory_order_relaxed);
+
+  SocketEvents events = poller.Wait(want_read, send_blocked, timeout_ms);
+
+  network_waiting.store(false, std::memory_order_relaxed);
+
+  if (events & SocketEvent_Woken) {
+    poller.ClearWake();
+  }
+
+  if (events & SocketEvent_Readable) {
+    socket_readable = true;
+  }
+
+  if (events & SocketEvent_Writable) {
+    send_blocked = false;
+  }
+
+  if (events & SocketEvent_Error) {
+    // Let the next recv or send report what went wrong instead of spinning on a broken poller.
+    socket_readable = true;
+    send_blocked = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void Connection::WakeNetwork() {
+  if (network_waiting.exchange(false, std::memory_order_seq_cst) && poller.Wake()) {
+    counters.wake_calls.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool Connection::SendPending(bool* progress) {
   RingBuffer* wb = &write_buffer;
 
-  while (wb->write_offset != wb->read_offset) {
-    int bytes_sent = 0;
+  if (send_blocked) return true;
+
+  size_t limit = send_limit.load(std::memory_order_acquire);
+  size_t offset = send_offset.load(std::memory_order_relaxed);
 
-    if (wb->write_offset > wb->read_offset) {
-      // Send up to the write offset
-      bytes_sent = send(fd, (char*)wb->data + wb->read_offset, (int)(wb->write_offset - wb->read_offset), 0);
-    } else if (wb->write_offset < wb->read_offset) {
-      // Send up to the end of the buffer then loop again to send the remaining up to the write offset
-      bytes_sent = send(fd, (char*)wb->data + wb->read_offset, (int)(wb->size - wb->read_offset), 0);
+  while (true) {
+    // The server encrypts everything after it receives EncryptionResponse, so both directions switch over on the
+    // exact byte where the response ends.
+    if (!encrypted && encryption_pending.load(std::memory_order_acquire) && offset == encryption_offset) {
+      StartEncryption();
     }
 
-    if (bytes_sent > 0) {
-      wb->read_offset = (wb->read_offset + bytes_sent) % wb->size;
+    if (offset == limit) break;
+
+    size_t send_end = limit;
+
+    if (encrypted) {
+      size_t unencrypted = (limit + wb->size - encrypt_offset) % wb->size;
+
+      if (unencrypted > 0) {
+        // The write buffer is mirrored, so the new data is contiguous even if it wraps.
+        encrypt_cipher.Encrypt(wb->data + encrypt_offset, unencrypted);
+        encrypt_offset = limit;
+      }
+    } else if (encryption_pending.load(std::memory_order_acquire)) {
+      size_t plain_size = (encryption_offset + wb->size - offset) % wb->size;
+      size_t limit_size = (limit + wb->size - offset) % wb->size;
+
+      if (plain_size < limit_size) send_end = encryption_offset;
+    }
+
+    // The write buffer is mirrored, so everything published since the last send is one contiguous range and goes out
+    // in a single call no matter how many packets it holds.
+    size_t pending = (send_end + wb->size - offset) % wb->size;
+
+    counters.send_calls.fetch_add(1, std::memory_order_relaxed);
+
+    int bytes_sent = send(fd, (char*)wb->data + offset, (int)pending, 0);
+
+    if (bytes_sent < 0) {
+      int err = GetLastErrorCode();
+
+      if (err == POLY_EWOULDBLOCK) {
+        send_blocked = true;
+        break;
+      }
+
+      fprintf(stderr, "Unexpected socket error: %d\n", err);
+      return false;
     }
+
+    counters.bytes_sent.fetch_add(bytes_sent, std::memory_order_relaxed);
+
+    offset = (offset + bytes_sent) % wb->size;
+    *progress = true;
   }
 
-  int bytes_recv = 1;
-  while (bytes_recv > 0) {
-    bytes_recv = recv(fd, (char*)rb->data + rb->write_offset, (u32)rb->GetFreeSize(), 0);
+  send_offset.store(offset, std::memory_order_release);
+  return true;
+}
+
+void Connection::EnableEncryption(const u8* key) {
+  memcpy(shared_secret, key, sizeof(shared_secret));
+
+  encryption_offset = write_buffer.write_offset;
+  encryption_pending.store(true, std::memory_order_release);
+}
+
+void Connection::StartEncryption() {
+  // The shared secret is both the key and the initial vector for each direction.
+  encrypt_cipher.Initialize(shared_secret, shared_secret);
+  decrypt_cipher.Initialize(shared_secret, shared_secret);
+
+  encrypted = true;
+  encrypt_offset = encryption_offset;
+}
+
+size_t Connection::GetReadBufferFreeSize() const {
+  const RingBuffer* rb = &read_buffer;
+
+  // Compressed packets are inflated straight out of the read buffer, so their data has to stay until they commit.
+  size_t retained_offset = decode_pipeline.GetRetainedOffset(rb->read_offset);
+  size_t used_size = (rb->write_offset + rb->size - retained_offset) % rb->size;
+
+  // Leave one byte free so a full buffer can be told apart from an empty one.
+  return rb->size - used_size - 1;
+}
+
+Connection::TickResult Connection::ReceivePending(bool* progress) {
+  RingBuffer* rb = &read_buffer;
+
+  // Finish framing anything left over from when the decode pipeline was full.
+  framing_blocked = !FramePackets();
+
+  while (!framing_blocked && socket_readable) {
+    size_t free_size = GetReadBufferFreeSize();
+
+    if (free_size == 0) break;
+
+    counters.recv_calls.fetch_add(1, std::memory_order_relaxed);
+
+    // The read buffer is mirrored, so it's free to receive past the end of the buffer.
+    int bytes_recv = recv(fd, (char*)rb->data + rb->write_offset, (u32)free_size, 0);
 
     if (bytes_recv == 0) {
-      this->connected = false;
       return TickResult::ConnectionClosed;
     } else if (bytes_recv < 0) {
       int err = GetLastErrorCode();
 
       if (err == POLY_EWOULDBLOCK) {
-        return TickResult::Success;
+        socket_readable = false;
+        break;
       }
 
       fprintf(stderr, "Unexpected socket error: %d\n", err);
-      this->Disconnect();
       return TickResult::ConnectionError;
-    } else if (bytes_recv > 0) {
-      rb->write_offset = (rb->write_offset + bytes_recv) % rb->size;
+    }
+
+    counters.bytes_received.fetch_add(bytes_recv, std::memory_order_relaxed);
 
-      assert(interpreter);
+    if (encrypted) {
+      // The read buffer is mirrored, so this decrypts in place even when it wraps.
+      decrypt_cipher.Decrypt(rb->data + rb->write_offset, bytes_recv);
+    }
+
+    rb->write_offset = (rb->write_offset + bytes_recv) % rb->size;
+    *progress = true;
 
-      if (interpreter->Interpret() == 0) break;
+    // A short read drained the socket, so wait for readiness instead of making a recv that can only fail.
+    if ((size_t)bytes_recv < free_size) {
+      socket_readable = false;
     }
+
+    framing_blocked = !FramePackets();
   }
 
   return TickResult::Success;
 }
 
+bool Connection::FramePackets() {
+  RingBuffer* rb = &read_buffer;
+
+  decode_pipeline.Commit();
+
+  while (rb->read_offset != rb->write_offset) {
+    size_t offset_snapshot = rb->read_offset;
+    u64 pkt_size = 0;
+
+    if (!rb->ReadVarInt(&pkt_size)) {
+      break;
+    }
+
+    if (rb->GetReadAmount() < pkt_size) {
+      rb->read_offset = offset_snapshot;
+      break;
+    }
+
+    size_t target_offset = (rb->read_offset + pkt_size) % rb->size;
+    size_t payload_size = (size_t)pkt_size;
+    u64 data_size = 0;
+
+    if (compression) {
+      size_t data_size_offset = rb->read_offset;
+
+      rb->ReadVarInt(&data_size);
+      payload_size -= (rb->read_offset + rb->size - data_size_offset) % rb->size;
+    }
+
+    size_t queue_size = data_size > 0 ? (size_t)data_size : payload_size;
+
+    if (PacketQueue::GetRecordSize(queue_size) > packet_queue.size) {
+      fprintf(stderr, "Packet of size %zu is too large for the packet queue. Skipping.\n", queue_size);
+      rb->read_offset = target_offset;
+      continue;
+    }
+
+    u8* payload = rb->data + rb->read_offset;
+
+    if (!decode_pipeline.Submit(payload, payload_size, (size_t)data_size, offset_snapshot)) {
+      rb->read_offset = offset_snapshot;
+      return false;
+    }
+
+    if (!compression && !login_complete) {
+      InspectLoginPacket(payload, payload_size);
+    }
+
+    rb->read_offset = target_offset;
+  }
+
+  decode_pipeline.Commit();
+
+  return true;
+}
+
+void Connection::InspectLoginPacket(u8* payload, size_t payload_size) {
+  // The read buffer is mirrored, so the payload can be read without wrapping.
+  RingBuffer rb(payload, read_buffer.size);
+  u64 pkt_id = 0;
+
+  rb.write_offset = payload_size;
+
+  if (!rb.ReadVarInt(&pkt_id)) return;
+
+  using inbound::login::ProtocolId;
+
+  if (pkt_id == (u64)ProtocolId::SetCompression) {
+    compression = true;
+  } else if (pkt_id == (u64)ProtocolId::LoginSuccess) {
+    login_complete = true;
+  }
+}
+
 ConnectResult Connection::Connect(const char* ip, u16 port) {
   addrinfo hints = {0}, *result = nullptr;
 
@@ -135,7 +556,22 @@ ConnectResult Connection::Connect(const char* ip, u16 port) {
 }
 
 void Connection::Disconnect() {
-  closesocket(this->fd);
+  network_running.store(false, std::memory_order_release);
+
+  if (network_thread.joinable() && network_thread.get_id() != std::this_thread::get_id()) {
+    poller.Wake();
+    network_thread.join();
+    decode_pipeline.Stop();
+  }
+
+  poller.Destroy();
+  builder.Shutdown();
+
+  if (this->fd != -1) {
+    closesocket(this->fd);
+    this->fd = -1;
+  }
+
   this->connected = false;
 }
 
@@ -2,118 +2,152 @@
 #define POLYMER_CONNECTION_H_
 
 #include <polymer/buffer.h>
+#include <polymer/capture.h>
+#include <polymer/crypto/aes.h>
+#include <polymer/decode_pipeline.h>
 #include <polymer/math.h>
 #include <polymer/memory.h>
+#include <polymer/packet_builder.h>
+#include <polymer/packet_queue.h>
 #include <polymer/protocol.h>
+#include <polymer/socket_poller.h>
 #include <polymer/types.h>
 
+#include <atomic>
+#include <thread>
+
 namespace polymer {
 
 enum class ConnectResult { Success, ErrorSocket, ErrorAddrInfo, ErrorConnect };
 
-#ifdef _WIN64
-using SocketType = long long;
-#else
-using SocketType = int;
-#endif
-
-struct PacketBuilder {
-  enum BuildFlag {
-    BuildFlag_Compression = (1 << 0),
-    BuildFlag_OmitCompress = (1 << 1),
-  };
-  using BuildFlags = u32;
-
-  RingBuffer buffer;
-  BuildFlags flags;
-
-  PacketBuilder(MemoryArena& arena) : buffer(arena, 32767), flags(BuildFlag_OmitCompress) {}
-
-  inline void Commit(RingBuffer& out, u32 pid) {
-    size_t compress_length_size = (flags & BuildFlag_OmitCompress) ? 0 : GetVarIntSize(0);
-    size_t total_size = buffer.write_offset + compress_length_size + GetVarIntSize(pid);
-
-    out.WriteVarInt(total_size);
-
-    if (!(flags & BuildFlag_OmitCompress)) {
-      // TODO: Implement compression
-      out.WriteVarInt(0);
-    }
-
-    out.WriteVarInt(pid);
-
-    if (buffer.write_offset > 0) {
-      out.WriteRawString(String((char*)buffer.data, buffer.write_offset));
-      buffer.write_offset = 0;
-    }
-  }
-
-  inline void WriteU8(u8 value) {
-    buffer.WriteU8(value);
-  }
-
-  inline void WriteU16(u16 value) {
-    buffer.WriteU16(value);
-  }
-
-  inline void WriteU32(u32 value) {
-    buffer.WriteU32(value);
-  }
-
-  inline void WriteU64(u64 value) {
-    buffer.WriteU64(value);
-  }
-
-  inline void WriteVarInt(u64 value) {
-    buffer.WriteVarInt(value);
-  }
-
-  inline void WriteFloat(float value) {
-    buffer.WriteFloat(value);
-  }
-
-  inline void WriteDouble(double value) {
-    buffer.WriteDouble(value);
-  }
-
-  inline void WriteString(const String& str) {
-    buffer.WriteString(str);
-  }
-
-  inline void WriteString(const char* str, size_t size) {
-    buffer.WriteString(str, size);
-  }
-
-  inline void WriteRawString(const String& str) {
-    buffer.WriteRawString(str);
-  }
-
-  inline void WriteRawString(const char* str, size_t size) {
-    buffer.WriteRawString(str, size);
-  }
+// Socket syscalls made by the network thread since the previous tick.
+struct NetworkTickStats {
+  u32 recv_calls;
+  u32 send_calls;
+  u32 wait_calls;
+  // Wakeups that the game thread sent to the network thread.
+  u32 wake_calls;
+  u64 bytes_received;
+  u64 bytes_sent;
 };
 
 struct Connection {
   enum class TickResult { Success, ConnectionClosed, ConnectionError };
 
+  // Longest the network thread waits when nothing but the socket or a wakeup can give it more work.
+  constexpr static int kIdleWaitMs = 250;
+
   SocketType fd = -1;
-  bool connected = false;
+  std::atomic<bool> connected{false};
   ProtocolState protocol_state = ProtocolState::Handshake;
 
+  // Owned by the network thread once it has started.
   RingBuffer read_buffer;
+  // Packets are built into this on the game thread. The network thread sends up to the offset published in Tick.
   RingBuffer write_buffer;
 
+  // Framed and decompressed packets waiting to be interpreted on the game thread.
+  PacketQueue packet_queue;
+  // Inflates and pre-decodes framed packets before they are committed to the packet queue.
+  DecodePipeline decode_pipeline;
+
   PacketBuilder builder;
 
   struct PacketInterpreter* interpreter;
 
+  // Updated by every Tick.
+  NetworkTickStats tick_stats = {};
+
   Connection(MemoryArena& arena);
 
   ConnectResult Connect(const char* ip, u16 port);
   void Disconnect();
   void SetBlocking(bool blocking);
 
+  // Starts the network thread that owns the socket. The socket should already be connected and non-blocking.
+  // Returns false if the socket can't be polled.
+  bool StartNetworkThread();
+  // Starts a network thread that feeds a capture file through the decode pipeline instead of reading a socket.
+  // Outbound packets are dropped. The connection closes once every captured packet has been committed.
+  // Packets are replayed as fast as the game thread takes them unless realtime is set, which keeps the recorded pace.
+  bool StartReplay(const char* path, bool realtime);
+
+  // Runs on the game thread. Interprets every packet the network thread has queued and publishes the write buffer.
   TickResult Tick();
+
+  // Game thread: called right after EncryptionResponse is written. Everything written after it is encrypted, and
+  // everything received after it has been sent is decrypted.
+  void EnableEncryption(const u8* shared_secret);
+
+private:
+  void RunNetwork();
+  void RunReplay();
+  // Sleeps briefly while still committing finished packets and dropping outbound ones. Returns false once stopped.
+  bool WaitReplay();
+  bool SendPending(bool* progress);
+  void StartEncryption();
+  TickResult ReceivePending(bool* progress);
+  // Blocks until the socket is ready for what the network thread is waiting on, the game thread has something for it,
+  // or the decode pipeline might have finished jobs to commit.
+  void WaitNetwork();
+  void WakeNetwork();
+  // Returns false if the decode pipeline can't take any more packets.
+  bool FramePackets();
+  size_t GetReadBufferFreeSize() const;
+  void InspectLoginPacket(u8* payload, size_t payload_size);
+
+  std::thread network_thread;
+  std::atomic<bool> network_running{false};
+  std::atomic<TickResult> network_result{TickResult::Success};
+
+  // Write buffer offset that the game thread has published for sending.
+  std::atomic<size_t> send_limit{0};
+  // Write buffer offset that the network thread has sent up to.
+  std::atomic<size_t> send_offset{0};
+
+  SocketPoller poller;
+  // Set while the network thread is in or about to enter a wait, so the game thread only wakes it when it has to.
+  std::atomic<bool> network_waiting{false};
+
+  // Written by the network thread and swapped out by Tick.
+  struct NetworkCounters {
+    std::atomic<u64> recv_calls{0};
+    std::atomic<u64> send_calls{0};
+    std::atomic<u64> wait_calls{0};
+    std::atomic<u64> wake_calls{0};
+    std::atomic<u64> bytes_received{0};
+    std::atomic<u64> bytes_sent{0};
+  };
+
+  NetworkCounters counters;
+
+  // Framing state that is only touched by the network thread.
+  // Compression can only be enabled during login, so the network thread watches for it to switch framing on the exact
+  // packet boundary instead of waiting on the game thread. SetCompression itself is always sent uncompressed.
+  bool compression = false;
+  bool login_complete = false;
+  bool framing_blocked = false;
+  // Readiness as last reported by the poller. Reads stop once the socket is drained and sends stop once the kernel
+  // buffer is full, then the poller waits for that to change instead of retrying each loop.
+  bool socket_readable = true;
+  bool send_blocked = false;
+
+  // Written by the game thread before encryption_pending is set and read by the network thread after.
+  std::atomic<bool> encryption_pending{false};
+  size_t encryption_offset = 0;
+  u8 shared_secret[crypto::kAes128KeySize];
+
+  // Network thread state once encryption has started. Outbound data is encrypted in the write buffer right before it
+  // is sent and inbound data is decrypted in the read buffer right after it is received, so framing never sees
+  // ciphertext.
+  bool encrypted = false;
+  // Write buffer offset that has been encrypted up to.
+  size_t encrypt_offset = 0;
+  crypto::Cfb8Cipher encrypt_cipher;
+  crypto::Cfb8Cipher decrypt_cipher;
+
+  CaptureReader replay;
+  bool replay_realtime = false;
 };
 
 } // namespace polymer
@@ -0,0 +1,525 @@
+#include <polymer/crypto/aes.h>
+
+#include <chrono>
+#include <random>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define POLYMER_AESNI_KERNELS 1
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The AES-NI kernels are compiled for that extension on their own and only selected if the cpu supports it, so the
+// rest of the build doesn't need it.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define POLYMER_TARGET_AES
+#else
+#define POLYMER_TARGET_AES __attribute__((target("aes")))
+#endif
+#endif
+
+namespace polymer {
+namespace crypto {
+
+// Writes out[i] ^= first byte of AES(blocks + i) for count bytes. The kernels work from the last byte to the first,
+// so the blocks may overlap out as long as blocks is at least a block behind it.
+using DecryptFunction = void (*)(const Cfb8Cipher& cipher, const u8* blocks, u8* out, size_t count);
+using EncryptFunction = void (*)(Cfb8Cipher& cipher, u8* data, size_t size);
+
+struct AesTables {
+  u8 sbox[256];
+  // The combined SubBytes, ShiftRows and MixColumns lookup, one table per row rotation.
+  u32 te[4][256];
+};
+
+static inline u8 RotateLeft8(u8 value, u32 shift) {
+  return (u8)((value << shift) | (value >> (8 - shift)));
+}
+
+static inline u32 RotateRight32(u32 value, u32 shift) {
+  return (value >> shift) | (value << (32 - shift));
+}
+
+static inline u8 MulTwo(u8 value) {
+  return (u8)((value << 1) ^ ((value & 0x80) ? 0x1B : 0));
+}
+
+static inline u32 LoadWord(const u8* data) {
+  return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | (u32)data[3];
+}
+
+static AesTables CreateTables() {
+  AesTables tables = {};
+
+  // Walks the multiplicative group with generator 3 so p and q stay inverses of each other, then applies the affine
+  // transform to the inverse.
+  u8 p = 1;
+  u8 q = 1;
+
+  do {
+    p = p ^ MulTwo(p);
+
+    q ^= q << 1;
+    q ^= q << 2;
+    q ^= q << 4;
+    if (q & 0x80) q ^= 0x09;
+
+    u8 affine = q ^ RotateLeft8(q, 1) ^ RotateLeft8(q, 2) ^ RotateLeft8(q, 3) ^ RotateLeft8(q, 4);
+
+    tables.sbox[p] = affine ^ 0x63;
+  } while (p != 1);
+
+  tables.sbox[0] = 0x63;
+
+  for (size_t i = 0; i < 256; ++i) {
+    u8 s = tables.sbox[i];
+    u8 s2 = MulTwo(s);
+    u8 s3 = s2 ^ s;
+    u32 word = ((u32)s2 << 24) | ((u32)s << 16) | ((u32)s << 8) | (u32)s3;
+
+    for (size_t j = 0; j < 4; ++j) {
+      tables.te[j][i] = RotateRight32(word, (u32)j * 8);
+    }
+  }
+
+  return tables;
+}
+
+static const AesTables g_tables = CreateTables();
+
+// CFB8 only ever uses the first byte of each encrypted block, so the last round only computes that byte.
+static inline u8 EncryptFirstByte(const u32* key_words, const u8* block) {
+  const u32(*te)[256] = g_tables.te;
+
+  u32 s0 = LoadWord(block + 0) ^ key_words[0];
+  u32 s1 = LoadWord(block + 4) ^ key_words[1];
+  u32 s2 = LoadWord(block + 8) ^ key_words[2];
+  u32 s3 = LoadWord(block + 12) ^ key_words[3];
+
+  for (size_t round = 1; round < kAes128Rounds; ++round) {
+    const u32* rk = key_words + round * 4;
+
+    u32 t0 = te[0][s0 >> 24] ^ te[1][(s1 >> 16) & 0xFF] ^ te[2][(s2 >> 8) & 0xFF] ^ te[3][s3 & 0xFF] ^ rk[0];
+    u32 t1 = te[0][s1 >> 24] ^ te[1][(s2 >> 16) & 0xFF] ^ te[2][(s3 >> 8) & 0xFF] ^ te[3][s0 & 0xFF] ^ rk[1];
+    u32 t2 = te[0][s2 >> 24] ^ te[1][(s3 >> 16) & 0xFF] ^ te[2][(s0 >> 8) & 0xFF] ^ te[3][s1 & 0xFF] ^ rk[2];
+    u32 t3 = te[0][s3 >> 24] ^ te[1][(s0 >> 16) & 0xFF] ^ te[2][(s1 >> 8) & 0xFF] ^ te[3][s2 & 0xFF] ^ rk[3];
+
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  return g_tables.sbox[s0 >> 24] ^ (u8)(key_words[kAes128Rounds * 4] >> 24);
+}
+
+static void ExpandKey(const u8* key, u32* words) {
+  u8 rcon = 1;
+
+  for (size_t i = 0; i < 4; ++i) {
+    words[i] = LoadWord(key + i * 4);
+  }
+
+  for (size_t i = 4; i < (kAes128Rounds + 1) * 4; ++i) {
+    u32 temp = words[i - 1];
+
+    if (i % 4 == 0) {
+      const u8* sbox = g_tables.sbox;
+
+      temp = ((u32)sbox[(temp >> 16) & 0xFF] << 24) | ((u32)sbox[(temp >> 8) & 0xFF] << 16) |
+             ((u32)sbox[temp & 0xFF] << 8) | (u32)sbox[temp >> 24];
+      temp ^= (u32)rcon << 24;
+      rcon = MulTwo(rcon);
+    }
+
+    words[i] = words[i - 4] ^ temp;
+  }
+}
+
+static void DecryptPortableBlocks(const Cfb8Cipher& cipher, const u8* blocks, u8* out, size_t count) {
+  u32 key_words[(kAes128Rounds + 1) * 4];
+
+  for (size_t i = 0; i < polymer_array_count(key_words); ++i) {
+    key_words[i] = LoadWord(cipher.round_keys + i * 4);
+  }
+
+  for (size_t i = count; i > 0; --i) {
+    out[i - 1] ^= EncryptFirstByte(key_words, blocks + i - 1);
+  }
+}
+
+static void EncryptPortableBytes(Cfb8Cipher& cipher, u8* data, size_t size) {
+  u32 key_words[(kAes128Rounds + 1) * 4];
+
+  for (size_t i = 0; i < polymer_array_count(key_words); ++i) {
+    key_words[i] = LoadWord(cipher.round_keys + i * 4);
+  }
+
+  // The shift register is kept in a window that slides forward one byte at a time and is moved back to the start
+  // once it reaches the end.
+  u8 window[kAesBlockSize * 8];
+  size_t start = 0;
+
+  memcpy(window, cipher.iv, kAesBlockSize);
+
+  for (size_t i = 0; i < size; ++i) {
+    if (start + kAesBlockSize == sizeof(window)) {
+      memmove(window, window + start, kAesBlockSize);
+      start = 0;
+    }
+
+    u8 value = data[i] ^ EncryptFirstByte(key_words, window + start);
+
+    data[i] = value;
+    window[start + kAesBlockSize] = value;
+    ++start;
+  }
+
+  memcpy(cipher.iv, window + start, kAesBlockSize);
+}
+
+#ifdef POLYMER_AESNI_KERNELS
+
+POLYMER_TARGET_AES static void DecryptAesniBlocks(const Cfb8Cipher& cipher, const u8* blocks, u8* out, size_t count) {
+  __m128i keys[kAes128Rounds + 1];
+
+  for (size_t i = 0; i <= kAes128Rounds; ++i) {
+    keys[i] = _mm_load_si128((const __m128i*)(cipher.round_keys + i * kAesBlockSize));
+  }
+
+  size_t i = count;
+
+  // aesenc has a latency of several cycles but can issue every cycle, so eight independent blocks keep it busy.
+  while (i >= 8) {
+    i -= 8;
+
+    // Kept in separate variables so the blocks stay in registers without relying on the loops being unrolled.
+    const u8* block = blocks + i;
+    __m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 0)), keys[0]);
+    __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 1)), keys[0]);
+    __m128i x2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 2)), keys[0]);
+    __m128i x3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 3)), keys[0]);
+    __m128i x4 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 4)), keys[0]);
+    __m128i x5 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 5)), keys[0]);
+    __m128i x6 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 6)), keys[0]);
+    __m128i x7 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + 7)), keys[0]);
+
+    for (size_t round = 1; round < kAes128Rounds; ++round) {
+      __m128i key = keys[round];
+
+      x0 = _mm_aesenc_si128(x0, key);
+      x1 = _mm_aesenc_si128(x1, key);
+      x2 = _mm_aesenc_si128(x2, key);
+      x3 = _mm_aesenc_si128(x3, key);
+      x4 = _mm_aesenc_si128(x4, key);
+      x5 = _mm_aesenc_si128(x5, key);
+      x6 = _mm_aesenc_si128(x6, key);
+      x7 = _mm_aesenc_si128(x7, key);
+    }
+
+    __m128i last_key = keys[kAes128Rounds];
+
+    x0 = _mm_aesenclast_si128(x0, last_key);
+    x1 = _mm_aesenclast_si128(x1, last_key);
+    x2 = _mm_aesenclast_si128(x2, last_key);
+    x3 = _mm_aesenclast_si128(x3, last_key);
+    x4 = _mm_aesenclast_si128(x4, last_key);
+    x5 = _mm_aesenclast_si128(x5, last_key);
+    x6 = _mm_aesenclast_si128(x6, last_key);
+    x7 = _mm_aesenclast_si128(x7, last_key);
+
+    // Gathers the first byte of each block into the low eight bytes.
+    __m128i x01 = _mm_unpacklo_epi8(x0, x1);
+    __m128i x23 = _mm_unpacklo_epi8(x2, x3);
+    __m128i x45 = _mm_unpacklo_epi8(x4, x5);
+    __m128i x67 = _mm_unpacklo_epi8(x6, x7);
+    __m128i x0123 = _mm_unpacklo_epi16(x01, x23);
+    __m128i x4567 = _mm_unpacklo_epi16(x45, x67);
+
+    u64 stream = (u64)_mm_cvtsi128_si64(_mm_unpacklo_epi32(x0123, x4567));
+    u64 value;
+
+    memcpy(&value, out + i, sizeof(value));
+    value ^= stream;
+    memcpy(out + i, &value, sizeof(value));
+  }
+
+  while (i > 0) {
+    --i;
+
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(blocks + i)), keys[0]);
+
+    for (size_t round = 1; round < kAes128Rounds; ++round) {
+      x = _mm_aesenc_si128(x, keys[round]);
+    }
+
+    x = _mm_aesenclast_si128(x, keys[kAes128Rounds]);
+
+    out[i] ^= (u8)_mm_cvtsi128_si32(x);
+  }
+}
+
+POLYMER_TARGET_AES static void EncryptAesniBytes(Cfb8Cipher& cipher, u8* data, size_t size) {
+  __m128i keys[kAes128Rounds + 1];
+
+  for (size_t i = 0; i <= kAes128Rounds; ++i) {
+    keys[i] = _mm_load_si128((const __m128i*)(cipher.round_keys + i * kAesBlockSize));
+  }
+
+  __m128i shift = _mm_load_si128((const __m128i*)cipher.iv);
+
+  for (size_t i = 0; i < size; ++i) {
+    __m128i x = _mm_xor_si128(shift, keys[0]);
+
+    for (size_t round = 1; round < kAes128Rounds; ++round) {
+      x = _mm_aesenc_si128(x, keys[round]);
+    }
+
+    x = _mm_aesenclast_si128(x, keys[kAes128Rounds]);
+
+    u8 value = data[i] ^ (u8)_mm_cvtsi128_si32(x);
+
+    data[i] = value;
+    shift = _mm_or_si128(_mm_srli_si128(shift, 1), _mm_slli_si128(_mm_cvtsi32_si128(value), 15));
+  }
+
+  _mm_store_si128((__m128i*)cipher.iv, shift);
+}
+
+#endif
+
+bool HasAesInstructions() {
+#ifdef POLYMER_AESNI_KERNELS
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+
+  __cpuid(info, 1);
+  return (info[2] & (1 << 25)) != 0;
+#else
+  return __builtin_cpu_supports("aes");
+#endif
+#else
+  return false;
+#endif
+}
+
+struct CipherKernels {
+  DecryptFunction decrypt;
+  EncryptFunction encrypt;
+};
+
+static CipherKernels SelectKernels() {
+  CipherKernels kernels = {&DecryptPortableBlocks, &EncryptPortableBytes};
+
+#ifdef POLYMER_AESNI_KERNELS
+  if (HasAesInstructions()) {
+    kernels.decrypt = &DecryptAesniBlocks;
+    kernels.encrypt = &EncryptAesniBytes;
+  }
+#endif
+
+  return kernels;
+}
+
+static const CipherKernels g_kernels = SelectKernels();
+
+static void Decrypt(Cfb8Cipher& cipher, u8* data, size_t size, DecryptFunction kernel) {
+  if (size == 0) return;
+
+  // The first block of bytes decrypts with shift registers that start in the previous ciphertext, so they are built
+  // in a scratch block before anything is overwritten.
+  u8 head[kAesBlockSize * 2];
+  size_t head_size = size < kAesBlockSize ? size : kAesBlockSize;
+
+  memcpy(head, cipher.iv, kAesBlockSize);
+  memcpy(head + kAesBlockSize, data, head_size);
+
+  if (size >= kAesBlockSize) {
+    memcpy(cipher.iv, data + size - kAesBlockSize, kAesBlockSize);
+  } else {
+    memcpy(cipher.iv, head + size, kAesBlockSize);
+  }
+
+  // Every later byte decrypts with the 16 bytes of ciphertext right before it. The kernel works backwards, so those
+  // are still in the buffer when it gets to them.
+  if (size > kAesBlockSize) {
+    kernel(cipher, data, data + kAesBlockSize, size - kAesBlockSize);
+  }
+
+  kernel(cipher, head, data, head_size);
+}
+
+void Cfb8Cipher::Initialize(const u8* key, const u8* iv) {
+  u32 words[(kAes128Rounds + 1) * 4];
+
+  ExpandKey(key, words);
+
+  for (size_t i = 0; i < polymer_array_count(words); ++i) {
+    u8* dest = round_keys + i * 4;
+
+    dest[0] = (u8)(words[i] >> 24);
+    dest[1] = (u8)(words[i] >> 16);
+    dest[2] = (u8)(words[i] >> 8);
+    dest[3] = (u8)words[i];
+  }
+
+  memcpy(this->iv, iv, kAesBlockSize);
+}
+
+void Cfb8Cipher::Encrypt(u8* data, size_t size) {
+  g_kernels.encrypt(*this, data, size);
+}
+
+void Cfb8Cipher::Decrypt(u8* data, size_t size) {
+  crypto::Decrypt(*this, data, size, g_kernels.decrypt);
+}
+
+void Cfb8Cipher::EncryptPortable(u8* data, size_t size) {
+  EncryptPortableBytes(*this, data, size);
+}
+
+void Cfb8Cipher::DecryptPortable(u8* data, size_t size) {
+  crypto::Decrypt(*this, data, size, &DecryptPortableBlocks);
+}
+
+// Decrypts in uneven pieces to cover the splits that recv produces.
+static void DecryptSplit(Cfb8Cipher& cipher, u8* data, size_t size, bool portable) {
+  constexpr size_t kSplits[] = {1, 7, 16, 17, 3, 64, 1500, 8191};
+
+  size_t offset = 0;
+
+  for (size_t i = 0; offset < size; ++i) {
+    size_t count = kSplits[i % polymer_array_count(kSplits)];
+    if (count > size - offset) count = size - offset;
+
+    if (portable) {
+      cipher.DecryptPortable(data + offset, count);
+    } else {
+      cipher.Decrypt(data + offset, count);
+    }
+
+    offset += count;
+  }
+}
+
+static float MeasureThroughput(Cfb8Cipher& cipher, u8* data, size_t size, bool decrypt, bool portable) {
+  using namespace std::chrono;
+
+  auto start = steady_clock::now();
+
+  if (decrypt) {
+    portable ? cipher.DecryptPortable(data, size) : cipher.Decrypt(data, size);
+  } else {
+    portable ? cipher.EncryptPortable(data, size) : cipher.Encrypt(data, size);
+  }
+
+  float seconds = duration_cast<duration<float>>(steady_clock::now() - start).count();
+
+  return seconds > 0.0f ? (size / (1024.0f * 1024.0f)) / seconds : 0.0f;
+}
+
+bool RunCipherBenchmark() {
+  // NIST SP 800-38A F.3.7 CFB8-AES128.Encrypt
+  const u8 kKey[] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  const u8 kIv[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+  const u8 kPlaintext[] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9,
+                           0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a, 0xae, 0x2d};
+  const u8 kCiphertext[] = {0x3b, 0x79, 0x42, 0x4c, 0x9c, 0x0d, 0xd4, 0x36, 0xba,
+                            0xce, 0x9e, 0x0e, 0xd4, 0x58, 0x6a, 0x4f, 0x32, 0xb9};
+
+  bool success = true;
+
+  for (int portable = 0; portable < 2; ++portable) {
+    Cfb8Cipher cipher;
+    u8 data[sizeof(kPlaintext)];
+
+    memcpy(data, kPlaintext, sizeof(data));
+    cipher.Initialize(kKey, kIv);
+    portable ? cipher.EncryptPortable(data, sizeof(data)) : cipher.Encrypt(data, sizeof(data));
+
+    if (memcmp(data, kCiphertext, sizeof(data)) != 0) {
+      fprintf(stderr, "cipher: %s encryption doesn't match the test vector.\n", portable ? "Portable" : "Selected");
+      success = false;
+    }
+
+    cipher.Initialize(kKey, kIv);
+    DecryptSplit(cipher, data, sizeof(data), portable);
+
+    if (memcmp(data, kPlaintext, sizeof(data)) != 0) {
+      fprintf(stderr, "cipher: %s decryption doesn't match the test vector.\n", portable ? "Portable" : "Selected");
+      success = false;
+    }
+  }
+
+  constexpr size_t kBenchmarkSize = 16 * 1024 * 1024;
+
+  u8* original = (u8*)malloc(kBenchmarkSize);
+  u8* data = (u8*)malloc(kBenchmarkSize);
+
+  if (!original || !data) {
+    fprintf(stderr, "cipher: Failed to allocate benchmark buffers.\n");
+    free(original);
+    free(data);
+    return false;
+  }
+
+  std::mt19937 rng(0x504F4C59);
+
+  for (size_t i = 0; i < kBenchmarkSize; ++i) {
+    original[i] = (u8)rng();
+  }
+
+  printf("cipher: AES-NI %s.\n", HasAesInstructions() ? "available" : "unavailable");
+
+  for (int portable = 1; portable >= 0; --portable) {
+    const char* name = portable ? "portable" : "selected";
+    Cfb8Cipher encryptor;
+    Cfb8Cipher decryptor;
+
+    memcpy(data, original, kBenchmarkSize);
+
+    encryptor.Initialize(kKey, kIv);
+    decryptor.Initialize(kKey, kIv);
+
+    float encrypt_rate = MeasureThroughput(encryptor, data, kBenchmarkSize, false, portable);
+    float decrypt_rate = MeasureThroughput(decryptor, data, kBenchmarkSize, true, portable);
+
+    printf("cipher: %s encrypt %.1f MB/s, decrypt %.1f MB/s\n", name, encrypt_rate, decrypt_rate);
+
+    if (memcmp(data, original, kBenchmarkSize) != 0) {
+      fprintf(stderr, "cipher: %s round trip doesn't match.\n", name);
+      success = false;
+    }
+  }
+
+  // The kernels have to agree with each other across arbitrary splits of the stream.
+  Cfb8Cipher encryptor;
+  Cfb8Cipher decryptor;
+
+  memcpy(data, original, kBenchmarkSize);
+  encryptor.Initialize(kKey, kIv);
+  decryptor.Initialize(kKey, kIv);
+  encryptor.EncryptPortable(data, kBenchmarkSize);
+  DecryptSplit(decryptor, data, kBenchmarkSize, false);
+
+  if (memcmp(data, original, kBenchmarkSize) != 0) {
+    fprintf(stderr, "cipher: Selected kernels don't match the portable kernels.\n");
+    success = false;
+  }
+
+  free(original);
+  free(data);
+
+  fflush(stdout);
+
+  return success;
+}
+
+} // namespace crypto
+} // namespace polymer
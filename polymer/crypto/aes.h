@@ -0,0 +1,44 @@
+#ifndef POLYMER_CRYPTO_AES_H_
+#define POLYMER_CRYPTO_AES_H_
+
+#include <polymer/types.h>
+
+namespace polymer {
+namespace crypto {
+
+constexpr size_t kAesBlockSize = 16;
+constexpr size_t kAes128KeySize = 16;
+constexpr size_t kAes128Rounds = 10;
+
+// AES-128 in CFB8 mode, which is what the protocol uses once encryption is enabled. The shared secret is both the key
+// and the initial vector, and each direction keeps its own cipher state for the whole connection.
+//
+// CFB8 runs one block encryption per byte. Encrypting is serial because every block depends on the previous output
+// byte, but decrypting only depends on ciphertext that has already been received, so the blocks are independent and
+// the AES-NI kernel keeps eight of them in flight at once.
+struct Cfb8Cipher {
+  // The expanded key in the byte order that AES-NI loads it in.
+  alignas(16) u8 round_keys[(kAes128Rounds + 1) * kAesBlockSize];
+  // The last 16 bytes of ciphertext.
+  alignas(16) u8 iv[kAesBlockSize];
+
+  void Initialize(const u8* key, const u8* iv);
+
+  // Both work in place. Decrypt can be called on any split of the stream.
+  void Encrypt(u8* data, size_t size);
+  void Decrypt(u8* data, size_t size);
+
+  // Same as above, but always uses the portable kernels.
+  void EncryptPortable(u8* data, size_t size);
+  void DecryptPortable(u8* data, size_t size);
+};
+
+bool HasAesInstructions();
+
+// Checks the kernels against the NIST test vector and prints their throughput. Returns false if any kernel is wrong.
+bool RunCipherBenchmark();
+
+} // namespace crypto
+} // namespace polymer
+
+#endif
@@ -0,0 +1,283 @@
+#include <polymer/crypto/rsa.h>
+
+#include <random>
+
+#include <string.h>
+
+namespace polymer {
+namespace crypto {
+
+constexpr u8 kDerInteger = 0x02;
+constexpr u8 kDerBitString = 0x03;
+constexpr u8 kDerObjectId = 0x06;
+constexpr u8 kDerSequence = 0x30;
+
+// 1.2.840.113549.1.1.1
+constexpr u8 kRsaEncryptionId[] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01};
+
+struct DerReader {
+  const u8* data;
+  size_t size;
+  size_t offset;
+
+  DerReader(const u8* data, size_t size) : data(data), size(size), offset(0) {}
+
+  // Reads the next element and points a reader at its contents. Returns false if the tag doesn't match.
+  bool Read(u8 tag, DerReader* contents) {
+    if (offset + 2 > size || data[offset] != tag) return false;
+
+    size_t length = data[offset + 1];
+    offset += 2;
+
+    // Long form lengths store the number of length bytes in the low bits.
+    if (length & 0x80) {
+      size_t length_size = length & 0x7F;
+
+      if (length_size == 0 || length_size > sizeof(u32) || offset + length_size > size) return false;
+
+      length = 0;
+
+      for (size_t i = 0; i < length_size; ++i) {
+        length = (length << 8) | data[offset++];
+      }
+    }
+
+    if (length > size - offset) return false;
+
+    *contents = DerReader(data + offset, length);
+    offset += length;
+
+    return true;
+  }
+
+  // Returns the magnitude of an integer without its leading zeroes.
+  bool ReadInteger(const u8** value, size_t* value_size) {
+    DerReader contents(nullptr, 0);
+
+    if (!Read(kDerInteger, &contents) || contents.size == 0) return false;
+
+    // Public key values are never negative.
+    if (contents.data[0] & 0x80) return false;
+
+    while (contents.size > 0 && contents.data[0] == 0) {
+      ++contents.data;
+      --contents.size;
+    }
+
+    *value = contents.data;
+    *value_size = contents.size;
+
+    return true;
+  }
+};
+
+bool RsaPublicKey::Parse(const u8* der, size_t der_size) {
+  DerReader reader(der, der_size);
+  DerReader info(nullptr, 0);
+  DerReader algorithm(nullptr, 0);
+  DerReader algorithm_id(nullptr, 0);
+  DerReader key_bits(nullptr, 0);
+
+  if (!reader.Read(kDerSequence, &info)) return false;
+  if (!info.Read(kDerSequence, &algorithm)) return false;
+  if (!algorithm.Read(kDerObjectId, &algorithm_id)) return false;
+
+  if (algorithm_id.size != sizeof(kRsaEncryptionId) ||
+      memcmp(algorithm_id.data, kRsaEncryptionId, sizeof(kRsaEncryptionId)) != 0) {
+    return false;
+  }
+
+  // The key is wrapped in a bit string that starts with the count of unused bits.
+  if (!info.Read(kDerBitString, &key_bits) || key_bits.size == 0 || key_bits.data[0] != 0) return false;
+
+  DerReader key_reader(key_bits.data + 1, key_bits.size - 1);
+  DerReader key(nullptr, 0);
+
+  if (!key_reader.Read(kDerSequence, &key)) return false;
+
+  const u8* modulus_bytes = nullptr;
+  size_t modulus_size = 0;
+  const u8* exponent_bytes = nullptr;
+  size_t exponent_size = 0;
+
+  if (!key.ReadInteger(&modulus_bytes, &modulus_size)) return false;
+  if (!key.ReadInteger(&exponent_bytes, &exponent_size)) return false;
+
+  if (modulus_size == 0 || modulus_size > kMaxBits / 8) return false;
+  if (exponent_size == 0 || exponent_size > sizeof(u32)) return false;
+
+  // Montgomery multiplication needs an odd modulus, which every real RSA modulus is.
+  if (!(modulus_bytes[modulus_size - 1] & 1)) return false;
+
+  memset(modulus, 0, sizeof(modulus));
+
+  for (size_t i = 0; i < modulus_size; ++i) {
+    size_t byte_index = modulus_size - 1 - i;
+
+    modulus[i / 4] |= (u32)modulus_bytes[byte_index] << ((i % 4) * 8);
+  }
+
+  size = modulus_size;
+  limb_count = (modulus_size + 3) / 4;
+  exponent = 0;
+
+  for (size_t i = 0; i < exponent_size; ++i) {
+    exponent = (exponent << 8) | exponent_bytes[i];
+  }
+
+  return true;
+}
+
+// Returns true if a >= b.
+static bool IsGreaterOrEqual(const u32* a, const u32* b, size_t count) {
+  for (size_t i = count; i > 0; --i) {
+    if (a[i - 1] != b[i - 1]) return a[i - 1] > b[i - 1];
+  }
+
+  return true;
+}
+
+// Returns the borrow out of the top limb.
+static u32 Subtract(u32* a, const u32* b, size_t count) {
+  u64 borrow = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    u64 difference = (u64)a[i] - b[i] - borrow;
+
+    a[i] = (u32)difference;
+    borrow = (difference >> 32) & 1;
+  }
+
+  return (u32)borrow;
+}
+
+// Computes a * b / R mod n with R = 2^(32 * count).
+static void MontgomeryMultiply(const u32* a, const u32* b, const u32* n, u32 n_inverse, size_t count, u32* out) {
+  u32 t[RsaPublicKey::kMaxLimbs + 2] = {};
+
+  for (size_t i = 0; i < count; ++i) {
+    u64 carry = 0;
+
+    for (size_t j = 0; j < count; ++j) {
+      carry += t[j] + (u64)a[j] * b[i];
+      t[j] = (u32)carry;
+      carry >>= 32;
+    }
+
+    carry += t[count];
+    t[count] = (u32)carry;
+    t[count + 1] = (u32)(carry >> 32);
+
+    // Adding m * n clears the low limb, so the sum can be shifted down a limb.
+    u32 m = t[0] * n_inverse;
+
+    carry = (t[0] + (u64)m * n[0]) >> 32;
+
+    for (size_t j = 1; j < count; ++j) {
+      carry += t[j] + (u64)m * n[j];
+      t[j - 1] = (u32)carry;
+      carry >>= 32;
+    }
+
+    carry += t[count];
+    t[count - 1] = (u32)carry;
+    t[count] = t[count + 1] + (u32)(carry >> 32);
+  }
+
+  if (t[count] != 0 || IsGreaterOrEqual(t, n, count)) {
+    t[count] -= Subtract(t, n, count);
+  }
+
+  memcpy(out, t, count * sizeof(u32));
+}
+
+bool RsaPublicKey::Encrypt(const u8* data, size_t data_size, u8* out) const {
+  // The padding is 0x00 0x02, at least eight non-zero random bytes, then a zero byte before the data.
+  if (data_size + 11 > size) return false;
+
+  u8 message[kMaxBits / 8];
+  size_t padding_size = size - data_size - 3;
+
+  std::random_device device;
+  std::uniform_int_distribution<u32> distribution(1, 255);
+
+  message[0] = 0x00;
+  message[1] = 0x02;
+
+  for (size_t i = 0; i < padding_size; ++i) {
+    message[2 + i] = (u8)distribution(device);
+  }
+
+  message[2 + padding_size] = 0x00;
+  memcpy(message + 3 + padding_size, data, data_size);
+
+  size_t count = limb_count;
+  u32 value[kMaxLimbs] = {};
+
+  for (size_t i = 0; i < size; ++i) {
+    value[i / 4] |= (u32)message[size - 1 - i] << ((i % 4) * 8);
+  }
+
+  // -n^-1 mod 2^32 by Newton's method. Each step doubles the number of correct bits.
+  u32 inverse = 1;
+
+  for (size_t i = 0; i < 5; ++i) {
+    inverse *= 2 - modulus[0] * inverse;
+  }
+
+  u32 n_inverse = (u32)0 - inverse;
+
+  // R^2 mod n is built by doubling one until it has been multiplied by R twice.
+  u32 r_squared[kMaxLimbs + 1] = {1};
+
+  for (size_t i = 0; i < count * 64; ++i) {
+    u32 carry = 0;
+
+    for (size_t j = 0; j < count; ++j) {
+      u32 next_carry = r_squared[j] >> 31;
+
+      r_squared[j] = (r_squared[j] << 1) | carry;
+      carry = next_carry;
+    }
+
+    r_squared[count] = carry;
+
+    if (carry || IsGreaterOrEqual(r_squared, modulus, count)) {
+      r_squared[count] -= Subtract(r_squared, modulus, count);
+    }
+  }
+
+  u32 base[kMaxLimbs];
+  u32 result[kMaxLimbs];
+
+  MontgomeryMultiply(value, r_squared, modulus, n_inverse, count, base);
+  memcpy(result, base, count * sizeof(u32));
+
+  // Left to right square and multiply, starting below the top bit since the result already holds the base.
+  int top_bit = 31;
+
+  while (top_bit > 0 && !(exponent & (1u << top_bit))) {
+    --top_bit;
+  }
+
+  for (int bit = top_bit - 1; bit >= 0; --bit) {
+    MontgomeryMultiply(result, result, modulus, n_inverse, count, result);
+
+    if (exponent & (1u << bit)) {
+      MontgomeryMultiply(result, base, modulus, n_inverse, count, result);
+    }
+  }
+
+  u32 one[kMaxLimbs] = {1};
+
+  MontgomeryMultiply(result, one, modulus, n_inverse, count, result);
+
+  for (size_t i = 0; i < size; ++i) {
+    out[size - 1 - i] = (u8)(result[i / 4] >> ((i % 4) * 8));
+  }
+
+  return true;
+}
+
+} // namespace crypto
+} // namespace polymer
@@ -0,0 +1,32 @@
+#ifndef POLYMER_CRYPTO_RSA_H_
+#define POLYMER_CRYPTO_RSA_H_
+
+#include <polymer/types.h>
+
+namespace polymer {
+namespace crypto {
+
+// Only the public key operation is needed to send the shared secret to the server.
+struct RsaPublicKey {
+  constexpr static size_t kMaxBits = 4096;
+  constexpr static size_t kMaxLimbs = kMaxBits / 32;
+
+  // Little-endian 32-bit limbs.
+  u32 modulus[kMaxLimbs];
+  size_t limb_count;
+  // Size of the modulus in bytes, which is also the size of every encrypted message.
+  size_t size;
+  u32 exponent;
+
+  // Parses a DER encoded SubjectPublicKeyInfo, which is how the server sends its key.
+  bool Parse(const u8* der, size_t der_size);
+
+  // Encrypts data with PKCS#1 v1.5 padding. The output is always size bytes.
+  // Returns false if the data is too long for the key.
+  bool Encrypt(const u8* data, size_t data_size, u8* out) const;
+};
+
+} // namespace crypto
+} // namespace polymer
+
+#endif
@@ -0,0 +1,141 @@
+#include <polymer/crypto/sha1.h>
+
+namespace polymer {
+namespace crypto {
+
+static inline u32 RotateLeft(u32 value, u32 shift) {
+  return (value << shift) | (value >> (32 - shift));
+}
+
+static void ProcessBlock(u32* state, const u8* block) {
+  u32 w[80];
+
+  for (size_t i = 0; i < 16; ++i) {
+    w[i] = ((u32)block[i * 4] << 24) | ((u32)block[i * 4 + 1] << 16) | ((u32)block[i * 4 + 2] << 8) |
+           (u32)block[i * 4 + 3];
+  }
+
+  for (size_t i = 16; i < 80; ++i) {
+    w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+
+  u32 a = state[0];
+  u32 b = state[1];
+  u32 c = state[2];
+  u32 d = state[3];
+  u32 e = state[4];
+
+  for (size_t i = 0; i < 80; ++i) {
+    u32 f;
+    u32 k;
+
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+
+    u32 temp = RotateLeft(a, 5) + f + e + k + w[i];
+
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = temp;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+Sha1::Sha1() : state{0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0}, length(0), block_size(0) {}
+
+void Sha1::Update(const u8* data, size_t size) {
+  length += size;
+
+  while (size > 0) {
+    size_t count = sizeof(block) - block_size;
+    if (count > size) count = size;
+
+    memcpy(block + block_size, data, count);
+    block_size += count;
+    data += count;
+    size -= count;
+
+    if (block_size == sizeof(block)) {
+      ProcessBlock(state, block);
+      block_size = 0;
+    }
+  }
+}
+
+void Sha1::Final(u8* digest) {
+  u64 bit_length = length * 8;
+  u8 padding[sizeof(block) + 8] = {0x80};
+  size_t padding_size = (block_size < 56 ? 56 : 120) - block_size;
+
+  Update(padding, padding_size);
+
+  for (size_t i = 0; i < 8; ++i) {
+    padding[i] = (u8)(bit_length >> (56 - i * 8));
+  }
+
+  Update(padding, 8);
+
+  for (size_t i = 0; i < 5; ++i) {
+    digest[i * 4] = (u8)(state[i] >> 24);
+    digest[i * 4 + 1] = (u8)(state[i] >> 16);
+    digest[i * 4 + 2] = (u8)(state[i] >> 8);
+    digest[i * 4 + 3] = (u8)state[i];
+  }
+}
+
+void FormatServerHash(const u8* digest, char* out) {
+  constexpr const char* kHex = "0123456789abcdef";
+
+  u8 value[kSha1DigestSize];
+  bool negative = (digest[0] & 0x80) != 0;
+
+  memcpy(value, digest, kSha1DigestSize);
+
+  // Negative digests are printed as their magnitude with a minus sign, so take the two's complement.
+  if (negative) {
+    u32 carry = 1;
+
+    for (size_t i = kSha1DigestSize; i > 0; --i) {
+      u32 sum = (u32)(u8)~value[i - 1] + carry;
+
+      value[i - 1] = (u8)sum;
+      carry = sum >> 8;
+    }
+
+    *out++ = '-';
+  }
+
+  bool leading = true;
+
+  for (size_t i = 0; i < kSha1DigestSize * 2; ++i) {
+    u8 nibble = (value[i / 2] >> ((i % 2) ? 0 : 4)) & 0x0F;
+
+    if (leading && nibble == 0 && i + 1 < kSha1DigestSize * 2) continue;
+
+    leading = false;
+    *out++ = kHex[nibble];
+  }
+
+  *out = 0;
+}
+
+} // namespace crypto
+} // namespace polymer
@@ -0,0 +1,30 @@
+#ifndef POLYMER_CRYPTO_SHA1_H_
+#define POLYMER_CRYPTO_SHA1_H_
+
+#include <polymer/types.h>
+
+namespace polymer {
+namespace crypto {
+
+constexpr size_t kSha1DigestSize = 20;
+
+struct Sha1 {
+  u32 state[5];
+  u64 length;
+  u8 block[64];
+  size_t block_size;
+
+  Sha1();
+
+  void Update(const u8* data, size_t size);
+  void Final(u8* digest);
+};
+
+// Formats a digest the way the session server expects it, as a signed big-endian number in lowercase hex without
+// leading zeroes. The output needs room for 42 characters including the terminator.
+void FormatServerHash(const u8* digest, char* out);
+
+} // namespace crypto
+} // namespace polymer
+
+#endif
@@ -0,0 +1,315 @@
+#include <polymer/decode_pipeline.h>
+
+#include <lib/miniz.h>
+#include <polymer/capture.h>
+#include <polymer/nbt.h>
+#include <polymer/world/paletted_container.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+namespace polymer {
+
+static bool ReadPacketId(u8* payload, size_t payload_size, size_t view_size, u64* pkt_id) {
+  // Packet payloads live in the mirrored packet queue, so the view never needs to wrap.
+  RingBuffer rb(payload, view_size);
+
+  rb.write_offset = payload_size;
+
+  return payload_size > 0 && rb.ReadVarInt(pkt_id);
+}
+
+void DecodePipeline::Start(PacketQueue& queue, ProtocolState state, size_t worker_count) {
+  if (worker_count < 1) worker_count = 1;
+  if (worker_count > kMaxWorkers) worker_count = kMaxWorkers;
+
+  this->queue = &queue;
+  this->state = state;
+  this->submit_index = this->commit_index = 0;
+  this->work_read = this->work_write = 0;
+  this->worker_count = worker_count;
+  this->running = true;
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    if (!worker_arenas[i].base) {
+      worker_arenas[i] = CreateArena(kWorkerArenaSize);
+    }
+
+    workers[i] = std::thread([this, i]() { RunWorker(i); });
+  }
+}
+
+void DecodePipeline::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(work_mutex);
+    running = false;
+  }
+
+  work_cv.notify_all();
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    if (workers[i].joinable()) {
+      workers[i].join();
+    }
+  }
+
+  worker_count = 0;
+
+  // Drop anything that was never committed.
+  for (; commit_index != submit_index; ++commit_index) {
+    Job& job = jobs[commit_index % kMaxJobs];
+
+    ReleaseDecode(job.decode);
+    job.decode = nullptr;
+    job.state.store(JobState::Free, std::memory_order_relaxed);
+  }
+}
+
+bool DecodePipeline::Submit(u8* source, size_t source_size, size_t data_size, size_t source_offset) {
+  if (submit_index - commit_index >= kMaxJobs) return false;
+
+  u8* dest = queue->Reserve(data_size > 0 ? data_size : source_size);
+  if (!dest) return false;
+
+  size_t job_index = submit_index % kMaxJobs;
+  Job& job = jobs[job_index];
+
+  job.source = source;
+  job.source_size = source_size;
+  job.source_offset = source_offset;
+  job.data_size = data_size;
+  job.receive_time = capture ? capture->GetTimestamp() : 0;
+  job.dest = dest;
+  job.dest_size = 0;
+  job.decode = nullptr;
+
+  ++submit_index;
+
+  if (data_size == 0) {
+    memcpy(dest, source, source_size);
+    job.dest_size = source_size;
+
+    u64 pkt_id = 0;
+
+    // Uncompressed packets are ready now unless they have chunk data to decode.
+    if (!ReadPacketId(dest, source_size, queue->size, &pkt_id) ||
+        pkt_id != (u64)inbound::play::ProtocolId::ChunkData) {
+      job.state.store(JobState::Complete, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  job.state.store(JobState::Queued, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(work_mutex);
+    work[work_write++ % kMaxJobs] = job_index;
+  }
+
+  work_cv.notify_one();
+
+  return true;
+}
+
+size_t DecodePipeline::Commit() {
+  size_t count = 0;
+
+  while (commit_index != submit_index) {
+    Job& job = jobs[commit_index % kMaxJobs];
+
+    if (job.state.load(std::memory_order_acquire) != JobState::Complete) break;
+
+    ChunkDataDecode* decode = job.decode;
+    u64 pkt_id = 0;
+
+    if (capture) {
+      // The source is still retained in the read buffer until the packet is committed.
+      capture->WritePacket(job.receive_time, state, job.source, job.source_size, job.data_size);
+    }
+
+    if (ReadPacketId(job.dest, job.dest_size, queue->size, &pkt_id)) {
+      // Workers decode anything with the ChunkData id because they don't know the state of the packet.
+      if (state != ProtocolState::Play) {
+        ReleaseDecode(decode);
+        decode = nullptr;
+      }
+
+      // Follow the state transitions that the server makes so the next packets are tagged correctly.
+      if (state == ProtocolState::Login && pkt_id == (u64)inbound::login::ProtocolId::LoginSuccess) {
+        state = ProtocolState::Configuration;
+      } else if (state == ProtocolState::Configuration && pkt_id == (u64)inbound::configuration::ProtocolId::Finish) {
+        state = ProtocolState::Play;
+      } else if (state == ProtocolState::Play && pkt_id == (u64)inbound::play::ProtocolId::StartConfiguration) {
+        state = ProtocolState::Configuration;
+      }
+    }
+
+    // Packets that failed to decode are published empty so the ordering stays intact.
+    queue->Publish(job.dest_size, job.source_size, decode);
+
+    job.decode = nullptr;
+    job.state.store(JobState::Free, std::memory_order_relaxed);
+
+    ++commit_index;
+    ++count;
+  }
+
+  return count;
+}
+
+size_t DecodePipeline::GetRetainedOffset(size_t read_offset) const {
+  if (commit_index == submit_index) return read_offset;
+
+  return jobs[commit_index % kMaxJobs].source_offset;
+}
+
+void DecodePipeline::Release(void* attachment) {
+  ReleaseDecode((ChunkDataDecode*)attachment);
+}
+
+void DecodePipeline::ReleaseDecode(ChunkDataDecode* decode) {
+  if (!decode) return;
+
+  std::lock_guard<std::mutex> lock(pool_mutex);
+
+  for (size_t i = 0; i < decode->section_count; ++i) {
+    if (decode->sections[i].decoded) {
+      section_pool.Free(decode->sections[i].decoded);
+    }
+  }
+
+  decode_pool.Free(decode);
+}
+
+void DecodePipeline::RunWorker(size_t worker_index) {
+  MemoryArena& arena = worker_arenas[worker_index];
+
+  while (true) {
+    size_t job_index = 0;
+
+    {
+      std::unique_lock<std::mutex> lock(work_mutex);
+
+      work_cv.wait(lock, [this]() { return !running || work_read != work_write; });
+
+      if (!running) break;
+
+      job_index = work[work_read++ % kMaxJobs];
+    }
+
+    Job& job = jobs[job_index];
+
+    Process(job, arena);
+    arena.Reset();
+
+    job.state.store(JobState::Complete, std::memory_order_release);
+  }
+}
+
+void DecodePipeline::Process(Job& job, MemoryArena& arena) {
+  if (job.data_size > 0) {
+    mz_ulong mz_size = (mz_ulong)job.data_size;
+
+    // The connection read buffer is mirrored in virtual memory, so it is free to read off the end of the buffer for
+    // uncompressing.
+    int result = mz_uncompress(job.dest, &mz_size, job.source, (mz_ulong)job.source_size);
+
+    if (result != MZ_OK) {
+      fprintf(stderr, "Failed to decompress packet. Skipping.\n");
+      fflush(stderr);
+      job.dest_size = 0;
+      return;
+    }
+
+    job.dest_size = mz_size;
+  }
+
+  RingBuffer rb(job.dest, queue->size);
+  u64 pkt_id = 0;
+
+  rb.write_offset = job.dest_size;
+
+  if (rb.ReadVarInt(&pkt_id) && pkt_id == (u64)inbound::play::ProtocolId::ChunkData) {
+    job.decode = DecodeChunkData(rb, arena);
+  }
+}
+
+ChunkDataDecode* DecodePipeline::DecodeChunkData(RingBuffer& rb, MemoryArena& arena) {
+  if (rb.GetReadAmount() < 8) return nullptr;
+
+  // Skip the chunk coordinates.
+  rb.read_offset += 8;
+
+  // Heightmaps aren't used yet.
+  if (!nbt::Skip(true, rb)) return nullptr;
+
+  u64 data_size = 0;
+
+  if (!rb.ReadVarInt(&data_size) || rb.GetReadAmount() < data_size) return nullptr;
+
+  size_t end = rb.read_offset + (size_t)data_size;
+
+  ChunkDataDecode* decode = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    decode = decode_pool.Allocate();
+  }
+
+  if (!decode) return nullptr;
+
+  decode->section_count = 0;
+
+  u32* scratch = memory_arena_push_type_count(&arena, u32, world::kChunkBlockCount);
+
+  while (decode->section_count < kMaxDecodedSections && rb.read_offset + 3 <= end) {
+    ChunkDataDecode::Section* section = decode->sections + decode->section_count;
+
+    section->decoded = nullptr;
+
+    u16 block_count = rb.ReadU16();
+
+    world::PalettedContainer blocks;
+
+    if (!blocks.Read(rb, world::PalettedContainerType::Blocks) || rb.read_offset > end) break;
+
+    section->block_count = block_count;
+    section->single_value = blocks.IsSingleValue() ? blocks.GetSingleValue() : 0;
+
+    if (block_count > 0 && !blocks.IsSingleValue()) {
+      {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        section->decoded = section_pool.Allocate();
+      }
+
+      if (!section->decoded) break;
+
+      section->decoded->Build(blocks, scratch);
+    }
+
+    // Biomes aren't stored yet, so they only need to be skipped.
+    if (!world::PalettedContainer::Skip(rb, world::PalettedContainerType::Biomes) || rb.read_offset > end) break;
+
+    ++decode->section_count;
+  }
+
+  // A section that failed part way through might have grabbed a decoded block array.
+  if (decode->section_count < kMaxDecodedSections) {
+    ChunkDataDecode::Section* partial = decode->sections + decode->section_count;
+
+    if (partial->decoded) {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      section_pool.Free(partial->decoded);
+      partial->decoded = nullptr;
+    }
+  }
+
+  if (decode->section_count == 0) {
+    ReleaseDecode(decode);
+    return nullptr;
+  }
+
+  return decode;
+}
+
+} // namespace polymer
@@ -0,0 +1,121 @@
+#ifndef POLYMER_DECODE_PIPELINE_H_
+#define POLYMER_DECODE_PIPELINE_H_
+
+#include <polymer/buffer.h>
+#include <polymer/memory.h>
+#include <polymer/packet_queue.h>
+#include <polymer/protocol.h>
+#include <polymer/types.h>
+#include <polymer/world/chunk_storage.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace polymer {
+
+struct PacketCapture;
+
+// This matches the number of chunk sections stored per column in the world.
+constexpr size_t kMaxDecodedSections = 24;
+
+// Attached to ChunkData packets that were pre-decoded by a pipeline worker.
+// The sections are in the order they were sent, starting at the bottom of the dimension.
+struct ChunkDataDecode {
+  struct Section {
+    u16 block_count;
+    u32 single_value;
+    // Null when the section is empty or filled with a single block.
+    world::ChunkBlockData* decoded;
+  };
+
+  size_t section_count;
+  Section sections[kMaxDecodedSections];
+};
+
+// Inflates compressed packets and pre-decodes chunk data on a pool of worker threads.
+// The network thread submits framed packets and commits finished ones to the packet queue in the order they were
+// submitted, so the game thread still sees the exact order the server sent.
+struct DecodePipeline {
+  constexpr static size_t kMaxJobs = 64;
+  constexpr static size_t kMaxWorkers = 8;
+  constexpr static size_t kWorkerArenaSize = Megabytes(1);
+
+  // Committed packets are written here when set. This must be set before the pipeline is started.
+  PacketCapture* capture = nullptr;
+
+  void Start(PacketQueue& queue, ProtocolState state, size_t worker_count);
+  void Stop();
+
+  // Network thread: queues a framed packet. The source must stay valid until the packet is committed.
+  // A data_size of zero means the source is uncompressed and it gets copied immediately.
+  // Returns false if every job is in use or the packet queue is full.
+  bool Submit(u8* source, size_t source_size, size_t data_size, size_t source_offset);
+
+  // Network thread: publishes finished jobs to the packet queue in submission order. Returns the committed count.
+  size_t Commit();
+
+  // Network thread: read buffer offset that must be kept for jobs that haven't been committed yet.
+  size_t GetRetainedOffset(size_t read_offset) const;
+
+  // Network thread: returns true once every submitted packet has been committed.
+  inline bool IsIdle() const {
+    return commit_index == submit_index;
+  }
+
+  // Game thread: returns the decoded data attached to a packet once it has been interpreted.
+  void Release(void* attachment);
+
+private:
+  enum class JobState : u32 { Free, Queued, Complete };
+
+  struct Job {
+    std::atomic<JobState> state{JobState::Free};
+
+    u8* source;
+    size_t source_size;
+    size_t source_offset;
+    size_t data_size;
+    // Capture timestamp of when the packet was framed.
+    u64 receive_time;
+
+    u8* dest;
+    size_t dest_size;
+
+    ChunkDataDecode* decode;
+  };
+
+  void RunWorker(size_t worker_index);
+  void Process(Job& job, MemoryArena& arena);
+  ChunkDataDecode* DecodeChunkData(RingBuffer& rb, MemoryArena& arena);
+  void ReleaseDecode(ChunkDataDecode* decode);
+
+  PacketQueue* queue = nullptr;
+
+  Job jobs[kMaxJobs];
+  size_t submit_index = 0;
+  size_t commit_index = 0;
+
+  // Protocol state of the committed packets. This can run ahead of the game thread's state.
+  ProtocolState state = ProtocolState::Login;
+
+  std::thread workers[kMaxWorkers];
+  MemoryArena worker_arenas[kMaxWorkers];
+  size_t worker_count = 0;
+  bool running = false;
+
+  std::mutex work_mutex;
+  std::condition_variable work_cv;
+  size_t work[kMaxJobs];
+  size_t work_read = 0;
+  size_t work_write = 0;
+
+  std::mutex pool_mutex;
+  MemoryPool<world::ChunkBlockData> section_pool;
+  MemoryPool<ChunkDataDecode> decode_pool;
+};
+
+} // namespace polymer
+
+#endif
@@ -92,7 +92,7 @@ void OnSwapchainCleanup(render::Swapchain& swapchain, void* user_data) {
 
 GameState::GameState(render::VulkanRenderer* renderer, MemoryArena* perm_arena, MemoryArena* trans_arena)
     : perm_arena(perm_arena), trans_arena(trans_arena), connection(*perm_arena), renderer(renderer),
-      block_registry(*perm_arena), assets(), world(*trans_arena, *renderer, assets, block_registry),
+      block_registry(*perm_arena), assets(), world(*trans_arena, *renderer, assets, block_registry, dimension),
       chat_window(*trans_arena) {
   camera.near = 0.1f;
   camera.far = 1024.0f;
@@ -314,6 +314,10 @@ void GameState::OnBlockChange(s32 x, s32 y, s32 z, u32 new_bid) {
   world.OnBlockChange(x, y, z, new_bid);
 }
 
+void GameState::OnSectionBlockChanges(s32 chunk_x, s32 chunk_y, s32 chunk_z, const u64* records, size_t count) {
+  world.OnSectionBlockChanges(chunk_x, chunk_y, chunk_z, records, count);
+}
+
 void PlayerManager::AddPlayer(const String& name, const String& uuid, u8 ping, u8 gamemode) {
   Player* new_player = nullptr;
 
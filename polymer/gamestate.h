@@ -76,6 +76,7 @@ struct GameState {
   GameState(render::VulkanRenderer* renderer, MemoryArena* perm_arena, MemoryArena* trans_arena);
 
   void OnBlockChange(s32 x, s32 y, s32 z, u32 new_bid);
+  void OnSectionBlockChanges(s32 chunk_x, s32 chunk_y, s32 chunk_z, const u64* records, size_t count);
   void OnChunkLoad(s32 chunk_x, s32 chunk_z);
   void OnChunkUnload(s32 chunk_x, s32 chunk_z);
   void OnPlayerPositionAndLook(const Vector3f& position, const Vector3f& velocity, float yaw, float pitch, u32 flags);
@@ -12,6 +12,7 @@ struct InputState {
   bool fall;
   bool sprint;
   bool display_players;
+  bool display_packet_stats;
 };
 
 } // namespace polymer
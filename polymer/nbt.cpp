@@ -9,14 +9,54 @@
 namespace polymer {
 namespace nbt {
 
-bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena);
+constexpr size_t kMaxDepth = 512;
+
+// Tags of the compounds that are still being parsed are collected here, so each compound can be allocated at its final
+// size once its end tag is reached. Nested compounds push on top of their parent's tags and pop them when done.
+struct ParseContext {
+  Tag pending[kMaxTags];
+  size_t pending_count;
+  size_t depth;
+};
+
+bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena, ParseContext& context);
+
+// FNV-1a
+static inline u32 HashName(const char* name, size_t length) {
+  u32 hash = 2166136261u;
+
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ (u8)name[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+static inline bool IsTagNamed(const Tag& tag, const String& str) {
+  return tag.name_length == str.size && memcmp(tag.name, str.data, str.size) == 0;
+}
 
 Tag* TagCompound::GetNamedTag(const String& str) {
+  if (index) {
+    size_t slot = HashName(str.data, str.size) & index_mask;
+
+    while (index[slot]) {
+      Tag* tag = tags + index[slot] - 1;
+
+      if (IsTagNamed(*tag, str)) {
+        return tag;
+      }
+
+      slot = (slot + 1) & index_mask;
+    }
+
+    return nullptr;
+  }
+
   for (size_t i = 0; i < ntags; ++i) {
     Tag* tag = tags + i;
-    String tag_name(tag->name, tag->name_length);
 
-    if (poly_strcmp(str, tag_name) == 0) {
+    if (IsTagNamed(*tag, str)) {
       return tag;
     }
   }
@@ -24,6 +64,35 @@ Tag* TagCompound::GetNamedTag(const String& str) {
   return nullptr;
 }
 
+static bool BuildIndex(TagCompound& compound, MemoryArena& arena) {
+  size_t capacity = kIndexedTagCount;
+
+  // Keep the table at most half full so probes stay short.
+  while (capacity < compound.ntags * 2) {
+    capacity *= 2;
+  }
+
+  compound.index = (u16*)arena.Allocate(capacity * sizeof(u16), alignof(u16));
+  if (!compound.index) return false;
+
+  compound.index_mask = capacity - 1;
+  memset(compound.index, 0, capacity * sizeof(u16));
+
+  // Tags are inserted in order, so the first tag with a duplicated name is found first like the linear search.
+  for (size_t i = 0; i < compound.ntags; ++i) {
+    Tag* tag = compound.tags + i;
+    size_t slot = HashName(tag->name, tag->name_length) & compound.index_mask;
+
+    while (compound.index[slot]) {
+      slot = (slot + 1) & compound.index_mask;
+    }
+
+    compound.index[slot] = (u16)(i + 1);
+  }
+
+  return true;
+}
+
 bool ReadLengthString(RingBuffer& rb, char** data, size_t* size, MemoryArena& arena) {
   u16 length;
 
@@ -34,6 +103,13 @@ bool ReadLengthString(RingBuffer& rb, char** data, size_t* size, MemoryArena& ar
   length = rb.ReadU16();
 
   *size = length;
+
+  // Mirrored buffers can point directly at the string instead of copying it out.
+  if (rb.mirrored) {
+    *data = (char*)rb.ReadSpan(*size);
+    return *data != nullptr;
+  }
+
   *data = (char*)arena.Allocate(*size);
 
   String str;
@@ -49,11 +125,22 @@ bool ReadLengthString(RingBuffer& rb, char** data, size_t* size, MemoryArena& ar
   return true;
 }
 
-bool ParseCompound(RingBuffer& rb, TagCompound& compound, MemoryArena& arena) {
+bool ParseCompound(RingBuffer& rb, TagCompound& compound, MemoryArena& arena, ParseContext& context) {
+  compound.tags = NULL;
   compound.ntags = 0;
+  compound.index = NULL;
+  compound.index_mask = 0;
 
+  if (context.depth >= kMaxDepth) {
+    fprintf(stderr, "NBT is nested too deeply.\n");
+    return false;
+  }
+
+  size_t start = context.pending_count;
   TagType type = TagType::Unknown;
 
+  ++context.depth;
+
   while (type != TagType::End) {
     if (rb.GetReadAmount() < 1) {
       return false;
@@ -65,7 +152,12 @@ bool ParseCompound(RingBuffer& rb, TagCompound& compound, MemoryArena& arena) {
       break;
     }
 
-    Tag* tag = compound.tags + compound.ntags++;
+    if (context.pending_count >= kMaxTags) {
+      fprintf(stderr, "NBT has too many tags.\n");
+      return false;
+    }
+
+    Tag* tag = context.pending + context.pending_count++;
 
     tag->tag = NULL;
     tag->type = type;
@@ -74,15 +166,31 @@ bool ParseCompound(RingBuffer& rb, TagCompound& compound, MemoryArena& arena) {
       return false;
     }
 
-    if (!ParseTag(rb, *tag, arena)) {
+    if (!ParseTag(rb, *tag, arena, context)) {
       return false;
     }
   }
 
+  --context.depth;
+
+  compound.ntags = context.pending_count - start;
+  context.pending_count = start;
+
+  if (compound.ntags > 0) {
+    compound.tags = (Tag*)arena.Allocate(compound.ntags * sizeof(Tag), alignof(Tag));
+    if (!compound.tags) return false;
+
+    memcpy(compound.tags, context.pending + start, compound.ntags * sizeof(Tag));
+  }
+
+  if (compound.ntags >= kIndexedTagCount) {
+    return BuildIndex(compound, arena);
+  }
+
   return true;
 }
 
-bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
+bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena, ParseContext& context) {
   switch (tag.type) {
   case TagType::End: {
   } break;
@@ -168,6 +276,12 @@ bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
       return false;
     }
 
+    if (rb.mirrored) {
+      byte_array_tag->data = (s8*)rb.ReadSpan(byte_array_tag->length);
+      tag.tag = byte_array_tag;
+      break;
+    }
+
     byte_array_tag->data = (s8*)arena.Allocate(byte_array_tag->length * sizeof(u8));
 
     // Read all of the contained bytes in one read.
@@ -201,11 +315,19 @@ bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
     list_tag->type = (TagType)rb.ReadU8();
     list_tag->length = rb.ReadU32();
 
+    if (context.depth >= kMaxDepth) {
+      fprintf(stderr, "NBT is nested too deeply.\n");
+      return false;
+    }
+
     if (list_tag->length > 0) {
       // Allocate space for all of the tags.
-      list_tag->tags = memory_arena_push_type_count(&arena, Tag, list_tag->length);
+      list_tag->tags = (Tag*)arena.Allocate(list_tag->length * sizeof(Tag), alignof(Tag));
+      if (!list_tag->tags) return false;
     }
 
+    ++context.depth;
+
     for (size_t i = 0; i < list_tag->length; ++i) {
       Tag* data_tag = list_tag->tags + i;
 
@@ -213,25 +335,25 @@ bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
       data_tag->name_length = 0;
       data_tag->type = list_tag->type;
 
-      // TODO: This probably shouldn't be called recursively otherwise bad
-      // actors could blow out the stack with nested lists.
-      if (!ParseTag(rb, *data_tag, arena)) {
+      if (!ParseTag(rb, *data_tag, arena, context)) {
         return false;
       }
     }
 
+    --context.depth;
+
     tag.tag = list_tag;
   } break;
   case TagType::Compound: {
-    TagCompound* compound_tag = memory_arena_push_type(&arena, TagCompound);
+    TagCompound* compound_tag = (TagCompound*)arena.Allocate(sizeof(TagCompound), alignof(TagCompound));
+
+    if (!compound_tag) return false;
 
     compound_tag->name = NULL;
     compound_tag->name_length = 0;
-    compound_tag->ntags = 0;
 
-    // TODO: This probably shouldn't be called recursively otherwise bad
-    // actors could blow out the stack with nested lists.
-    if (!ParseCompound(rb, *compound_tag, arena)) {
+    // Recursion is bounded by the depth limit in the context.
+    if (!ParseCompound(rb, *compound_tag, arena, context)) {
       return false;
     }
 
@@ -251,6 +373,19 @@ bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
 
     int_array_tag->data = memory_arena_push_type_count(&arena, s32, int_array_tag->length);
 
+    if (rb.mirrored) {
+      u8* span = rb.ReadSpan(int_array_tag->length * sizeof(u32));
+
+      if (!span) return false;
+
+      for (size_t i = 0; i < int_array_tag->length; ++i) {
+        int_array_tag->data[i] = (s32)LoadBigEndianU32(span + i * sizeof(u32));
+      }
+
+      tag.tag = int_array_tag;
+      break;
+    }
+
     for (size_t i = 0; i < int_array_tag->length; ++i) {
       s32* int_data = int_array_tag->data + i;
 
@@ -277,6 +412,19 @@ bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
 
     long_array_tag->data = memory_arena_push_type_count(&arena, s64, long_array_tag->length);
 
+    if (rb.mirrored) {
+      u8* span = rb.ReadSpan(long_array_tag->length * sizeof(u64));
+
+      if (!span) return false;
+
+      for (size_t i = 0; i < long_array_tag->length; ++i) {
+        long_array_tag->data[i] = (s64)LoadBigEndianU64(span + i * sizeof(u64));
+      }
+
+      tag.tag = long_array_tag;
+      break;
+    }
+
     for (size_t i = 0; i < long_array_tag->length; ++i) {
       s64* long_data = long_array_tag->data + i;
 
@@ -301,6 +449,13 @@ bool ParseTag(RingBuffer& rb, Tag& tag, MemoryArena& arena) {
 bool Parse(bool network_nbt, RingBuffer& rb, MemoryArena& arena, TagCompound* result) {
   TagType type = TagType::Unknown;
 
+  result->tags = NULL;
+  result->ntags = 0;
+  result->index = NULL;
+  result->index_mask = 0;
+  result->name = NULL;
+  result->name_length = 0;
+
   if (rb.GetReadAmount() < sizeof(u8)) {
     return false;
   }
@@ -321,7 +476,251 @@ bool Parse(bool network_nbt, RingBuffer& rb, MemoryArena& arena, TagCompound* re
     }
   }
 
-  if (!ParseCompound(rb, *result, arena)) {
+  ParseContext context;
+
+  context.pending_count = 0;
+  context.depth = 0;
+
+  if (!ParseCompound(rb, *result, arena, context)) {
+    return false;
+  }
+
+  return true;
+}
+
+static inline bool SkipBytes(RingBuffer& rb, u64 size) {
+  if (rb.GetReadAmount() < size) return false;
+
+  rb.read_offset = (rb.read_offset + (size_t)size) % rb.size;
+  return true;
+}
+
+// Returns the payload size of tags that don't have a length prefix, or 0 for everything else.
+static inline size_t GetFixedSize(TagType type) {
+  switch (type) {
+  case TagType::Byte:
+    return sizeof(u8);
+  case TagType::Short:
+    return sizeof(u16);
+  case TagType::Int:
+  case TagType::Float:
+    return sizeof(u32);
+  case TagType::Long:
+  case TagType::Double:
+    return sizeof(u64);
+  default:
+    return 0;
+  }
+}
+
+static inline size_t GetArrayElementSize(TagType type) {
+  switch (type) {
+  case TagType::ByteArray:
+    return sizeof(u8);
+  case TagType::IntArray:
+    return sizeof(u32);
+  case TagType::LongArray:
+    return sizeof(u64);
+  default:
+    return 0;
+  }
+}
+
+// Skips a value with a known type. Nested lists and compounds are tracked on an explicit stack instead of recursing,
+// so deeply nested data can't blow out the call stack.
+static bool SkipValue(RingBuffer& rb, TagType type) {
+  struct Frame {
+    bool compound;
+    TagType element_type;
+    u32 remaining;
+  };
+
+  Frame stack[kMaxDepth];
+  size_t depth = 0;
+
+  while (true) {
+    size_t fixed_size = GetFixedSize(type);
+    size_t element_size = GetArrayElementSize(type);
+
+    if (fixed_size > 0) {
+      if (!SkipBytes(rb, fixed_size)) return false;
+    } else if (element_size > 0) {
+      if (rb.GetReadAmount() < sizeof(u32)) return false;
+
+      u32 length = rb.ReadU32();
+
+      if (!SkipBytes(rb, (u64)length * element_size)) return false;
+    } else if (type == TagType::String) {
+      if (rb.GetReadAmount() < sizeof(u16)) return false;
+      if (!SkipBytes(rb, rb.ReadU16())) return false;
+    } else if (type == TagType::List) {
+      if (rb.GetReadAmount() < sizeof(u8) + sizeof(u32)) return false;
+
+      TagType element_type = (TagType)rb.ReadU8();
+      u32 length = rb.ReadU32();
+      size_t list_fixed_size = GetFixedSize(element_type);
+
+      // Lists of numbers are skipped all at once.
+      if (list_fixed_size > 0) {
+        if (!SkipBytes(rb, (u64)length * list_fixed_size)) return false;
+      } else if (length > 0) {
+        if (depth >= kMaxDepth) return false;
+
+        stack[depth++] = {false, element_type, length};
+      }
+    } else if (type == TagType::Compound) {
+      if (depth >= kMaxDepth) return false;
+
+      stack[depth++] = {true, TagType::End, 0};
+    } else {
+      fprintf(stderr, "Unknown NBT type: %d\n", (int)type);
+      return false;
+    }
+
+    // Find the next value to skip from the innermost list or compound.
+    while (true) {
+      if (depth == 0) return true;
+
+      Frame& frame = stack[depth - 1];
+
+      if (frame.compound) {
+        if (rb.GetReadAmount() < sizeof(u8)) return false;
+
+        type = (TagType)rb.ReadU8();
+
+        if (type == TagType::End) {
+          --depth;
+          continue;
+        }
+
+        if (rb.GetReadAmount() < sizeof(u16)) return false;
+        if (!SkipBytes(rb, rb.ReadU16())) return false;
+
+        break;
+      }
+
+      if (frame.remaining == 0) {
+        --depth;
+        continue;
+      }
+
+      --frame.remaining;
+      type = frame.element_type;
+      break;
+    }
+  }
+}
+
+bool Skip(bool network_nbt, RingBuffer& rb) {
+  if (rb.GetReadAmount() < sizeof(u8)) return false;
+
+  TagType type = (TagType)rb.ReadU8();
+
+  if (type == TagType::End) return true;
+
+  if (!network_nbt) {
+    if (rb.GetReadAmount() < sizeof(u16)) return false;
+    if (!SkipBytes(rb, rb.ReadU16())) return false;
+  }
+
+  return SkipValue(rb, type);
+}
+
+bool Reader::ReadRoot(bool network_nbt) {
+  if (rb.GetReadAmount() < sizeof(u8)) {
+    failed = true;
+    return false;
+  }
+
+  TagType type = (TagType)rb.ReadU8();
+
+  if (type == TagType::End) return false;
+
+  if (!network_nbt) {
+    String name;
+
+    if (!ReadString(&name)) return false;
+  }
+
+  if (type != TagType::Compound) {
+    // Keep the buffer positioned after the value even though it can't be walked.
+    SkipValue(type);
+    return false;
+  }
+
+  return true;
+}
+
+bool Reader::Next(TagType* type, String* name) {
+  if (rb.GetReadAmount() < sizeof(u8)) {
+    failed = true;
+    return false;
+  }
+
+  *type = (TagType)rb.ReadU8();
+
+  if (*type == TagType::End) return false;
+
+  return ReadString(name);
+}
+
+bool Reader::Find(const String& name, TagType* type) {
+  String tag_name;
+
+  while (Next(type, &tag_name)) {
+    if (poly_strcmp(name, tag_name) == 0) return true;
+    if (!SkipValue(*type)) return false;
+  }
+
+  return false;
+}
+
+bool Reader::SkipValue(TagType type) {
+  if (!nbt::SkipValue(rb, type)) {
+    failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool Reader::SkipCompound() {
+  return SkipValue(TagType::Compound);
+}
+
+bool Reader::ReadByte(u8* value) {
+  if (rb.GetReadAmount() < sizeof(u8)) {
+    failed = true;
+    return false;
+  }
+
+  *value = rb.ReadU8();
+  return true;
+}
+
+bool Reader::ReadInt(s32* value) {
+  if (rb.GetReadAmount() < sizeof(u32)) {
+    failed = true;
+    return false;
+  }
+
+  *value = (s32)rb.ReadU32();
+  return true;
+}
+
+bool Reader::ReadString(String* value) {
+  if (rb.GetReadAmount() < sizeof(u16)) {
+    failed = true;
+    return false;
+  }
+
+  u16 length = rb.ReadU16();
+
+  value->data = (char*)rb.ReadSpan(length);
+  value->size = length;
+
+  if (!value->data) {
+    failed = true;
     return false;
   }
 
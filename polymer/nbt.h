@@ -35,12 +35,21 @@ struct Tag {
   TagType type;
 };
 
+// The most tags that can be pending at once while parsing, which is every tag in the compounds that are still open.
 constexpr size_t kMaxTags = 1024;
+// Compounds with at least this many tags get a hashed name index.
+constexpr size_t kIndexedTagCount = 16;
 
+// Tags are allocated at the exact count once the compound is fully parsed.
 struct TagCompound {
-  Tag tags[kMaxTags];
+  Tag* tags;
   size_t ntags;
 
+  // Open addressing table of tag index + 1 keyed by the name hash. This is null for small compounds, which are searched
+  // linearly.
+  u16* index;
+  size_t index_mask;
+
   char* name;
   size_t name_length;
 
@@ -99,6 +108,37 @@ struct TagLongArray {
 
 bool Parse(bool network_nbt, RingBuffer& rb, MemoryArena& arena, TagCompound* result);
 
+// Skips over an entire nbt value without allocating anything. Returns false if the data is malformed.
+bool Skip(bool network_nbt, RingBuffer& rb);
+
+// Walks nbt in place one tag at a time without allocating. Values that aren't wanted are skipped without decoding them.
+// Strings are returned as views into the buffer, so the buffer must be mirrored.
+struct Reader {
+  RingBuffer& rb;
+  // Set when the data was malformed or ran out, as opposed to reaching the end of a compound.
+  bool failed = false;
+
+  Reader(RingBuffer& rb) : rb(rb) {}
+
+  // Reads the root tag. Returns false if the root isn't a compound.
+  bool ReadRoot(bool network_nbt);
+
+  // Reads the header of the next tag in the current compound. Returns false once the compound ends.
+  // The value must then be read, skipped, or descended into with further calls to Next if it's a compound.
+  bool Next(TagType* type, String* name);
+  // Skips tags in the current compound until one with the name is found. Tags are only read forward, so fields
+  // need to be looked up in the order they were sent. Returns false if the compound ends first.
+  bool Find(const String& name, TagType* type);
+
+  bool SkipValue(TagType type);
+  // Skips everything left in the current compound, including its end tag.
+  bool SkipCompound();
+
+  bool ReadByte(u8* value);
+  bool ReadInt(s32* value);
+  bool ReadString(String* value);
+};
+
 } // namespace nbt
 } // namespace polymer
 
@@ -0,0 +1,124 @@
+#include <polymer/packet_builder.h>
+
+#include <lib/miniz.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace polymer {
+
+// Writes a VarInt directly to memory and returns the encoded size.
+static size_t EncodeVarInt(u8* dest, u64 value) {
+  size_t size = 0;
+
+  do {
+    u8 byte = value & 0x7F;
+
+    value >>= 7;
+
+    if (value) byte |= 0x80;
+
+    dest[size++] = byte;
+  } while (value);
+
+  return size;
+}
+
+PacketBuilder::PacketBuilder(MemoryArena& arena, size_t buffer_size)
+    : buffer(arena, buffer_size), flags(BuildFlag_OmitCompress) {
+  deflate_stream = memory_arena_push_type(&arena, mz_stream);
+  memset(deflate_stream, 0, sizeof(mz_stream));
+}
+
+void PacketBuilder::SetCompressionThreshold(s32 threshold) {
+  compression_threshold = threshold;
+
+  if (threshold < 0) {
+    flags |= BuildFlag_OmitCompress;
+    return;
+  }
+
+  flags &= ~BuildFlag_OmitCompress;
+
+  if (!(flags & BuildFlag_Compression)) {
+    if (mz_deflateInit(deflate_stream, MZ_DEFAULT_COMPRESSION) == MZ_OK) {
+      flags |= BuildFlag_Compression;
+    } else {
+      fprintf(stderr, "Failed to initialize deflate stream. Packets will be sent uncompressed.\n");
+    }
+  }
+}
+
+void PacketBuilder::Shutdown() {
+  if (flags & BuildFlag_Compression) {
+    mz_deflateEnd(deflate_stream);
+  }
+
+  flags = BuildFlag_OmitCompress;
+  compression_threshold = -1;
+}
+
+void PacketBuilder::Commit(RingBuffer& out, u32 pid) {
+  size_t data_size = buffer.write_offset + GetVarIntSize(pid);
+
+  if (flags & BuildFlag_OmitCompress) {
+    out.WriteVarInt(data_size);
+  } else if ((flags & BuildFlag_Compression) && data_size >= (size_t)compression_threshold) {
+    // The packet length is written as a padded VarInt so the packet can be deflated directly into the write buffer
+    // before the compressed size is known.
+    constexpr size_t kPaddedLengthSize = 3;
+
+    // The write buffer is mirrored in virtual memory, so the compressed data is free to run off the end of the buffer.
+    u8* header = out.data + out.write_offset;
+    size_t data_length_size = EncodeVarInt(header + kPaddedLengthSize, data_size);
+    u8* dest = header + kPaddedLengthSize + data_length_size;
+
+    u8 pid_data[5];
+    size_t pid_size = EncodeVarInt(pid_data, pid);
+
+    mz_deflateReset(deflate_stream);
+
+    deflate_stream->next_out = dest;
+    deflate_stream->avail_out = (u32)mz_deflateBound(deflate_stream, (mz_ulong)data_size);
+    deflate_stream->next_in = pid_data;
+    deflate_stream->avail_in = (u32)pid_size;
+
+    int result = mz_deflate(deflate_stream, MZ_NO_FLUSH);
+
+    if (result == MZ_OK) {
+      deflate_stream->next_in = buffer.data;
+      deflate_stream->avail_in = (u32)buffer.write_offset;
+
+      result = mz_deflate(deflate_stream, MZ_FINISH);
+    }
+
+    size_t packet_size = data_length_size + (size_t)deflate_stream->total_out;
+
+    if (result == MZ_STREAM_END && packet_size < (1 << 21)) {
+      header[0] = (u8)(packet_size & 0x7F) | 0x80;
+      header[1] = (u8)((packet_size >> 7) & 0x7F) | 0x80;
+      header[2] = (u8)((packet_size >> 14) & 0x7F);
+
+      out.write_offset = (out.write_offset + kPaddedLengthSize + packet_size) % out.size;
+      buffer.write_offset = 0;
+      return;
+    }
+
+    fprintf(stderr, "Failed to compress packet %u. Sending uncompressed.\n", pid);
+
+    out.WriteVarInt(data_size + GetVarIntSize(0));
+    out.WriteVarInt(0);
+  } else {
+    out.WriteVarInt(data_size + GetVarIntSize(0));
+    out.WriteVarInt(0);
+  }
+
+  out.WriteVarInt(pid);
+
+  if (buffer.write_offset > 0) {
+    out.WriteRawString(String((char*)buffer.data, buffer.write_offset));
+    buffer.write_offset = 0;
+  }
+}
+
+} // namespace polymer
@@ -0,0 +1,84 @@
+#ifndef POLYMER_PACKET_BUILDER_H_
+#define POLYMER_PACKET_BUILDER_H_
+
+#include <polymer/buffer.h>
+#include <polymer/memory.h>
+#include <polymer/types.h>
+
+struct mz_stream_s;
+
+namespace polymer {
+
+struct PacketBuilder {
+  enum BuildFlag {
+    BuildFlag_Compression = (1 << 0),
+    BuildFlag_OmitCompress = (1 << 1),
+  };
+  using BuildFlags = u32;
+
+  RingBuffer buffer;
+  BuildFlags flags;
+
+  // Packets with an uncompressed size below this are sent without compression. Negative disables compression.
+  s32 compression_threshold = -1;
+  // Persistent deflate state that gets reset for every compressed packet.
+  struct mz_stream_s* deflate_stream = nullptr;
+
+  // The buffer needs to hold the largest packet that will be built.
+  PacketBuilder(MemoryArena& arena, size_t buffer_size = 32767);
+
+  void SetCompressionThreshold(s32 threshold);
+  // Releases the deflate state and goes back to sending uncompressed packets.
+  void Shutdown();
+
+  // Frames the built packet into the out buffer, compressing it if it's over the compression threshold.
+  void Commit(RingBuffer& out, u32 pid);
+
+  inline void WriteU8(u8 value) {
+    buffer.WriteU8(value);
+  }
+
+  inline void WriteU16(u16 value) {
+    buffer.WriteU16(value);
+  }
+
+  inline void WriteU32(u32 value) {
+    buffer.WriteU32(value);
+  }
+
+  inline void WriteU64(u64 value) {
+    buffer.WriteU64(value);
+  }
+
+  inline void WriteVarInt(u64 value) {
+    buffer.WriteVarInt(value);
+  }
+
+  inline void WriteFloat(float value) {
+    buffer.WriteFloat(value);
+  }
+
+  inline void WriteDouble(double value) {
+    buffer.WriteDouble(value);
+  }
+
+  inline void WriteString(const String& str) {
+    buffer.WriteString(str);
+  }
+
+  inline void WriteString(const char* str, size_t size) {
+    buffer.WriteString(str, size);
+  }
+
+  inline void WriteRawString(const String& str) {
+    buffer.WriteRawString(str);
+  }
+
+  inline void WriteRawString(const char* str, size_t size) {
+    buffer.WriteRawString(str, size);
+  }
+};
+
+} // namespace polymer
+
+#endif
@@ -1,27 +1,153 @@
 #include <polymer/packet_interpreter.h>
 
-#include <lib/miniz.h>
 #include <polymer/bitset.h>
+#include <polymer/crypto/rsa.h>
+#include <polymer/crypto/sha1.h>
+#include <polymer/decode_pipeline.h>
 #include <polymer/gamestate.h>
 #include <polymer/nbt.h>
 #include <polymer/protocol.h>
 #include <polymer/unicode.h>
+#include <polymer/world/paletted_container.h>
+
+#include <algorithm>
+#include <random>
 
 #include <assert.h>
 #include <stdio.h>
 
 #define LOG_PACKET_ID 0
 
+using polymer::world::Chunk;
 using polymer::world::ChunkSection;
 using polymer::world::ChunkSectionInfo;
 using polymer::world::DimensionCodec;
 using polymer::world::DimensionType;
 using polymer::world::kChunkColumnCount;
 
+static_assert(polymer::kMaxDecodedSections == kChunkColumnCount, "Decoded sections must match the world column.");
+
 namespace polymer {
 
-PacketInterpreter::PacketInterpreter(GameState* game)
-    : game(game), compression(false), inflate_buffer(*game->perm_arena, 65536 * 32) {}
+PacketInterpreter::PacketInterpreter(GameState* game) : game(game) {}
+
+struct ExplosionRecord {
+  s32 chunk_x;
+  s32 chunk_y;
+  s32 chunk_z;
+  // Section block change record with an air block id.
+  u64 record;
+};
+
+static inline bool IsExplosionRecordBefore(const ExplosionRecord& a, const ExplosionRecord& b) {
+  if (a.chunk_x != b.chunk_x) return a.chunk_x < b.chunk_x;
+  if (a.chunk_z != b.chunk_z) return a.chunk_z < b.chunk_z;
+
+  return a.chunk_y < b.chunk_y;
+}
+
+// Reads the light masks and arrays that ChunkData and UpdateLight share, and loads them into the column's sections.
+// The bits of changed_set are set for every section whose light changed.
+static bool ReadLightData(RingBuffer* rb, GameState* game, ChunkSection* section, u32* changed_set) {
+  MemoryArena* trans_arena = game->trans_arena;
+  world::ChunkStorageAllocator& allocator = game->world.chunk_storage;
+
+  BitSet skylight_mask;
+  if (!skylight_mask.Read(*trans_arena, *rb)) {
+    fprintf(stderr, "Failed to read skylight mask\n");
+    fflush(stderr);
+    return false;
+  }
+
+  BitSet blocklight_mask;
+  if (!blocklight_mask.Read(*trans_arena, *rb)) {
+    fprintf(stderr, "Failed to read blocklight mask\n");
+    fflush(stderr);
+    return false;
+  }
+
+  BitSet empty_skylight_mask;
+  if (!empty_skylight_mask.Read(*trans_arena, *rb)) {
+    fprintf(stderr, "Failed to read empty skylight mask\n");
+    fflush(stderr);
+    return false;
+  }
+
+  BitSet empty_blocklight_mask;
+  if (!empty_blocklight_mask.Read(*trans_arena, *rb)) {
+    fprintf(stderr, "Failed to read empty blocklight mask\n");
+    fflush(stderr);
+    return false;
+  }
+
+  // The light sections include one below and one above the world.
+  constexpr size_t kRecvSections = kChunkColumnCount + 2;
+
+  s32 column_offset = (game->dimension.min_y + 64) / 16;
+
+  // Returns the chunk that a light section belongs to, or null if it's outside the world or has no blocks.
+  auto get_light_chunk = [section, column_offset](size_t i, size_t* chunk_y) -> Chunk* {
+    if (i == 0 || i == kRecvSections - 1) return nullptr;
+
+    s64 y = (s64)i - 1 + column_offset;
+
+    if (y < 0 || y >= (s64)kChunkColumnCount) return nullptr;
+
+    *chunk_y = (size_t)y;
+    return section->chunks[y];
+  };
+
+  for (size_t i = 0; i < kRecvSections; ++i) {
+    size_t chunk_y = 0;
+    Chunk* chunk = get_light_chunk(i, &chunk_y);
+
+    if (!chunk) continue;
+
+    if (empty_skylight_mask.IsSet(i) && chunk->skylight.Clear(allocator)) {
+      *changed_set |= 1 << chunk_y;
+    }
+
+    if (empty_blocklight_mask.IsSet(i) && chunk->blocklight.Clear(allocator)) {
+      *changed_set |= 1 << chunk_y;
+    }
+  }
+
+  for (size_t light_index = 0; light_index < 2; ++light_index) {
+    BitSet& mask = light_index == 0 ? skylight_mask : blocklight_mask;
+
+    u64 array_count = 0;
+    rb->ReadVarInt(&array_count);
+
+    for (size_t i = 0; i < kRecvSections; ++i) {
+      if (!mask.IsSet(i)) continue;
+
+      u64 length = 0;
+
+      rb->ReadVarInt(&length);
+
+      // Read the light array in place from the packet.
+      u8* data = rb->ReadSpan((size_t)length);
+
+      if (!data) {
+        fprintf(stderr, "Failed to read %s array\n", light_index == 0 ? "skylight" : "blocklight");
+        return false;
+      }
+
+      size_t chunk_y = 0;
+      Chunk* chunk = get_light_chunk(i, &chunk_y);
+
+      if (!chunk || length != sizeof(world::LightNibbles)) continue;
+
+      world::ChunkLight& light = light_index == 0 ? chunk->skylight : chunk->blocklight;
+
+      if (light.Load(allocator, data)) {
+        *changed_set |= 1 << chunk_y;
+      }
+    }
+  }
+
+  return true;
+}
 
 void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_size) {
   MemoryArena* trans_arena = game->trans_arena;
@@ -39,35 +165,43 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
   switch (type) {
   case ProtocolId::ChunkBatchStart: {
-    // TODO: Measure
+    chunk_batches.OnBatchStart();
   } break;
   case ProtocolId::ChunkBatchFinished: {
-    outbound::play::SendChunkBatchReceived(*connection, 16.0f);
-  } break;
-  case ProtocolId::SystemChatMessage: {
-    MemoryRevert revert = trans_arena->GetReverter();
+    u64 batch_size = 0;
+
+    if (!rb->ReadVarInt(&batch_size)) {
+      fprintf(stderr, "PlayProtocol::ChunkBatchFinished: Failed to read batch size.\n");
+    }
 
-    nbt::TagCompound* msg_nbt = memory_arena_push_type(trans_arena, nbt::TagCompound);
+    // Batches are acknowledged once their chunks are meshed, but too many outstanding ones forces the oldest out.
+    if (chunk_batches.IsFull()) {
+      outbound::play::SendChunkBatchReceived(*connection, chunk_batches.Acknowledge());
+    }
 
-    if (nbt::Parse(true, *rb, *trans_arena, msg_nbt)) {
-      for (size_t i = 0; i < msg_nbt->ntags; ++i) {
-        String tag_name(msg_nbt->tags[i].name, msg_nbt->tags[i].name_length);
+    chunk_batches.OnBatchFinished((size_t)batch_size, game->chunk_renderer.draw_count);
+  } break;
+  case ProtocolId::SystemChatMessage: {
+    nbt::Reader reader(*rb);
+    nbt::TagType type;
 
-        // Grab the translate key and output it for now.
+    if (reader.ReadRoot(true)) {
+      // Grab the translate key and output it for now.
+      if (reader.Find(POLY_STR("translate"), &type)) {
+        String translate;
 
-        if (poly_strcmp(tag_name, POLY_STR("translate")) == 0) {
-          if (msg_nbt->tags[i].type == nbt::TagType::String) {
-            nbt::TagString* str_tag = (nbt::TagString*)msg_nbt->tags[i].tag;
-            printf("System: %.*s\n", (u32)str_tag->length, str_tag->data);
-          }
+        if (type == nbt::TagType::String && reader.ReadString(&translate)) {
+          printf("System: %.*s\n", (u32)translate.size, translate.data);
         }
       }
-    } else {
+    }
+
+    if (reader.failed) {
       fprintf(stderr, "PlayProtocol::SystemChatMessage: Failed to parse NBT.\n");
     }
   } break;
   case ProtocolId::PlayerChatMessage: {
-    String sender_uuid = rb->ReadAllocRawString(*trans_arena, 16);
+    String sender_uuid = rb->ReadRawStringView(16);
 
     if (sender_uuid.size != 16) {
       fprintf(stderr, "Failed to read PlayerChatMessage::sender_uuid\n");
@@ -94,7 +228,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
       rb->ReadVarInt(&mesg_signature_size);
 
-      String mesg_signature = rb->ReadAllocRawString(*trans_arena, mesg_signature_size);
+      String mesg_signature = rb->ReadRawStringView((size_t)mesg_signature_size);
 
       if (mesg_signature.size != mesg_signature_size) {
         fprintf(stderr, "Failed to read PlayerChatMessage::mesg_signature\n");
@@ -102,7 +236,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
       }
     }
 
-    String message = rb->ReadAllocString(*trans_arena);
+    String message = rb->ReadStringView();
 
     if (message.size > 0) {
       wchar output_text[1024];
@@ -136,7 +270,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
     u64 salt = rb->ReadU64();
   } break;
   case ProtocolId::Disconnect: {
-    String reason = rb->ReadAllocString(*trans_arena);
+    String reason = rb->ReadStringView();
 
     if (reason.size > 0) {
       printf("Disconnected: %.*s\n", (int)reason.size, reason.data);
@@ -148,15 +282,53 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
     double z = rb->ReadDouble();
     float strength = rb->ReadFloat();
 
-    u64 records;
-    rb->ReadVarInt(&records);
+    u64 count;
+    rb->ReadVarInt(&count);
 
-    for (u64 i = 0; i < records; ++i) {
+    // Each record is three bytes followed by the velocity.
+    if (count > rb->GetReadAmount() / 3) {
+      fprintf(stderr, "Failed to read explosion records.\n");
+      fflush(stderr);
+      break;
+    }
+
+    MemoryRevert trans_revert = game->trans_arena->GetReverter();
+    ExplosionRecord* explosion_records = memory_arena_push_type_count(game->trans_arena, ExplosionRecord, count);
+    u64* records = memory_arena_push_type_count(game->trans_arena, u64, count);
+
+    for (u64 i = 0; i < count; ++i) {
       s8 x_offset = rb->ReadU8();
       s8 y_offset = rb->ReadU8();
       s8 z_offset = rb->ReadU8();
 
-      game->OnBlockChange((s32)x + x_offset, (s32)y + y_offset, (s32)z + z_offset, 0);
+      s32 block_x = (s32)x + x_offset;
+      s32 block_y = (s32)y + y_offset;
+      s32 block_z = (s32)z + z_offset;
+
+      ExplosionRecord* record = explosion_records + i;
+
+      // Arithmetic shifts floor negative coordinates to their chunk.
+      record->chunk_x = block_x >> 4;
+      record->chunk_y = block_y >> 4;
+      record->chunk_z = block_z >> 4;
+      record->record = ((u64)(block_x & 15) << 8) | ((u64)(block_z & 15) << 4) | (u64)(block_y & 15);
+    }
+
+    // Every destroyed block in a section is applied together so the section is only rebuilt and relit once.
+    std::sort(explosion_records, explosion_records + count, IsExplosionRecordBefore);
+
+    for (size_t start = 0; start < count;) {
+      const ExplosionRecord& first = explosion_records[start];
+      size_t end = start;
+
+      while (end < count && explosion_records[end].chunk_x == first.chunk_x &&
+             explosion_records[end].chunk_y == first.chunk_y && explosion_records[end].chunk_z == first.chunk_z) {
+        records[end - start] = explosion_records[end].record;
+        ++end;
+      }
+
+      game->OnSectionBlockChanges(first.chunk_x, first.chunk_y, first.chunk_z, records, end - start);
+      start = end;
     }
 
     float velocity_x = rb->ReadFloat();
@@ -238,7 +410,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
     // Read all of the dimensions
     for (size_t i = 0; i < dimension_count; ++i) {
-      String dimension_name = rb->ReadAllocString(*trans_arena);
+      String dimension_name = rb->ReadStringView();
     }
 
     u64 max_players = 0, view_distance = 0, simulation_distance = 0;
@@ -264,7 +436,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
       fprintf(stderr, "Failed to find dimension with id %d in codec.\n", (s32)dimension_type_id);
     }
 
-    String dimension_identifier = rb->ReadAllocString(*trans_arena);
+    String dimension_identifier = rb->ReadStringView();
 
     if (dimension_identifier.size > 0) {
       printf("Dimension: %.*s\n", (u32)dimension_identifier.size, dimension_identifier.data);
@@ -278,7 +450,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
     rb->ReadVarInt(&dimension_type_id);
 
-    String dimension_name = rb->ReadAllocString(*trans_arena);
+    String dimension_name = rb->ReadStringView();
 
     DimensionType* dimension_type = game->dimension_codec.GetDimensionTypeById((s32)dimension_type_id);
 
@@ -293,6 +465,28 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
     game->OnDimensionChange();
   } break;
+  case ProtocolId::UpdateLight: {
+    u64 chunk_x = 0;
+    u64 chunk_z = 0;
+
+    rb->ReadVarInt(&chunk_x);
+    rb->ReadVarInt(&chunk_z);
+
+    u32 x_index = world::GetChunkCacheIndex((s32)chunk_x);
+    u32 z_index = world::GetChunkCacheIndex((s32)chunk_z);
+
+    ChunkSection* section = &game->world.chunks[z_index][x_index];
+    ChunkSectionInfo* section_info = &game->world.chunk_infos[z_index][x_index];
+
+    if (!section_info->loaded || section_info->x != (s32)chunk_x || section_info->z != (s32)chunk_z) break;
+
+    // Only the sections whose light arrays actually changed are remeshed.
+    u32 changed_set = 0;
+
+    ReadLightData(rb, game, section, &changed_set);
+
+    game->world.OnLightChange((s32)chunk_x, (s32)chunk_z, changed_set);
+  } break;
   case ProtocolId::UpdateSectionBlocks: {
     u64 xzy = rb->ReadU64();
 
@@ -315,31 +509,30 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
     u64 count;
     rb->ReadVarInt(&count);
 
-    for (size_t i = 0; i < count; ++i) {
-      u64 data;
+    // The records are decoded in batches so the varint decoding isn't interleaved with the block updates.
+    constexpr size_t kBatchSize = 64;
+    u64 records[kBatchSize];
 
-      rb->ReadVarInt(&data);
+    for (size_t batch_start = 0; batch_start < count; batch_start += kBatchSize) {
+      size_t batch_count = (size_t)(count - batch_start);
 
-      u32 new_bid = (u32)(data >> 12);
-      u32 relative_x = (data >> 8) & 0x0F;
-      u32 relative_z = (data >> 4) & 0x0F;
-      u32 relative_y = data & 0x0F;
+      if (batch_count > kBatchSize) batch_count = kBatchSize;
 
-      game->OnBlockChange(chunk_x * 16 + relative_x, chunk_y * 16 + relative_y, chunk_z * 16 + relative_z, new_bid);
+      if (!rb->ReadVarLongs(records, batch_count)) {
+        fprintf(stderr, "Failed to read section block updates.\n");
+        fflush(stderr);
+        break;
+      }
+
+      game->OnSectionBlockChanges(chunk_x, chunk_y, chunk_z, records, batch_count);
     }
   } break;
   case ProtocolId::ChunkData: {
     s32 chunk_x = rb->ReadU32();
     s32 chunk_z = rb->ReadU32();
 
-    // This is some scratch space for reading byte arrays below.
-    String scratch_str;
-    scratch_str.data = memory_arena_push_type_count(trans_arena, char, 32767);
-    scratch_str.size = 32767;
-
-    nbt::TagCompound* nbt = memory_arena_push_type(trans_arena, nbt::TagCompound);
-
-    if (!nbt::Parse(true, *rb, *trans_arena, nbt)) {
+    // Heightmaps aren't used yet.
+    if (!nbt::Skip(true, *rb)) {
       fprintf(stderr, "Failed to parse chunk nbt.\n");
       fflush(stderr);
     }
@@ -357,7 +550,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
     for (size_t i = 0; i < kChunkColumnCount; ++i) {
       if (section->chunks[i]) {
-        game->world.chunk_pool.Free(section->chunks[i]);
+        game->world.FreeChunk(section->chunks[i]);
         section->chunks[i] = nullptr;
       }
     }
@@ -375,112 +568,58 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
         start_y = (game->dimension.min_y / 16) + (64 / 16);
       }
 
-      for (u64 chunk_y = start_y; chunk_y < end_y; ++chunk_y) {
-        // Read Chunk data here
-        u16 block_count = rb->ReadU16();
-        u8 bpb = rb->ReadU8();
-
-        if (block_count > 0) {
-          section_info->bitmask |= (1 << chunk_y);
-        }
-
-        u64* palette = nullptr;
-        u64 single_palette = 0;
+      if (chunk_decode && chunk_decode->section_count >= end_y - start_y) {
+        // The decode pipeline already unpacked the sections, so they only need to be copied into the world.
+        for (u64 chunk_y = start_y; chunk_y < end_y; ++chunk_y) {
+          ChunkDataDecode::Section* decoded = chunk_decode->sections + (chunk_y - start_y);
 
-        if (bpb == 0) {
-          rb->ReadVarInt(&single_palette);
-          palette = &single_palette;
-        } else if (bpb < 9) {
-          if (bpb < 4) bpb = 4;
+          if (decoded->block_count == 0) continue;
 
-          u64 palette_length = 0;
-          rb->ReadVarInt(&palette_length);
+          Chunk* chunk = game->world.chunk_pool.Allocate();
+          if (!chunk) break;
 
-          palette = memory_arena_push_type_count(trans_arena, u64, (size_t)palette_length);
-
-          for (u64 i = 0; i < palette_length; ++i) {
-            u64 palette_data;
-            rb->ReadVarInt(&palette_data);
-            palette[i] = palette_data;
-          }
-        }
-
-        u64 data_array_length;
-        rb->ReadVarInt(&data_array_length);
-
-        u64 id_mask = (1LL << bpb) - 1;
-        u64 block_index = 0;
-
-        u32* chunk = nullptr;
-
-        if (block_count > 0) {
-          section->chunks[chunk_y] = game->world.chunk_pool.Allocate();
-          chunk = (u32*)section->chunks[chunk_y]->blocks;
+          section_info->bitmask |= (1 << chunk_y);
+          section->chunks[chunk_y] = chunk;
 
-          // Fill out entire chunk with the one block palette
-          if (data_array_length == 0 && bpb == 0) {
-            for (int i = 0; i < 16 * 16 * 16; ++i) {
-              chunk[i] = (u32)single_palette;
-            }
+          if (decoded->decoded) {
+            chunk->Load(game->world.chunk_storage, *decoded->decoded);
+          } else {
+            chunk->Fill(game->world.chunk_storage, decoded->single_value);
           }
         }
+      } else {
+        for (u64 chunk_y = start_y; chunk_y < end_y; ++chunk_y) {
+          // Read Chunk data here
+          u16 block_count = rb->ReadU16();
 
-        for (u64 i = 0; i < data_array_length; ++i) {
-          u64 data_value = rb->ReadU64();
+          world::PalettedContainer blocks;
 
-          if (block_count > 0) {
-            for (u64 j = 0; j < 64 / bpb; ++j) {
-              size_t palette_index = (size_t)((data_value >> (j * bpb)) & id_mask);
-
-              if (palette) {
-                chunk[block_index++] = (u32)palette[palette_index];
-              } else {
-                chunk[block_index++] = (u32)palette_index;
-              }
-            }
+          if (!blocks.Read(*rb, world::PalettedContainerType::Blocks)) {
+            fprintf(stderr, "Failed to read chunk section blocks.\n");
+            fflush(stderr);
+            break;
           }
-        }
 
-        u8 biome_bpe = rb->ReadU8();
+          Chunk* chunk = block_count > 0 ? game->world.chunk_pool.Allocate() : nullptr;
 
-        u64* biome_palette = nullptr;
-        u64 single_biome_palette = 0;
+          if (chunk) {
+            MemoryRevert revert = trans_arena->GetReverter();
 
-        if (biome_bpe == 0) {
-          rb->ReadVarInt(&single_biome_palette);
-          biome_palette = &single_biome_palette;
-        } else if (biome_bpe < 9) {
-          u64 biome_palette_length = 0;
-          rb->ReadVarInt(&biome_palette_length);
+            world::ChunkBlockData* data = memory_arena_push_type(trans_arena, world::ChunkBlockData);
+            u32* scratch = memory_arena_push_type_count(trans_arena, u32, world::kChunkBlockCount);
 
-          biome_palette = memory_arena_push_type_count(trans_arena, u64, (size_t)biome_palette_length);
+            data->Build(blocks, scratch);
+            chunk->Load(game->world.chunk_storage, *data);
 
-          for (u64 i = 0; i < biome_palette_length; ++i) {
-            u64 biome_palette_data;
-            rb->ReadVarInt(&biome_palette_data);
-            biome_palette[i] = biome_palette_data;
+            section_info->bitmask |= (1 << chunk_y);
+            section->chunks[chunk_y] = chunk;
           }
-        }
-
-        u64 biome_data_array_length;
-        rb->ReadVarInt(&biome_data_array_length);
-
-        u64 biome_id_mask = (1LL << biome_bpe) - 1;
-        u64 biome_index = 0;
-
-        for (u64 i = 0; i < biome_data_array_length; ++i) {
-          u64 data_value = rb->ReadU64();
 
-          for (u64 j = 0; j < 64 / biome_bpe; ++j) {
-            size_t palette_index = (size_t)((data_value >> (j * biome_bpe)) & biome_id_mask);
-
-            if (biome_palette) {
-              // u32 biome_id = (u32)biome_palette[palette_index];
-            } else {
-              // u32 biome_id = (u32)palette_index;
-            }
-
-            ++biome_index;
+          // Biomes aren't stored yet, so they only need to be skipped.
+          if (!world::PalettedContainer::Skip(*rb, world::PalettedContainerType::Biomes)) {
+            fprintf(stderr, "Failed to read chunk section biomes.\n");
+            fflush(stderr);
+            break;
           }
         }
       }
@@ -503,109 +642,22 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
       u64 type;
       rb->ReadVarInt(&type);
 
-      ArenaSnapshot snapshot = trans_arena->GetSnapshot();
-      nbt::TagCompound* block_entity_nbt = memory_arena_push_type(trans_arena, nbt::TagCompound);
-
-      if (!nbt::Parse(true, *rb, *trans_arena, block_entity_nbt)) {
+      if (!nbt::Skip(true, *rb)) {
         fprintf(stderr, "Failed to parse block entity nbt.\n");
         fflush(stderr);
       }
-
-      trans_arena->Revert(snapshot);
-    }
-
-    BitSet skylight_mask;
-    if (!skylight_mask.Read(*trans_arena, *rb)) {
-      fprintf(stderr, "Failed to read skylight mask\n");
-      fflush(stderr);
-      break;
-    }
-
-    BitSet blocklight_mask;
-    if (!blocklight_mask.Read(*trans_arena, *rb)) {
-      fprintf(stderr, "Failed to read blocklight mask\n");
-      fflush(stderr);
-      break;
-    }
-
-    BitSet empty_skylight_mask;
-    if (!empty_skylight_mask.Read(*trans_arena, *rb)) {
-      fprintf(stderr, "Failed to read empty skylight mask\n");
-      fflush(stderr);
-      break;
-    }
-
-    BitSet empty_blocklight_mask;
-    if (!empty_blocklight_mask.Read(*trans_arena, *rb)) {
-      fprintf(stderr, "Failed to read empty blocklight mask\n");
-      fflush(stderr);
-      break;
     }
 
     for (size_t i = 0; i < kChunkColumnCount; ++i) {
       if (section->chunks[i]) {
-        memset(section->chunks[i]->lightmap, 0, sizeof(section->chunks[i]->lightmap));
+        section->chunks[i]->skylight.Clear(game->world.chunk_storage);
+        section->chunks[i]->blocklight.Clear(game->world.chunk_storage);
       }
     }
 
-    u64 skylight_array_count = 0;
-    rb->ReadVarInt(&skylight_array_count);
-
-    constexpr size_t kRecvSections = kChunkColumnCount + 2;
-
-    s32 column_offset = (game->dimension.min_y + 64) / 16;
-
-    for (size_t i = 0; i < kRecvSections; ++i) {
-      if (!skylight_mask.IsSet(i)) continue;
-
-      u64 skylight_length = 0;
-
-      rb->ReadVarInt(&skylight_length);
-      rb->ReadRawString(&scratch_str, skylight_length);
-
-      if (i == 0 || i == kRecvSections - 1) continue;
-
-      size_t chunk_y = i - 1 + column_offset;
-
-      for (size_t index = 0; index < skylight_length; ++index) {
-        size_t block_data_index = index * 2;
-
-        if (section->chunks[chunk_y]) {
-          u8* lightmap = (u8*)section->chunks[chunk_y]->lightmap;
-
-          lightmap[block_data_index] = scratch_str.data[index] & 0x0F;
-          lightmap[block_data_index + 1] = (scratch_str.data[index] & 0xF0) >> 4;
-        }
-      }
-    }
-
-    u64 blocklight_array_count = 0;
-    rb->ReadVarInt(&blocklight_array_count);
-
-    for (size_t i = 0; i < kRecvSections + 2; ++i) {
-      if (!blocklight_mask.IsSet(i)) continue;
-
-      u64 blocklight_length = 0;
-
-      rb->ReadVarInt(&blocklight_length);
-      rb->ReadRawString(&scratch_str, blocklight_length);
-
-      if (i == 0 || i == kRecvSections - 1) continue;
-
-      size_t chunk_y = i - 1 + column_offset;
-
-      for (size_t index = 0; index < blocklight_length; ++index) {
-        size_t block_data_index = index * 2;
-
-        if (section->chunks[chunk_y]) {
-          u8* lightmap = (u8*)section->chunks[chunk_y]->lightmap;
-
-          // Merge the block lightmap into the packed chunk lightmap
-          lightmap[block_data_index] |= (scratch_str.data[index] & 0x0F) << 4;
-          lightmap[block_data_index + 1] |= (scratch_str.data[index] & 0xF0);
-        }
-      }
-    }
+    // The whole column is already dirty from the load, so the changed set isn't needed.
+    u32 light_changed_set = 0;
+    ReadLightData(rb, game, section, &light_changed_set);
   } break;
   case ProtocolId::PlayerInfoUpdate: {
     u8 action_bitmask = rb->ReadU8();
@@ -619,7 +671,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
     for (u64 i = 0; i < action_count; ++i) {
       ArenaSnapshot snapshot = trans_arena->GetSnapshot();
 
-      String uuid_string = rb->ReadAllocRawString(*trans_arena, 16);
+      String uuid_string = rb->ReadRawStringView(16);
 
       if (uuid_string.size != 16) {
         fprintf(stderr, "Failed to read PlayerInfoUpdate::uuid\n");
@@ -636,31 +688,19 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
       };
 
       if (action_bitmask & AddAction) {
-        String name = rb->ReadAllocString(*trans_arena);
-
-        String property_name;
-        property_name.data = memory_arena_push_type_count(trans_arena, char, 32767);
-        property_name.size = 32767;
-
-        String property_value;
-        property_value.data = memory_arena_push_type_count(trans_arena, char, 32767);
-        property_value.size = 32767;
-
-        String signature;
-        signature.data = memory_arena_push_type_count(trans_arena, char, 32767);
-        signature.size = 32767;
+        String name = rb->ReadStringView();
 
         u64 property_count;
         rb->ReadVarInt(&property_count);
 
         for (size_t i = 0; i < property_count; ++i) {
-          property_name.size = rb->ReadString(&property_name);
-          property_value.size = rb->ReadString(&property_value);
+          String property_name = rb->ReadStringView();
+          String property_value = rb->ReadStringView();
 
           u8 is_signed = rb->ReadU8();
 
           if (is_signed) {
-            signature.size = rb->ReadString(&signature);
+            String signature = rb->ReadStringView();
           }
         }
 
@@ -673,7 +713,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
         bool has_signature = rb->ReadU8();
 
         if (has_signature) {
-          String chat_session_id = rb->ReadAllocRawString(*trans_arena, 16);
+          String chat_session_id = rb->ReadRawStringView(16);
 
           if (chat_session_id.size != 16) {
             fprintf(stderr, "Failed to read PlayerInfoAction::InitializeChat::chat_session_id\n");
@@ -688,7 +728,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
             break;
           }
 
-          String encoded_public_key = rb->ReadAllocRawString(*trans_arena, encoded_public_key_size);
+          String encoded_public_key = rb->ReadRawStringView((size_t)encoded_public_key_size);
 
           if (encoded_public_key.size != encoded_public_key_size) {
             fprintf(stderr, "Failed to read PlayerInfoAction::InitializeChat::encoded_public_key\n");
@@ -702,7 +742,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
             break;
           }
 
-          String public_key_sig = rb->ReadAllocRawString(*trans_arena, public_key_sig_size);
+          String public_key_sig = rb->ReadRawStringView((size_t)public_key_sig_size);
 
           if (public_key_sig.size != public_key_sig_size) {
             fprintf(stderr, "Failed to read PlayerInfoAction::InitializeChat::public_key_sig\n");
@@ -745,7 +785,7 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
         bool has_display_name = rb->ReadU8();
 
         if (has_display_name) {
-          String display_name = rb->ReadAllocString(*trans_arena);
+          String display_name = rb->ReadStringView();
         }
       }
 
@@ -757,13 +797,11 @@ void PacketInterpreter::InterpretPlay(RingBuffer* rb, u64 pkt_id, size_t pkt_siz
 
     rb->ReadVarInt(&player_count);
 
-    String uuid_string;
+    for (u64 i = 0; i < player_count; ++i) {
+      String uuid_string = rb->ReadRawStringView(16);
 
-    uuid_string.data = memory_arena_push_type_count(trans_arena, char, 16);
-    uuid_string.size = 16;
+      if (uuid_string.size != 16) break;
 
-    for (u64 i = 0; i < player_count; ++i) {
-      rb->ReadRawString(&uuid_string, 16);
       game->player_manager.RemovePlayer(uuid_string);
     }
   } break;
@@ -795,19 +833,19 @@ void PacketInterpreter::InterpretConfiguration(RingBuffer* rb, u64 pkt_id, size_
 
   switch (type) {
   case ProtocolId::CookieRequest: {
-    String cookie_request = rb->ReadAllocString(*trans_arena);
+    String cookie_request = rb->ReadStringView();
 
     printf("ConfigurationProtocol::CookieRequest: %.*s\n", (int)cookie_request.size, cookie_request.data);
   } break;
   case ProtocolId::PluginMessage: {
-    String channel = rb->ReadAllocString(*trans_arena);
+    String channel = rb->ReadStringView();
 
     if (channel.size > 0) {
       printf("ConfigurationProtocol::PluginMessage on channel %.*s\n", (int)channel.size, channel.data);
     }
   } break;
   case ProtocolId::Disconnect: {
-    String reason = rb->ReadAllocString(*trans_arena);
+    String reason = rb->ReadStringView();
 
     if (reason.size > 0) {
       printf("ConfigurationProtocol::Disconnect: %.*s\n", (int)reason.size, reason.data);
@@ -833,7 +871,7 @@ void PacketInterpreter::InterpretConfiguration(RingBuffer* rb, u64 pkt_id, size_
   } break;
   case ProtocolId::RegistryData: {
     // This registry type holds what kind of registry is being received. Biome, banner, dimensions, etc.
-    String registry_type = rb->ReadAllocString(*trans_arena);
+    String registry_type = rb->ReadStringView();
 
     u64 entry_count = 0;
 
@@ -890,9 +928,9 @@ void PacketInterpreter::InterpretConfiguration(RingBuffer* rb, u64 pkt_id, size_
     rb->ReadVarInt(&pack_count);
 
     for (u64 i = 0; i < pack_count; ++i) {
-      String namespace_id = rb->ReadAllocString(*trans_arena);
-      String pack_id = rb->ReadAllocString(*trans_arena);
-      String version = rb->ReadAllocString(*trans_arena);
+      String namespace_id = rb->ReadStringView();
+      String pack_id = rb->ReadStringView();
+      String version = rb->ReadStringView();
 
       //
     }
@@ -921,7 +959,7 @@ void PacketInterpreter::InterpretLogin(RingBuffer* rb, u64 pkt_id, size_t pkt_si
 
   switch (type) {
   case ProtocolId::Disconnect: {
-    String reason = rb->ReadAllocString(*trans_arena);
+    String reason = rb->ReadStringView();
 
     if (reason.size > 0) {
       printf("LoginProtocol::Disconnect: %.*s\n", (int)reason.size, reason.data);
@@ -930,8 +968,68 @@ void PacketInterpreter::InterpretLogin(RingBuffer* rb, u64 pkt_id, size_t pkt_si
     connection->Disconnect();
   } break;
   case ProtocolId::EncryptionRequest: {
-    printf("LoginProtocol::EncryptionRequest: online-mode=true (server.properties) is not yet implemented.\n");
-    connection->Disconnect();
+    String server_id = rb->ReadStringView();
+    String public_key = rb->ReadStringView();
+    String verify_token = rb->ReadStringView();
+    bool should_authenticate = rb->ReadU8() != 0;
+
+    // Joining the session and responding would need the network and credentials, which a replay never uses.
+    if (replaying) break;
+
+    crypto::RsaPublicKey key;
+
+    if (!key.Parse((u8*)public_key.data, public_key.size)) {
+      fprintf(stderr, "LoginProtocol::EncryptionRequest: Failed to read the server's public key.\n");
+      connection->Disconnect();
+      break;
+    }
+
+    u8 shared_secret[crypto::kAes128KeySize];
+    std::random_device device;
+
+    for (size_t i = 0; i < sizeof(shared_secret); ++i) {
+      shared_secret[i] = (u8)device();
+    }
+
+    if (should_authenticate) {
+      if (access_token.size == 0 || !has_profile_id) {
+        fprintf(stderr, "LoginProtocol::EncryptionRequest: Server is in online mode. Use --access-token and --uuid.\n");
+        connection->Disconnect();
+        break;
+      }
+
+      crypto::Sha1 sha;
+      u8 digest[crypto::kSha1DigestSize];
+      char server_hash[42];
+
+      sha.Update((u8*)server_id.data, server_id.size);
+      sha.Update(shared_secret, sizeof(shared_secret));
+      sha.Update((u8*)public_key.data, public_key.size);
+      sha.Final(digest);
+
+      crypto::FormatServerHash(digest, server_hash);
+
+      // This blocks on purpose. The server doesn't send anything else until it gets the EncryptionResponse.
+      if (!JoinSession(access_token, profile_id, server_hash)) {
+        connection->Disconnect();
+        break;
+      }
+    }
+
+    u8 encrypted_secret[crypto::RsaPublicKey::kMaxBits / 8];
+    u8 encrypted_token[crypto::RsaPublicKey::kMaxBits / 8];
+
+    if (!key.Encrypt(shared_secret, sizeof(shared_secret), encrypted_secret) ||
+        !key.Encrypt((u8*)verify_token.data, verify_token.size, encrypted_token)) {
+      fprintf(stderr, "LoginProtocol::EncryptionRequest: Server's public key is too small.\n");
+      connection->Disconnect();
+      break;
+    }
+
+    outbound::login::SendEncryptionResponse(*connection, encrypted_secret, key.size, encrypted_token, key.size);
+    connection->EnableEncryption(shared_secret);
+
+    printf("LoginProtocol::EncryptionRequest: Enabled encryption.\n");
   } break;
   case ProtocolId::LoginSuccess: {
     printf("LoginProtocol::LoginSuccess: Transitioning to ConfigurationProtocol.\n");
@@ -947,8 +1045,15 @@ void PacketInterpreter::InterpretLogin(RingBuffer* rb, u64 pkt_id, size_t pkt_si
     outbound::configuration::SendClientInformation(*connection, view_distance, 0x7F, 1);
   } break;
   case ProtocolId::SetCompression: {
-    compression = true;
-    connection->builder.flags &= ~(PacketBuilder::BuildFlag_OmitCompress);
+    u64 threshold = 0;
+
+    if (!rb->ReadVarInt(&threshold)) {
+      fprintf(stderr, "LoginProtocol::SetCompression: Failed to read threshold.\n");
+      break;
+    }
+
+    // Inbound framing is switched over by the network thread, so only the outbound builder needs to know.
+    connection->builder.SetCompressionThreshold((s32)threshold);
   } break;
   default:
     break;
@@ -970,88 +1075,165 @@ void PacketInterpreter::InterpretStatus(RingBuffer* rb, u64 pkt_id, size_t pkt_s
 #endif
 }
 
+// The delimiter has no fields, and its id is zero so the varint is a single byte.
+static inline bool IsBundleDelimiter(const PacketQueue::Packet& packet) {
+  return packet.size == 1 && packet.data[0] == (u8)inbound::play::ProtocolId::BundleDelimiter;
+}
+
+// Finds the delimiter that closes the bundle opened by the packet at the front of the queue.
+// Returns false if the server hasn't finished sending the bundle yet.
+static bool FindBundleEnd(PacketQueue* queue, size_t* bundle_count) {
+  size_t cursor = queue->read_offset.load(std::memory_order_relaxed);
+  PacketQueue::Packet packet;
+
+  // Skip the opening delimiter.
+  queue->PeekNext(&cursor, &packet);
+
+  size_t count = 0;
+
+  while (queue->PeekNext(&cursor, &packet)) {
+    if (IsBundleDelimiter(packet)) {
+      *bundle_count = count;
+      return true;
+    }
+
+    ++count;
+  }
+
+  return false;
+}
+
+void PacketInterpreter::InterpretPacket(const PacketQueue::Packet& packet) {
+  Connection* connection = &game->connection;
+
+  // The packet queue is mirrored in virtual memory, so the packet can be read without wrapping.
+  RingBuffer packet_buffer(packet.data, connection->packet_queue.size);
+  RingBuffer* rb = &packet_buffer;
+  u64 pkt_id = 0;
+
+  rb->write_offset = packet.size;
+
+  bool id_read = rb->ReadVarInt(&pkt_id);
+  assert(id_read);
+
+  chunk_decode = (ChunkDataDecode*)packet.attachment;
+
+  // Interpreting can change the state, so grab the one that the packet belongs to first.
+  ProtocolState packet_state = connection->protocol_state;
+  u64 start_cycles = ReadCycleCounter();
+
+  switch (packet_state) {
+  case ProtocolState::Status:
+    this->InterpretStatus(rb, pkt_id, packet.size);
+    break;
+  case ProtocolState::Login:
+    this->InterpretLogin(rb, pkt_id, packet.size);
+    break;
+  case ProtocolState::Configuration: {
+    this->InterpretConfiguration(rb, pkt_id, packet.size);
+  } break;
+  case ProtocolState::Play:
+    this->InterpretPlay(rb, pkt_id, packet.size);
+    break;
+  default:
+    break;
+  }
+
+  profiler.Record(packet_state, pkt_id, packet.wire_size, packet.size, ReadCycleCounter() - start_cycles);
+
+  connection->decode_pipeline.Release(packet.attachment);
+  chunk_decode = nullptr;
+}
+
 size_t PacketInterpreter::Interpret() {
   MemoryArena* trans_arena = game->trans_arena;
   Connection* connection = &game->connection;
-  RingBuffer* rb = &connection->read_buffer;
+  PacketQueue* queue = &connection->packet_queue;
 
   size_t processed_count = 0;
+  PacketQueue::Packet packet;
 
-  do {
-    size_t offset_snapshot = rb->read_offset;
-    u64 pkt_size = 0;
-    u64 pkt_id = 0;
-
-    if (!rb->ReadVarInt(&pkt_size)) {
-      break;
+  while (queue->Peek(&packet)) {
+    // Packets that failed to decompress are left empty to keep their place in the queue.
+    if (packet.size == 0) {
+      queue->Pop();
+      continue;
     }
 
-    if (rb->GetReadAmount() < pkt_size) {
-      rb->read_offset = offset_snapshot;
-      break;
-    }
+    if (connection->protocol_state == ProtocolState::Play && IsBundleDelimiter(packet)) {
+      if (streaming_bundle) {
+        // This closes a bundle that was applied as it arrived.
+        streaming_bundle = false;
+        game->world.FlushBlockEdits();
 
-    size_t target_offset = (rb->read_offset + pkt_size) % rb->size;
+        queue->Pop();
+        ++processed_count;
+        continue;
+      }
+
+      size_t bundle_count = 0;
 
-    if (compression) {
-      u64 payload_size;
+      if (!FindBundleEnd(queue, &bundle_count)) {
+        // Leave the bundle in the queue so the world is never drawn with only part of it applied.
+        if (++bundle_wait_frames < kMaxBundleWaitFrames) break;
 
-      rb->ReadVarInt(&payload_size);
+        // The bundle might be too large to ever fit in the queue, so apply it as it arrives instead.
+        streaming_bundle = true;
+        bundle_wait_frames = 0;
 
-      if (payload_size > 0) {
-        inflate_buffer.write_offset = inflate_buffer.read_offset = 0;
+        queue->Pop();
+        ++processed_count;
+        continue;
+      }
 
-        mz_ulong mz_size = (mz_ulong)inflate_buffer.size;
-        // Use the entire remaining packet as source length
-        mz_ulong source_len = (mz_ulong)(pkt_size - GetVarIntSize(payload_size));
+      bundle_wait_frames = 0;
 
-        // The connection read buffer is mirrored in virtual memory, so it is free to read off the end of the buffer for
-        // uncompressing.
-        int result =
-            mz_uncompress((u8*)inflate_buffer.data, (mz_ulong*)&mz_size, (u8*)rb->data + rb->read_offset, source_len);
+      // The whole bundle shares one arena snapshot and marks the sections it touched in one pass at the end.
+      MemoryRevert memory_snapshot = trans_arena->GetReverter();
 
-        if (result == MZ_OK) {
-          // Swap to inflate buffer and set pkt_size to new decompressed size.
-          rb = &inflate_buffer;
-          pkt_size = mz_size;
-        } else {
-          // Decompression failed.
-          fprintf(stderr, "Failed to decompress packet. Skipping.\n");
-          fflush(stderr);
-          rb->read_offset = target_offset;
-          continue;
+      queue->Pop();
+
+      for (size_t i = 0; i < bundle_count; ++i) {
+        if (!queue->Peek(&packet)) break;
+
+        if (packet.size > 0) {
+          InterpretPacket(packet);
         }
+
+        queue->Pop();
       }
-    }
 
-    bool id_read = rb->ReadVarInt(&pkt_id);
-    assert(id_read);
+      // Pop the closing delimiter.
+      queue->Pop();
 
-    MemoryRevert memory_snapshot = trans_arena->GetReverter();
+      game->world.FlushBlockEdits();
 
-    switch (connection->protocol_state) {
-    case ProtocolState::Status:
-      this->InterpretStatus(rb, pkt_id, (size_t)pkt_size);
-      break;
-    case ProtocolState::Login:
-      this->InterpretLogin(rb, pkt_id, (size_t)pkt_size);
-      break;
-    case ProtocolState::Configuration: {
-      this->InterpretConfiguration(rb, pkt_id, (size_t)pkt_size);
-    } break;
-    case ProtocolState::Play:
-      this->InterpretPlay(rb, pkt_id, (size_t)pkt_size);
-      break;
-    default:
-      break;
+      processed_count += bundle_count + 2;
+      continue;
     }
 
-    rb = &connection->read_buffer;
+    MemoryRevert memory_snapshot = trans_arena->GetReverter();
+
+    InterpretPacket(packet);
 
-    // Always skip to the next packet in case some data wasn't read.
-    rb->read_offset = target_offset;
+    // Sections touched by block edits are marked for rebuilding once per packet instead of once per block.
+    if (!streaming_bundle) {
+      game->world.FlushBlockEdits();
+    }
+
+    queue->Pop();
     ++processed_count;
-  } while (rb->read_offset != rb->write_offset);
+  }
+
+  profiler.Update();
+
+  render::ChunkRenderer* chunk_renderer = &game->chunk_renderer;
+
+  // Wait for the mesher to catch up before acknowledging, so the reported rate includes the time spent meshing.
+  while (chunk_batches.IsReady(chunk_renderer->mesh_backlog, chunk_renderer->draw_count,
+                               render::MeshScheduler::kMaxSubmitPerFrame)) {
+    outbound::play::SendChunkBatchReceived(*connection, chunk_batches.Acknowledge());
+  }
 
   return processed_count;
 }
@@ -2,24 +2,54 @@
 #define POLYMER_PACKET_INTERPRETER_H_
 
 #include <polymer/buffer.h>
+#include <polymer/chunk_batch.h>
+#include <polymer/packet_profiler.h>
+#include <polymer/packet_queue.h>
+#include <polymer/session.h>
 #include <polymer/types.h>
 
 namespace polymer {
 
+struct ChunkDataDecode;
 struct GameState;
 
 struct PacketInterpreter {
   GameState* game;
-  bool compression;
 
-  RingBuffer inflate_buffer;
+  // Sections that the decode pipeline already unpacked for the ChunkData packet being interpreted.
+  ChunkDataDecode* chunk_decode = nullptr;
+
+  // Counts and times every packet that gets interpreted.
+  PacketProfiler profiler;
+
+  // Times chunk batches so the server can be told how fast chunks are being handled.
+  ChunkBatchTracker chunk_batches;
+
+  // Frames to hold back an incomplete bundle before applying it as it arrives.
+  constexpr static u32 kMaxBundleWaitFrames = 30;
+
+  u32 bundle_wait_frames = 0;
+  // Set when a bundle is being applied as it arrives, so block edits are only flushed once it closes.
+  bool streaming_bundle = false;
+
+  // Used to join online-mode servers. The token is empty when playing offline.
+  String access_token;
+  u8 profile_id[kProfileIdSize] = {};
+  bool has_profile_id = false;
+
+  // Set while a capture is replayed. The capture was recorded after decryption and there's no server to answer, so
+  // the login handshake is skipped.
+  bool replaying = false;
 
   PacketInterpreter(GameState* game);
 
-  // Returns the packet interpreted count.
+  // Interprets every packet waiting in the connection's packet queue. Returns the packet interpreted count.
+  // Bundles are only applied once all of their packets have arrived, so a frame never sees half of one.
   size_t Interpret();
 
 private:
+  // Interprets one packet and releases its attachment. The caller owns the arena snapshot and the queue.
+  void InterpretPacket(const PacketQueue::Packet& packet);
   void InterpretStatus(RingBuffer* rb, u64 pkt_id, size_t pkt_size);
   void InterpretLogin(RingBuffer* rb, u64 pkt_id, size_t pkt_size);
   void InterpretConfiguration(RingBuffer* rb, u64 pkt_id, size_t pkt_size);
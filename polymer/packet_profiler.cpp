@@ -0,0 +1,293 @@
+#include <polymer/packet_profiler.h>
+
+#include <polymer/ui/debug.h>
+
+#include <string.h>
+
+namespace polymer {
+
+static const char* kStatusNames[] = {"Response", "Pong"};
+static_assert(polymer_array_count(kStatusNames) == (size_t)inbound::status::ProtocolId::Count,
+              "Packet names must match the protocol ids.");
+
+static const char* kLoginNames[] = {
+    "Disconnect", "EncryptionRequest", "LoginSuccess", "SetCompression", "LoginPluginRequest", "CookieRequest"};
+static_assert(polymer_array_count(kLoginNames) == (size_t)inbound::login::ProtocolId::Count,
+              "Packet names must match the protocol ids.");
+
+static const char* kConfigurationNames[] = {
+    "CookieRequest", "PluginMessage", "Disconnect", "Finish", "KeepAlive", "Ping", "ResetChat", "RegistryData",
+    "RemoveResourcePack", "AddResourcePack", "StoreCookie", "Transfer", "FeatureFlags", "UpdateTags", "KnownPacks",
+    "CustomReportDetails", "ServerLinks"};
+static_assert(polymer_array_count(kConfigurationNames) == (size_t)inbound::configuration::ProtocolId::Count,
+              "Packet names must match the protocol ids.");
+
+static const char* kPlayNames[] = {
+    "BundleDelimiter", "SpawnEntity", "SpawnExperienceOrb", "EntityAnimation", "AwardStatistics",
+    "AcknowledgeBlockChange", "SetBlockDestroyStage", "BlockEntityData", "BlockAction", "BlockUpdate", "BossBar",
+    "ChangeDifficulty", "ChunkBatchFinished", "ChunkBatchStart", "ChunkBiomes", "ClearTitles",
+    "CommandSuggestionsResponse", "Commands", "CloseContainer", "SetContainerContent", "SetContainerProperty",
+    "SetContainerSlot", "CookieRequest", "SetCooldown", "ChatSuggestions", "PluginMessage", "DamageEvent",
+    "DebugSample", "DeleteMessage", "Disconnect", "DisguisedChatMessage", "EntityEvent", "TeleportEntity", "Explosion",
+    "UnloadChunk", "GameEvent", "OpenHorseScreen", "HurtAnimation", "InitializeWorldBorder", "KeepAlive", "ChunkData",
+    "WorldEvent", "Particle", "UpdateLight", "Login", "MapData", "MerchantOffers", "EntityPosition",
+    "EntityPositionAndRotation", "MoveMinecart", "EntityRotation", "VehicleMove", "OpenBook", "OpenScreen",
+    "OpenSignEditor", "Ping", "PingResponse", "PlaceGhostRecipe", "PlayerAbilities", "PlayerChatMessage",
+    "EndCombatEvent", "EnterCombatEvent", "DeathCombatEvent", "PlayerInfoRemove", "PlayerInfoUpdate", "LookAt",
+    "PlayerPositionAndLook", "PlayerRotation", "RecipeBookAdd", "RecipeBookRemove", "RecipeBookSettings",
+    "RemoveEntities", "RemoveEntityEffect", "ResetScore", "RemoveResourcePack", "AddResourcePack", "Respawn",
+    "SetHeadRotation", "UpdateSectionBlocks", "SelectAdvancementTab", "ServerData", "SetActionBarText",
+    "WorldBorderCenter", "WorldBorderLerpSize", "WorldBorderSize", "WorldBorderWarningDelay",
+    "WorldBorderWarningDistance", "Camera", "SetCenterChunk", "SetRenderDistance", "SetCursorItem",
+    "SetDefaultSpawnPosition", "DisplayObjective", "EntityMetadata", "LinkEntities", "EntityVelocity",
+    "EntityEquipment", "SetExperience", "UpdateHealth", "SetHeldItem", "UpdateObjectives", "SetPassengers",
+    "SetPlayerInventorySlot", "UpdateTeams", "UpdateScore", "UpdateSimulationDistance", "SetSubtitleText", "TimeUpdate",
+    "SetTitleText", "SetTitleAnimationTimes", "EntitySoundEffect", "SoundEffect", "StartConfiguration", "StopSound",
+    "StoreCookie", "SystemChatMessage", "PlayerListHeaderAndFooter", "NBTQueryResponse", "CollectItem",
+    "SynchronizeVehiclePosition", "SetTickingState", "StepTick", "Transfer", "UpdateAdvancements", "UpdateAttributes",
+    "EntityEffect", "UpdateRecipes", "Tags", "ProjectilePower", "CustomReportDetails", "ServerLinks"};
+static_assert(polymer_array_count(kPlayNames) == (size_t)inbound::play::ProtocolId::Count,
+              "Packet names must match the protocol ids.");
+
+PacketProfiler::PacketProfiler() {
+  memset(entries, 0, sizeof(entries));
+
+  start_cycles = ReadCycleCounter();
+  start_time = window_time = std::chrono::steady_clock::now();
+}
+
+void PacketProfiler::Update() {
+  auto now = std::chrono::steady_clock::now();
+
+  if (now - window_time < std::chrono::seconds(1)) return;
+
+  window_time = now;
+
+  for (size_t state = 0; state < kStateCount; ++state) {
+    for (size_t slot = 0; slot < kSlotCount; ++slot) {
+      Entry& entry = entries[state][slot];
+
+      entry.last_count = entry.window_count;
+      entry.last_cycles = entry.window_cycles;
+      entry.window_count = 0;
+      entry.window_cycles = 0;
+    }
+  }
+}
+
+void PacketProfiler::Render(ui::DebugTextSystem& debug, size_t count) {
+  constexpr size_t kMaxRenderCount = 16;
+
+  if (count == 0) return;
+  if (count > kMaxRenderCount) count = kMaxRenderCount;
+
+  Entry* top[kMaxRenderCount];
+  size_t top_states[kMaxRenderCount];
+  size_t top_slots[kMaxRenderCount];
+  size_t top_count = 0;
+
+  // Insertion sort into a small fixed list, since only a few entries are shown.
+  for (size_t state = 0; state < kStateCount; ++state) {
+    for (size_t slot = 0; slot < kSlotCount; ++slot) {
+      Entry* entry = &entries[state][slot];
+
+      if (entry->last_count == 0) continue;
+      if (top_count == count && entry->last_cycles <= top[top_count - 1]->last_cycles) continue;
+
+      size_t index = top_count < count ? top_count++ : count - 1;
+
+      while (index > 0 && top[index - 1]->last_cycles < entry->last_cycles) {
+        top[index] = top[index - 1];
+        top_states[index] = top_states[index - 1];
+        top_slots[index] = top_slots[index - 1];
+        --index;
+      }
+
+      top[index] = entry;
+      top_states[index] = state;
+      top_slots[index] = slot;
+    }
+  }
+
+  double cycles_per_us = GetCyclesPerMicrosecond();
+
+  debug.Write("packets (last second):");
+
+  for (size_t i = 0; i < top_count; ++i) {
+    ProtocolState state = (ProtocolState)top_states[i];
+    const char* name = GetPacketName(state, top_slots[i]);
+    unsigned long long packet_count = top[i]->last_count;
+    double total_ms = top[i]->last_cycles / cycles_per_us / 1000.0;
+
+    if (name) {
+      debug.Write("%s %s: %llu %.02fms", GetStateName(state), name, packet_count, total_ms);
+    } else {
+      debug.Write("%s 0x%02zX: %llu %.02fms", GetStateName(state), top_slots[i], packet_count, total_ms);
+    }
+  }
+}
+
+bool PacketProfiler::Write(const char* path) {
+  FILE* f = fopen(path, "w");
+
+  if (!f) {
+    fprintf(stderr, "Failed to open packet stats file '%s'.\n", path);
+    return false;
+  }
+
+  size_t path_length = strlen(path);
+  bool json = path_length >= 5 && strcmp(path + path_length - 5, ".json") == 0;
+  double cycles_per_us = GetCyclesPerMicrosecond();
+
+  bool result = json ? WriteJson(f, cycles_per_us) : WriteCsv(f, cycles_per_us);
+
+  if (fclose(f) != 0) result = false;
+
+  if (!result) {
+    fprintf(stderr, "Failed to write packet stats file '%s'.\n", path);
+  }
+
+  return result;
+}
+
+bool PacketProfiler::WriteCsv(FILE* f, double cycles_per_us) {
+  fprintf(f, "state,id,name,count,wire_bytes,data_bytes,total_us,mean_us,max_us");
+
+  // Histogram columns are named by the upper bound of the bucket in cycles.
+  for (size_t i = 0; i < kHistogramBuckets - 1; ++i) {
+    fprintf(f, ",lt_%llu", 1ULL << (kFirstBucketShift + i));
+  }
+
+  fprintf(f, ",ge_%llu\n", 1ULL << (kFirstBucketShift + kHistogramBuckets - 2));
+
+  for (size_t state = 0; state < kStateCount; ++state) {
+    for (size_t slot = 0; slot < kSlotCount; ++slot) {
+      Entry& entry = entries[state][slot];
+
+      if (entry.count == 0) continue;
+
+      const char* name = GetPacketName((ProtocolState)state, slot);
+      double total_us = entry.cycles / cycles_per_us;
+
+      fprintf(f, "%s,%zu,%s,%llu,%llu,%llu,%.3f,%.3f,%.3f", GetStateName((ProtocolState)state), slot,
+              name ? name : "Unknown", (unsigned long long)entry.count, (unsigned long long)entry.wire_bytes,
+              (unsigned long long)entry.data_bytes, total_us, total_us / entry.count, entry.max_cycles / cycles_per_us);
+
+      for (size_t i = 0; i < kHistogramBuckets; ++i) {
+        fprintf(f, ",%u", entry.histogram[i]);
+      }
+
+      fprintf(f, "\n");
+    }
+  }
+
+  return !ferror(f);
+}
+
+bool PacketProfiler::WriteJson(FILE* f, double cycles_per_us) {
+  fprintf(f, "{\n  \"cycles_per_us\": %.3f,\n", cycles_per_us);
+
+  // The last bucket has no upper bound.
+  fprintf(f, "  \"histogram_bounds\": [");
+
+  for (size_t i = 0; i < kHistogramBuckets - 1; ++i) {
+    fprintf(f, "%s%llu", i > 0 ? ", " : "", 1ULL << (kFirstBucketShift + i));
+  }
+
+  fprintf(f, "],\n  \"packets\": [");
+
+  bool first = true;
+
+  for (size_t state = 0; state < kStateCount; ++state) {
+    for (size_t slot = 0; slot < kSlotCount; ++slot) {
+      Entry& entry = entries[state][slot];
+
+      if (entry.count == 0) continue;
+
+      const char* name = GetPacketName((ProtocolState)state, slot);
+      double total_us = entry.cycles / cycles_per_us;
+
+      fprintf(f, "%s\n    {\"state\": \"%s\", \"id\": %zu, \"name\": \"%s\", \"count\": %llu, ", first ? "" : ",",
+              GetStateName((ProtocolState)state), slot, name ? name : "Unknown", (unsigned long long)entry.count);
+      fprintf(f, "\"wire_bytes\": %llu, \"data_bytes\": %llu, ", (unsigned long long)entry.wire_bytes,
+              (unsigned long long)entry.data_bytes);
+      fprintf(f, "\"total_us\": %.3f, \"mean_us\": %.3f, \"max_us\": %.3f, ", total_us, total_us / entry.count,
+              entry.max_cycles / cycles_per_us);
+      fprintf(f, "\"histogram\": [");
+
+      for (size_t i = 0; i < kHistogramBuckets; ++i) {
+        fprintf(f, "%s%u", i > 0 ? ", " : "", entry.histogram[i]);
+      }
+
+      fprintf(f, "]}");
+
+      first = false;
+    }
+  }
+
+  fprintf(f, "\n  ]\n}\n");
+
+  return !ferror(f);
+}
+
+double PacketProfiler::GetCyclesPerMicrosecond() const {
+#ifdef POLYMER_HAS_RDTSC
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  double elapsed_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  u64 cycles = ReadCycleCounter() - start_cycles;
+
+  if (elapsed_us <= 0.0 || cycles == 0) return 1.0;
+
+  return cycles / elapsed_us;
+#else
+  // The fallback counter is in nanoseconds.
+  return 1000.0;
+#endif
+}
+
+const char* PacketProfiler::GetStateName(ProtocolState state) {
+  switch (state) {
+  case ProtocolState::Handshake:
+    return "Handshake";
+  case ProtocolState::Status:
+    return "Status";
+  case ProtocolState::Login:
+    return "Login";
+  case ProtocolState::Configuration:
+    return "Configuration";
+  case ProtocolState::Play:
+    return "Play";
+  }
+
+  return "Unknown";
+}
+
+const char* PacketProfiler::GetPacketName(ProtocolState state, size_t pkt_id) {
+  const char** names = nullptr;
+  size_t count = 0;
+
+  switch (state) {
+  case ProtocolState::Status:
+    names = kStatusNames;
+    count = polymer_array_count(kStatusNames);
+    break;
+  case ProtocolState::Login:
+    names = kLoginNames;
+    count = polymer_array_count(kLoginNames);
+    break;
+  case ProtocolState::Configuration:
+    names = kConfigurationNames;
+    count = polymer_array_count(kConfigurationNames);
+    break;
+  case ProtocolState::Play:
+    names = kPlayNames;
+    count = polymer_array_count(kPlayNames);
+    break;
+  default:
+    break;
+  }
+
+  return pkt_id < count ? names[pkt_id] : nullptr;
+}
+
+} // namespace polymer
@@ -0,0 +1,128 @@
+#ifndef POLYMER_PACKET_PROFILER_H_
+#define POLYMER_PACKET_PROFILER_H_
+
+#include <polymer/protocol.h>
+#include <polymer/types.h>
+
+#include <chrono>
+#include <stdio.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define POLYMER_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define POLYMER_HAS_RDTSC 1
+#endif
+
+namespace polymer {
+namespace ui {
+
+struct DebugTextSystem;
+
+} // namespace ui
+
+inline u64 ReadCycleCounter() {
+#ifdef POLYMER_HAS_RDTSC
+  return __rdtsc();
+#else
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+#endif
+}
+
+// Counts and times every inbound packet by protocol state and id.
+// Each id has a fixed slot and the timings come from the cycle counter, so recording a packet is a few adds. It's
+// cheap enough to always be on.
+struct PacketProfiler {
+  constexpr static size_t kStateCount = (size_t)ProtocolState::Play + 1;
+  // Play has the most packets of any state. The extra slot collects ids that are past the known range.
+  constexpr static size_t kSlotCount = (size_t)inbound::play::ProtocolId::Count + 1;
+
+  // Decode times are bucketed by powers of two. The first bucket is everything below 2^kFirstBucketShift cycles and
+  // the last bucket is everything past the end.
+  constexpr static size_t kHistogramBuckets = 16;
+  constexpr static u64 kFirstBucketShift = 8;
+
+  struct Entry {
+    u64 count;
+    // Size of the packet as it was received, which is the compressed size for compressed packets.
+    u64 wire_bytes;
+    u64 data_bytes;
+    u64 cycles;
+    u64 max_cycles;
+    u32 histogram[kHistogramBuckets];
+
+    // Totals for the current and previous one second window, used for the overlay.
+    u64 window_count;
+    u64 window_cycles;
+    u64 last_count;
+    u64 last_cycles;
+  };
+
+  Entry entries[kStateCount][kSlotCount];
+
+  PacketProfiler();
+
+  inline void Record(ProtocolState state, u64 pkt_id, size_t wire_size, size_t data_size, u64 cycles) {
+    size_t slot = pkt_id < kSlotCount - 1 ? (size_t)pkt_id : kSlotCount - 1;
+    Entry& entry = entries[(size_t)state][slot];
+
+    ++entry.count;
+    entry.wire_bytes += wire_size;
+    entry.data_bytes += data_size;
+    entry.cycles += cycles;
+    if (cycles > entry.max_cycles) entry.max_cycles = cycles;
+    ++entry.histogram[GetBucket(cycles)];
+
+    ++entry.window_count;
+    entry.window_cycles += cycles;
+  }
+
+  // Rolls the overlay window over once a second.
+  void Update();
+
+  // Renders the packets that took the most time in the last window.
+  void Render(ui::DebugTextSystem& debug, size_t count);
+
+  // Writes every packet that was seen. The output is JSON when the path ends with .json and CSV otherwise.
+  bool Write(const char* path);
+
+  inline static size_t GetBucket(u64 cycles) {
+    u64 scaled = cycles >> kFirstBucketShift;
+
+    if (scaled == 0) return 0;
+
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, scaled);
+    size_t bucket = index + 1;
+#else
+    size_t bucket = 64 - __builtin_clzll(scaled);
+#endif
+
+    return bucket < kHistogramBuckets ? bucket : kHistogramBuckets - 1;
+  }
+
+  // Converts cycles to microseconds using the rate measured since the profiler was created.
+  double GetCyclesPerMicrosecond() const;
+
+  static const char* GetStateName(ProtocolState state);
+  // Returns null for ids that don't exist in the state.
+  static const char* GetPacketName(ProtocolState state, size_t pkt_id);
+
+private:
+  bool WriteCsv(FILE* f, double cycles_per_us);
+  bool WriteJson(FILE* f, double cycles_per_us);
+
+  u64 start_cycles;
+  std::chrono::steady_clock::time_point start_time;
+  std::chrono::steady_clock::time_point window_time;
+};
+
+} // namespace polymer
+
+#endif
@@ -0,0 +1,95 @@
+#include <polymer/packet_queue.h>
+
+#include <polymer/memory.h>
+
+#include <assert.h>
+
+namespace polymer {
+
+bool PacketQueue::Initialize(size_t size) {
+  this->data = AllocateMirroredBuffer(size);
+
+  if (!this->data) return false;
+
+  this->size = size;
+  this->reserve_offset = 0;
+  this->write_offset.store(0, std::memory_order_relaxed);
+  this->read_offset.store(0, std::memory_order_relaxed);
+
+  return true;
+}
+
+u8* PacketQueue::Reserve(size_t max_size) {
+  size_t read = read_offset.load(std::memory_order_acquire);
+  size_t record_size = GetRecordSize(max_size);
+
+  if (size - (reserve_offset - read) < record_size) {
+    return nullptr;
+  }
+
+  RecordHeader* header = (RecordHeader*)(data + (reserve_offset % size));
+
+  header->payload_size = 0;
+  header->record_size = (u32)record_size;
+  header->attachment = nullptr;
+
+  reserve_offset += record_size;
+
+  return (u8*)(header + 1);
+}
+
+void PacketQueue::Publish(size_t payload_size, size_t wire_size, void* attachment) {
+  size_t write = write_offset.load(std::memory_order_relaxed);
+  RecordHeader* header = (RecordHeader*)(data + (write % size));
+
+  assert(write != reserve_offset);
+  assert(GetRecordSize(payload_size) <= header->record_size);
+
+  header->payload_size = (u32)payload_size;
+  header->wire_size = (u32)wire_size;
+  header->attachment = attachment;
+
+  write_offset.store(write + header->record_size, std::memory_order_release);
+}
+
+bool PacketQueue::Peek(Packet* packet) {
+  size_t read = read_offset.load(std::memory_order_relaxed);
+  size_t write = write_offset.load(std::memory_order_acquire);
+
+  if (read == write) return false;
+
+  RecordHeader* header = (RecordHeader*)(data + (read % size));
+
+  packet->data = (u8*)(header + 1);
+  packet->size = header->payload_size;
+  packet->wire_size = header->wire_size;
+  packet->attachment = header->attachment;
+
+  return true;
+}
+
+bool PacketQueue::PeekNext(size_t* cursor, Packet* packet) {
+  size_t write = write_offset.load(std::memory_order_acquire);
+
+  if (*cursor == write) return false;
+
+  RecordHeader* header = (RecordHeader*)(data + (*cursor % size));
+
+  packet->data = (u8*)(header + 1);
+  packet->size = header->payload_size;
+  packet->wire_size = header->wire_size;
+  packet->attachment = header->attachment;
+
+  *cursor += header->record_size;
+
+  return true;
+}
+
+void PacketQueue::Pop() {
+  size_t read = read_offset.load(std::memory_order_relaxed);
+  RecordHeader* header = (RecordHeader*)(data + (read % size));
+
+  read_offset.store(read + header->record_size, std::memory_order_release);
+}
+
+} // namespace polymer
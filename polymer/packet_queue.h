@@ -0,0 +1,63 @@
+#ifndef POLYMER_PACKET_QUEUE_H_
+#define POLYMER_PACKET_QUEUE_H_
+
+#include <polymer/types.h>
+
+#include <atomic>
+
+namespace polymer {
+
+// Single-producer single-consumer queue of framed packets.
+// The backing memory is a mirrored buffer, so every record is contiguous even when it wraps the end of the buffer.
+// Records are stored as a header followed by the payload, padded to keep the headers aligned.
+// The offsets only ever increase and are wrapped when indexing into the data.
+struct PacketQueue {
+  struct Packet {
+    u8* data;
+    size_t size;
+    // Size of the packet as it was framed on the wire, which is the compressed size for compressed packets.
+    size_t wire_size;
+    // Optional decoded data that the producer attached to the packet.
+    void* attachment;
+  };
+
+  struct RecordHeader {
+    u32 payload_size;
+    u32 record_size;
+    u32 wire_size;
+    void* attachment;
+  };
+
+  u8* data = nullptr;
+  size_t size = 0;
+
+  alignas(64) std::atomic<size_t> write_offset{0};
+  alignas(64) std::atomic<size_t> read_offset{0};
+
+  // Only touched by the producer. This is ahead of write_offset while reservations are outstanding.
+  size_t reserve_offset = 0;
+
+  bool Initialize(size_t size);
+
+  // Producer: reserves space for a payload of max_size bytes. Returns nullptr if the queue doesn't have enough space.
+  // Multiple reservations can be outstanding, but they are published in the order they were reserved.
+  u8* Reserve(size_t max_size);
+  // Producer: publishes the oldest outstanding reservation. The size must not be larger than the reserved size.
+  void Publish(size_t size, size_t wire_size, void* attachment = nullptr);
+
+  // Consumer: returns false if there is no packet waiting.
+  bool Peek(Packet* packet);
+  // Consumer: releases the packet returned from Peek back to the producer.
+  void Pop();
+  // Consumer: reads ahead of Peek without releasing anything. The cursor starts at read_offset and is advanced past
+  // each packet returned. Returns false once the cursor reaches the last published packet.
+  bool PeekNext(size_t* cursor, Packet* packet);
+
+  inline static size_t GetRecordSize(size_t payload_size) {
+    return (sizeof(RecordHeader) + payload_size + 15) & ~(size_t)15;
+  }
+};
+
+} // namespace polymer
+
+#endif
@@ -97,10 +97,34 @@ struct LaunchArgs {
   u16 server_port;
   bool help;
 
+  // Inbound packets are written to this file when set.
+  String capture_path;
+  // A capture file to play back instead of connecting to a server.
+  String replay_path;
+  bool replay_realtime;
+  // Per-packet decode stats are written to this file on exit when set.
+  String packet_stats_path;
+  // Needed to join online-mode servers.
+  String access_token;
+  String uuid;
+  bool cipher_benchmark;
+  bool greedy_meshing;
+  // Meshes every loaded section with both meshers once the connection closes. Best used with --replay.
+  bool mesh_benchmark;
+
   static LaunchArgs Create(ArgParser& args) {
     const String kUsernameArgs[] = {POLY_STR("username"), POLY_STR("user"), POLY_STR("u")};
     const String kServerArgs[] = {POLY_STR("server"), POLY_STR("s")};
     const String kHelpArgs[] = {POLY_STR("help"), POLY_STR("h")};
+    const String kCaptureArgs[] = {POLY_STR("capture")};
+    const String kReplayArgs[] = {POLY_STR("replay")};
+    const String kReplayRealtimeArgs[] = {POLY_STR("replay-realtime")};
+    const String kPacketStatsArgs[] = {POLY_STR("packet-stats")};
+    const String kAccessTokenArgs[] = {POLY_STR("access-token")};
+    const String kUuidArgs[] = {POLY_STR("uuid")};
+    const String kCipherBenchmarkArgs[] = {POLY_STR("cipher-benchmark")};
+    const String kGreedyMeshingArgs[] = {POLY_STR("greedy-meshing")};
+    const String kMeshBenchmarkArgs[] = {POLY_STR("mesh-benchmark")};
 
     constexpr const char* kDefaultServerIp = "127.0.0.1";
     constexpr u16 kDefaultServerPort = 25565;
@@ -140,6 +164,16 @@ struct LaunchArgs {
 
     result.help = args.HasValue(kHelpArgs, polymer_array_count(kHelpArgs));
 
+    result.capture_path = args.GetValue(kCaptureArgs, polymer_array_count(kCaptureArgs));
+    result.replay_path = args.GetValue(kReplayArgs, polymer_array_count(kReplayArgs));
+    result.replay_realtime = args.HasValue(kReplayRealtimeArgs, polymer_array_count(kReplayRealtimeArgs));
+    result.packet_stats_path = args.GetValue(kPacketStatsArgs, polymer_array_count(kPacketStatsArgs));
+    result.access_token = args.GetValue(kAccessTokenArgs, polymer_array_count(kAccessTokenArgs));
+    result.uuid = args.GetValue(kUuidArgs, polymer_array_count(kUuidArgs));
+    result.cipher_benchmark = args.HasValue(kCipherBenchmarkArgs, polymer_array_count(kCipherBenchmarkArgs));
+    result.greedy_meshing = args.HasValue(kGreedyMeshingArgs, polymer_array_count(kGreedyMeshingArgs));
+    result.mesh_benchmark = args.HasValue(kMeshBenchmarkArgs, polymer_array_count(kMeshBenchmarkArgs));
+
     return result;
   }
 };
@@ -150,6 +184,15 @@ inline void PrintUsage() {
   printf("OPTIONS:\n");
   printf("\t-u, --user, --username\tOffline username. Default: polymer\n");
   printf("\t-s, --server\t\tDirect server. Default: 127.0.0.1:25565\n");
+  printf("\t--capture\t\tWrite inbound packets to a capture file.\n");
+  printf("\t--replay\t\tPlay back a capture file instead of connecting to a server.\n");
+  printf("\t--replay-realtime\tPlay back the capture at the recorded pace instead of as fast as possible.\n");
+  printf("\t--packet-stats\t\tWrite per-packet decode stats on exit. Uses JSON for .json files and CSV otherwise.\n");
+  printf("\t--access-token\t\tAccess token used to join online-mode servers. Requires --uuid.\n");
+  printf("\t--uuid\t\t\tProfile id of the account that owns the access token.\n");
+  printf("\t--cipher-benchmark\tCheck the encryption kernels and print their throughput.\n");
+  printf("\t--greedy-meshing\tMerge flat areas of full blocks into larger quads.\n");
+  printf("\t--mesh-benchmark\tCompare the meshers on every loaded section once the connection closes.\n");
 }
 
 } // namespace polymer
@@ -138,6 +138,9 @@ static void OnKeyDown(GLFWwindow* window, int key, int scancode, int action, int
     case GLFW_KEY_TAB: {
       g_input.display_players = action != GLFW_RELEASE;
     } break;
+    case GLFW_KEY_F3: {
+      g_input.display_packet_stats = action != GLFW_RELEASE;
+    } break;
     }
   } else if (action != GLFW_RELEASE) {
     switch (key) {
@@ -119,6 +119,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
       g_input.sprint = true;
     } else if (wParam == VK_TAB) {
       g_input.display_players = true;
+    } else if (wParam == VK_F3) {
+      g_input.display_packet_stats = true;
     }
   } break;
   case WM_KEYUP: {
@@ -138,6 +140,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
       g_input.sprint = false;
     } else if (wParam == VK_TAB) {
       g_input.display_players = false;
+    } else if (wParam == VK_F3) {
+      g_input.display_packet_stats = false;
     }
   } break;
   case WM_INPUT: {
@@ -1,14 +1,18 @@
 #include "polymer.h"
 
 #include <polymer/asset/asset_store.h>
+#include <polymer/capture.h>
 #include <polymer/connection.h>
+#include <polymer/crypto/aes.h>
 #include <polymer/gamestate.h>
 #include <polymer/packet_interpreter.h>
 #include <polymer/protocol.h>
+#include <polymer/render/mesh_benchmark.h>
 #include <polymer/ui/debug.h>
 #include <polymer/version.h>
 
 #include <chrono>
+#include <thread>
 
 namespace polymer {
 
@@ -28,8 +32,55 @@ Polymer::Polymer(MemoryArena& perm_arena, MemoryArena& trans_arena, int argc, ch
   renderer.trans_arena = &trans_arena;
 }
 
+bool Polymer::Connect(Connection* connection) {
+  printf("Connecting to '%.*s:%hu' with username '%.*s'.\n", (u32)args.server.size, args.server.data, args.server_port,
+         (u32)args.username.size, args.username.data);
+  fflush(stdout);
+
+  ConnectResult connect_result = connection->Connect(args.server.data, args.server_port);
+
+  switch (connect_result) {
+  case ConnectResult::ErrorSocket: {
+    fprintf(stderr, "Failed to create socket\n");
+    return false;
+  }
+  case ConnectResult::ErrorAddrInfo: {
+    fprintf(stderr, "Failed to get address info\n");
+    return false;
+  }
+  case ConnectResult::ErrorConnect: {
+    fprintf(stderr, "Failed to connect\n");
+    return false;
+  }
+  default:
+    break;
+  }
+
+  printf("Connected to server.\n");
+
+  connection->SetBlocking(false);
+
+  outbound::handshake::SendHandshake(*connection, kProtocolVersion, args.server.data, args.server.size,
+                                     args.server_port, ProtocolState::Login);
+
+  PacketInterpreter* interpreter = connection->interpreter;
+  const u8* profile_id = interpreter->has_profile_id ? interpreter->profile_id : nullptr;
+
+  outbound::login::SendLoginStart(*connection, args.username.data, args.username.size, profile_id);
+
+  if (!connection->StartNetworkThread()) {
+    fprintf(stderr, "Failed to start network thread\n");
+    connection->Disconnect();
+    return false;
+  }
+
+  return true;
+}
+
 int Polymer::Run(InputState* input) {
   constexpr size_t kMirrorBufferSize = 65536 * 32;
+  // Large enough to hold the biggest uncompressed packet the protocol allows.
+  constexpr size_t kPacketQueueSize = 65536 * 256;
 
   renderer.platform = &platform;
 
@@ -43,6 +94,10 @@ int Polymer::Run(InputState* input) {
     return 0;
   }
 
+  if (args.cipher_benchmark) {
+    return crypto::RunCipherBenchmark() ? 0 : 1;
+  }
+
   const char* platform_name = platform.GetPlatformName();
   printf("Polymer: %s\n", platform_name);
   fflush(stdout);
@@ -70,15 +125,33 @@ int Polymer::Run(InputState* input) {
 
   connection->interpreter = &interpreter;
 
+  interpreter.access_token = args.access_token;
+
+  if (args.uuid.size > 0) {
+    if (!ParseProfileId(args.uuid, interpreter.profile_id)) {
+      fprintf(stderr, "Invalid uuid '%.*s'.\n", (u32)args.uuid.size, args.uuid.data);
+      return 1;
+    }
+
+    interpreter.has_profile_id = true;
+  }
+
   // Allocate mirrored ring buffers so they can always be inflated
   connection->read_buffer.size = kMirrorBufferSize;
   connection->read_buffer.data = AllocateMirroredBuffer(connection->read_buffer.size);
   connection->write_buffer.size = kMirrorBufferSize;
   connection->write_buffer.data = AllocateMirroredBuffer(connection->write_buffer.size);
+  connection->read_buffer.mirrored = true;
+  connection->write_buffer.mirrored = true;
 
   assert(connection->read_buffer.data);
   assert(connection->write_buffer.data);
 
+  if (!connection->packet_queue.Initialize(kPacketQueueSize)) {
+    fprintf(stderr, "Failed to allocate packet queue.\n");
+    return 1;
+  }
+
   this->window = platform.WindowCreate(kWidth, kHeight);
 
   render::RenderConfig render_config = {};
@@ -96,6 +169,8 @@ int Polymer::Run(InputState* input) {
   render_config.view_distance = 3;
 #endif
 
+  render_config.greedy_meshing = args.greedy_meshing;
+
   renderer.Initialize(window, render_config);
 
   {
@@ -114,50 +189,49 @@ int Polymer::Run(InputState* input) {
     fflush(stdout);
 
     game->chunk_renderer.block_textures = game->assets.block_assets->block_textures;
+    game->chunk_renderer.texture_animations = game->assets.block_assets->texture_animations;
+    game->chunk_renderer.texture_animation_count = game->assets.block_assets->texture_animation_count;
     game->font_renderer.glyph_page_texture = game->assets.glyph_page_texture;
     game->font_renderer.glyph_size_table = game->assets.glyph_size_table;
 
+    u8* block_state_flags = render::CreateBlockStateFlags(perm_arena, game->block_registry);
+
     game->world.block_mesher.mapping.Initialize(game->block_registry);
+    game->world.block_mesher.greedy_meshing = render_config.greedy_meshing;
+    game->world.block_mesher.state_flags = block_state_flags;
+    game->world.light_engine.Initialize(perm_arena, game->block_registry);
+
+    // Leave a core each for the game and network threads.
+    size_t hardware_threads = std::thread::hardware_concurrency();
+    size_t mesh_worker_count = hardware_threads > 2 ? hardware_threads - 2 : 1;
+
+    game->world.mesh_pipeline.greedy_meshing = render_config.greedy_meshing;
+    game->world.mesh_pipeline.state_flags = block_state_flags;
+    game->world.mesh_pipeline.Start(game->assets, game->block_registry, mesh_worker_count);
   }
 
   game->chunk_renderer.CreateLayoutSet(renderer, renderer.device);
   game->font_renderer.CreateLayoutSet(renderer, renderer.device);
   renderer.RecreateSwapchain();
 
-  printf("Connecting to '%.*s:%hu' with username '%.*s'.\n", (u32)args.server.size, args.server.data, args.server_port,
-         (u32)args.username.size, args.username.data);
-  fflush(stdout);
-
-  ConnectResult connect_result = connection->Connect(args.server.data, args.server_port);
-
-  switch (connect_result) {
-  case ConnectResult::ErrorSocket: {
-    fprintf(stderr, "Failed to create socket\n");
-    return 1;
-  }
-  case ConnectResult::ErrorAddrInfo: {
-    fprintf(stderr, "Failed to get address info\n");
-    return 1;
-  }
-  case ConnectResult::ErrorConnect: {
-    fprintf(stderr, "Failed to connect\n");
-    return 1;
-  }
-  default:
-    break;
-  }
+  memcpy(game->player_manager.client_name, args.username.data, args.username.size);
+  game->player_manager.client_name[args.username.size] = 0;
 
-  printf("Connected to server.\n");
+  PacketCapture capture;
 
-  connection->SetBlocking(false);
+  if (args.capture_path.size > 0) {
+    if (!capture.Open(args.capture_path.data)) return 1;
 
-  outbound::handshake::SendHandshake(*connection, kProtocolVersion, args.server.data, args.server.size,
-                                     args.server_port, ProtocolState::Login);
+    connection->decode_pipeline.capture = &capture;
+  }
 
-  outbound::login::SendLoginStart(*connection, args.username.data, args.username.size);
+  if (args.replay_path.size > 0) {
+    printf("Replaying capture '%.*s'.\n", (u32)args.replay_path.size, args.replay_path.data);
 
-  memcpy(game->player_manager.client_name, args.username.data, args.username.size);
-  game->player_manager.client_name[args.username.size] = 0;
+    if (!connection->StartReplay(args.replay_path.data, args.replay_realtime)) return 1;
+  } else if (!Connect(connection)) {
+    return 1;
+  }
 
   fflush(stdout);
 
@@ -202,6 +276,18 @@ int Polymer::Run(InputState* input) {
       debug.Write("multisampling: %u", game->renderer->swapchain.multisample.samples);
       debug.Write("visible chunks: %zu", game->world.connectivity_graph.visible_count);
 
+      render::MeshScheduler& mesh_scheduler = game->world.mesh_scheduler;
+      debug.Write("mesh: built %zu submitted %zu backlog %zu (%lld us)", mesh_scheduler.immediate_count,
+                  mesh_scheduler.submit_count, game->chunk_renderer.mesh_backlog, (long long)mesh_scheduler.elapsed_us);
+
+      NetworkTickStats& net = connection->tick_stats;
+      debug.Write("net syscalls: recv %u send %u wait %u wake %u", net.recv_calls, net.send_calls, net.wait_calls,
+                  net.wake_calls);
+
+      if (input->display_packet_stats) {
+        interpreter.profiler.Render(debug, 10);
+      }
+
       game->font_renderer.Draw(game->command_buffers[renderer.current_frame], renderer.current_frame);
       game->SubmitFrame();
       renderer.Render();
@@ -215,6 +301,12 @@ int Polymer::Run(InputState* input) {
     average_frame_time = average_frame_time * 0.9f + frame_time * 0.1f;
   }
 
+  game->world.mesh_pipeline.Stop();
+
+  if (args.mesh_benchmark) {
+    render::RunMeshBenchmark(game->assets, game->block_registry, game->world);
+  }
+
   vkDeviceWaitIdle(renderer.device);
   game->world.FreeMeshes();
 
@@ -223,6 +315,12 @@ int Polymer::Run(InputState* input) {
 
   renderer.Shutdown();
 
+  capture.Close();
+
+  if (args.packet_stats_path.size > 0) {
+    interpreter.profiler.Write(args.packet_stats_path.data);
+  }
+
   return 0;
 }
 
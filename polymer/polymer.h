@@ -9,6 +9,7 @@
 
 namespace polymer {
 
+struct Connection;
 struct GameState;
 
 struct Polymer {
@@ -25,6 +26,10 @@ struct Polymer {
   Polymer(MemoryArena& perm_arena, MemoryArena& trans_arena, int argc, char** argv);
 
   int Run(InputState* input);
+
+private:
+  // Connects to the server from the launch args and starts logging in.
+  bool Connect(Connection* connection);
 };
 
 } // namespace polymer
@@ -25,16 +25,32 @@ void SendHandshake(Connection& connection, u32 version, const char* address, siz
 
 namespace login {
 
-void SendLoginStart(Connection& connection, const char* username, size_t username_size) {
+void SendLoginStart(Connection& connection, const char* username, size_t username_size, const u8* uuid) {
   auto& builder = connection.builder;
 
   builder.WriteString(username, username_size);
-  builder.WriteU64(0); // UUID start
-  builder.WriteU64(0); // UUID end
+
+  if (uuid) {
+    builder.WriteU64(LoadBigEndianU64(uuid));
+    builder.WriteU64(LoadBigEndianU64(uuid + 8));
+  } else {
+    builder.WriteU64(0); // UUID start
+    builder.WriteU64(0); // UUID end
+  }
 
   builder.Commit(connection.write_buffer, (u32)ProtocolId::LoginStart);
 }
 
+void SendEncryptionResponse(Connection& connection, const u8* shared_secret, size_t shared_secret_size,
+                            const u8* verify_token, size_t verify_token_size) {
+  auto& builder = connection.builder;
+
+  builder.WriteString((const char*)shared_secret, shared_secret_size);
+  builder.WriteString((const char*)verify_token, verify_token_size);
+
+  builder.Commit(connection.write_buffer, (u32)ProtocolId::EncryptionResponse);
+}
+
 void SendAcknowledged(Connection& connection) {
   auto& builder = connection.builder;
 
@@ -236,7 +236,10 @@ namespace login {
 
 enum class ProtocolId { LoginStart, EncryptionResponse, LoginPluginResponse, LoginAcknowledged, CookieResponse, Count };
 
-void SendLoginStart(Connection& connection, const char* username, size_t username_size);
+// The uuid is the 16 byte profile id, or null for offline mode.
+void SendLoginStart(Connection& connection, const char* username, size_t username_size, const u8* uuid);
+void SendEncryptionResponse(Connection& connection, const u8* shared_secret, size_t shared_secret_size,
+                            const u8* verify_token, size_t verify_token_size);
 void SendAcknowledged(Connection& connection);
 
 } // namespace login
@@ -14,6 +14,7 @@ using polymer::world::BlockModel;
 using polymer::world::BlockRegistry;
 using polymer::world::BlockState;
 using polymer::world::BlockStateInfo;
+using polymer::world::Chunk;
 using polymer::world::ChunkSection;
 using polymer::world::FaceQuad;
 using polymer::world::kChunkColumnCount;
@@ -59,27 +60,6 @@ bool ChunkBuildContext::GetNeighbors(world::World* world) {
   return IsBuildable();
 }
 
-struct BorderedChunk {
-  constexpr static size_t kElementCount = 18 * 18 * 18;
-
-  u32 blocks[kElementCount];
-
-  // The bottom 4 bits contain the skylight data and the upper 4 bits contain the block
-  u8 lightmap[kElementCount];
-
-  // Position is chunk relative
-  inline u8 GetBlockLight(size_t index) const {
-    return lightmap[index] >> 4;
-  }
-
-  // Position is chunk relative
-  inline u8 GetSkyLight(size_t index) const {
-    return lightmap[index] & 0x0F;
-  }
-};
-
-BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s32 chunk_y);
-
 struct LayerData {
   render::ChunkVertex* vertices;
   u32* count;
@@ -88,45 +68,86 @@ struct LayerData {
 struct PushContext {
   MemoryArena* vertex_arenas[kRenderLayerCount];
   MemoryArena* index_arenas[kRenderLayerCount];
+  // Indices are relative to the first vertex of the mesh, which isn't always at the start of the arena.
+  render::ChunkVertex* vertex_bases[kRenderLayerCount];
+
+  // World position of the section's minimum corner. Vertex positions are stored relative to it.
+  Vector3f origin;
+  // Maps a texture id to its entry in the texture animation table.
+  const u8* texture_animation_indices;
 
   void SetLayerData(RenderLayer layer, MemoryArena* vertex_arena, MemoryArena* index_arena) {
     vertex_arenas[(size_t)layer] = vertex_arena;
     index_arenas[(size_t)layer] = index_arena;
+    vertex_bases[(size_t)layer] = (render::ChunkVertex*)vertex_arena->current;
   }
 };
 
-static inline u16 PushVertex(PushContext& ctx, const Vector3f& position, const Vector2f& uv, RenderableFace* face,
-                             u16 light, u32 axis_data = 0) {
-  render::ChunkVertex* vertex =
-      (render::ChunkVertex*)ctx.vertex_arenas[face->render_layer]->Allocate(sizeof(render::ChunkVertex), 1);
+static inline u16 QuantizeVertexPosition(float relative) {
+  float value = (relative + render::kChunkVertexPositionBias) * render::kChunkVertexPositionScale + 0.5f;
 
-  vertex->position = position;
+  if (value < 0.0f) return 0;
+  if (value > 65535.0f) return 65535;
 
-  u16 uv_x = (u16)(uv.x * 16);
-  u16 uv_y = (u16)(uv.y * 16);
+  return (u16)value;
+}
 
-  vertex->packed_uv = (uv_x << 5) | (uv_y & 0x1F);
+static inline u32 GetVertexTint(u32 tintindex) {
+  if (tintindex <= 3) return tintindex;
+  if (tintindex == 50) return render::kChunkVertexWaterTint;
+  // Anything else that the model asks to tint gets the brightness adjustment without a color.
+  if (tintindex < 50) return render::kChunkVertexPlainTint;
 
-  vertex->texture_id = face->texture_id;
+  return render::kChunkVertexNoTint;
+}
 
-  u8 packed_anim = (u8)face->frame_count;
-  u8 tintindex = (u8)face->tintindex;
+// The uv bits hold the uv for regular faces. Tiled faces compute their uv from the position in the shader, so the bits
+// hold the face direction and whether the texture should be randomized per block instead.
+static inline u16 PushPackedVertex(PushContext& ctx, const Vector3f& position, u32 packed_uv, bool tiled,
+                                   RenderableFace* face, u16 light, u32 axis_data) {
+  render::ChunkVertex* vertex =
+      (render::ChunkVertex*)ctx.vertex_arenas[face->render_layer]->Allocate(sizeof(render::ChunkVertex), 1);
 
-  light |= (axis_data << 14);
+  vertex->x = QuantizeVertexPosition(position.x - ctx.origin.x);
+  vertex->y = QuantizeVertexPosition(position.y - ctx.origin.y);
+  vertex->z = QuantizeVertexPosition(position.z - ctx.origin.z);
 
-  vertex->packed_light = (packed_anim << 24) | (tintindex << 16) | light;
-  vertex->packed_frametime = face->frametime | (face->interpolated << 15);
+  u32 texture_id = face->texture_id & (render::kChunkVertexMaxTextures - 1);
+  // Some faces are forced to be static even though their texture is animated.
+  u32 animation_index = face->frame_count > 1 ? ctx.texture_animation_indices[texture_id] : 0;
 
-  size_t index = (vertex - (render::ChunkVertex*)ctx.vertex_arenas[face->render_layer]->base);
+  vertex->packed_light = light | (u16)(axis_data << 14);
+  vertex->packed_texture = texture_id | (packed_uv << render::kChunkVertexTextureBits) | ((u32)tiled << 22) |
+                           (animation_index << 23) | (GetVertexTint(face->tintindex) << 29);
+
+  size_t index = (vertex - ctx.vertex_bases[face->render_layer]);
   assert(index <= 65535);
   return (u16)index;
 }
 
+static inline u16 PushVertex(PushContext& ctx, const Vector3f& position, const Vector2f& uv, RenderableFace* face,
+                             u16 light, u32 axis_data = 0) {
+  u32 uv_x = (u32)(uv.x * 16) & 0x1F;
+  u32 uv_y = (u32)(uv.y * 16) & 0x1F;
+
+  return PushPackedVertex(ctx, position, (uv_x << 5) | uv_y, false, face, light, axis_data);
+}
+
 static inline void PushIndex(PushContext& ctx, u32 render_layer, u16 index) {
   u16* out = (u16*)ctx.index_arenas[render_layer]->Allocate(sizeof(index), 1);
   *out = index;
 }
 
+static inline void PushQuadIndices(PushContext& ctx, u32 render_layer, u16 bli, u16 bri, u16 tri, u16 tli) {
+  PushIndex(ctx, render_layer, bli);
+  PushIndex(ctx, render_layer, bri);
+  PushIndex(ctx, render_layer, tri);
+
+  PushIndex(ctx, render_layer, tri);
+  PushIndex(ctx, render_layer, tli);
+  PushIndex(ctx, render_layer, bli);
+}
+
 static inline bool HasOccludableFace(BlockModel& model, BlockFace face) {
   for (size_t i = 0; i < model.element_count; ++i) {
     RenderableFace& render_face = model.elements[i].faces[(size_t)face];
@@ -278,6 +299,89 @@ static inline bool IsOccluding(BlockModel* from, BlockModel* to, BlockFace face)
   return false;
 }
 
+// Which of a block's faces were already decided by the visibility masks. Bits are indexed by BlockFace.
+struct FaceVisibility {
+  u8 hidden;
+  u8 visible;
+};
+
+// Gathers the bits of the six neighbors of a block from a mask. The result is indexed by BlockFace.
+static inline u8 GetNeighborBits(const u32 rows[18][18], size_t x, size_t y, size_t z) {
+  u32 down = (rows[y - 1][z] >> x) & 1;
+  u32 up = (rows[y + 1][z] >> x) & 1;
+  u32 north = (rows[y][z - 1] >> x) & 1;
+  u32 south = (rows[y][z + 1] >> x) & 1;
+  u32 west = (rows[y][z] >> (x - 1)) & 1;
+  u32 east = (rows[y][z] >> (x + 1)) & 1;
+
+  return (u8)(down | (up << 1) | (north << 2) | (south << 3) | (west << 4) | (east << 5));
+}
+
+// Occupancy of the bordered chunk with one bit per block, built from the state flags before meshing.
+// Rows are indexed by y and then z, and bit x of a row is the block at that x. Coordinates include the border.
+struct VisibilityMasks {
+  u32 empty[18][18];
+  u32 opaque[18][18];
+  u32 transparent[18][18];
+
+  void Build(const u8* state_flags, const BorderedChunk& bordered_chunk) {
+    const u32* blocks = bordered_chunk.blocks;
+
+    for (size_t y = 0; y < 18; ++y) {
+      for (size_t z = 0; z < 18; ++z) {
+        u32 empty_row = 0;
+        u32 opaque_row = 0;
+        u32 transparent_row = 0;
+
+        for (size_t x = 0; x < 18; ++x) {
+          u32 flags = state_flags[*blocks++];
+
+          empty_row |= (u32)((flags & BlockStateFlag_Empty) != 0) << x;
+          opaque_row |= (u32)((flags & BlockStateFlag_Opaque) != 0) << x;
+          transparent_row |= (u32)((flags & BlockStateFlag_Transparent) != 0) << x;
+        }
+
+        empty[y][z] = empty_row;
+        opaque[y][z] = opaque_row;
+        transparent[y][z] = transparent_row;
+      }
+    }
+  }
+
+  // Returns the opaque cubes in a row that are surrounded by opaque cubes, so none of their faces are visible.
+  inline u32 GetHiddenRow(size_t y, size_t z) const {
+    u32 row = opaque[y][z];
+
+    return row & opaque[y - 1][z] & opaque[y + 1][z] & opaque[y][z - 1] & opaque[y][z + 1] & (row >> 1) & (row << 1);
+  }
+
+  inline FaceVisibility GetFaceVisibility(size_t x, size_t y, size_t z) const {
+    FaceVisibility result;
+
+    if (opaque[y][z] & (1 << x)) {
+      result.hidden = GetNeighborBits(opaque, x, y, z);
+      result.visible = GetNeighborBits(transparent, x, y, z);
+    } else {
+      // Only empty neighbors are known without comparing the models.
+      result.hidden = 0;
+      result.visible = GetNeighborBits(empty, x, y, z);
+    }
+
+    return result;
+  }
+};
+
+// Only looks up the neighbor's model when the masks couldn't decide the face.
+static inline bool IsFaceVisible(BlockRegistry& registry, BlockModel* model, u32 neighbor_id,
+                                 const FaceVisibility& visibility, BlockFace face) {
+  u32 bit = 1 << (u32)face;
+
+  if (visibility.hidden & bit) return false;
+  if (visibility.visible & bit) return true;
+
+  return !IsOccluding(model, &registry.states[neighbor_id].model, face);
+}
+
 struct MaterialDescription {
   bool fluid;
   bool water;
@@ -384,6 +488,17 @@ inline u32 CalculateVertexLight(BorderedChunk* bordered_chunk, size_t* indices,
   return (block_sum << 6) | sky_sum;
 }
 
+// The positions, uvs and packed lighting of a face before it's pushed into a mesh.
+struct FaceVertices {
+  FaceQuad quad;
+
+  u16 bl_light;
+  u16 br_light;
+  u16 tl_light;
+  u16 tr_light;
+  u32 axis_data;
+};
+
 struct FaceMesh {
   Vector3f direction;
   bool reduced_ao = false;
@@ -500,13 +615,12 @@ struct FaceMesh {
     return Vector3f(x_offset, vertical ? y_offset : 0.0f, z_offset);
   }
 
-  void Mesh(BlockRegistry& registry, BorderedChunk* bordered_chunk, PushContext& context, BlockModel* model,
-            BlockElement* element, const Vector3f& chunk_base, const Vector3f& relative_base, BlockFace direction) {
+  void Build(BlockRegistry& registry, BorderedChunk* bordered_chunk, BlockModel* model, BlockElement* element,
+             const Vector3f& chunk_base, const Vector3f& relative_base, BlockFace direction, FaceVertices* out) {
     RenderableFace* face = element->faces + (size_t)direction;
+    FaceQuad& quad = out->quad;
 
-    if (!face->render) return;
-
-    FaceQuad quad = GetFaceQuad(*element, direction);
+    quad = GetFaceQuad(*element, direction);
 
     Vector3f coord = chunk_base + relative_base;
 
@@ -583,24 +697,224 @@ struct FaceMesh {
       RandomizeVerticalFaceTexture(world_x, world_y, world_z, quad.bl_uv, quad.br_uv, quad.tr_uv, quad.tl_uv);
     }
 
-    u16 bli = PushVertex(context, quad.bl_pos, quad.bl_uv, face, ele_ao_bl, axis_data);
-    u16 bri = PushVertex(context, quad.br_pos, quad.br_uv, face, ele_ao_br, axis_data);
-    u16 tri = PushVertex(context, quad.tr_pos, quad.tr_uv, face, ele_ao_tr, axis_data);
-    u16 tli = PushVertex(context, quad.tl_pos, quad.tl_uv, face, ele_ao_tl, axis_data);
+    out->bl_light = (u16)ele_ao_bl;
+    out->br_light = (u16)ele_ao_br;
+    out->tl_light = (u16)ele_ao_tl;
+    out->tr_light = (u16)ele_ao_tr;
+    out->axis_data = axis_data;
+  }
 
-    PushIndex(context, face->render_layer, bli);
-    PushIndex(context, face->render_layer, bri);
-    PushIndex(context, face->render_layer, tri);
+  void Push(PushContext& context, RenderableFace* face, const FaceVertices& vertices) {
+    const FaceQuad& quad = vertices.quad;
+    u32 axis_data = vertices.axis_data;
 
-    PushIndex(context, face->render_layer, tri);
-    PushIndex(context, face->render_layer, tli);
-    PushIndex(context, face->render_layer, bli);
+    u16 bli = PushVertex(context, quad.bl_pos, quad.bl_uv, face, vertices.bl_light, axis_data);
+    u16 bri = PushVertex(context, quad.br_pos, quad.br_uv, face, vertices.br_light, axis_data);
+    u16 tri = PushVertex(context, quad.tr_pos, quad.tr_uv, face, vertices.tr_light, axis_data);
+    u16 tli = PushVertex(context, quad.tl_pos, quad.tl_uv, face, vertices.tl_light, axis_data);
+
+    PushQuadIndices(context, face->render_layer, bli, bri, tri, tli);
+  }
+
+  void Mesh(BlockRegistry& registry, BorderedChunk* bordered_chunk, PushContext& context, BlockModel* model,
+            BlockElement* element, const Vector3f& chunk_base, const Vector3f& relative_base, BlockFace direction) {
+    RenderableFace* face = element->faces + (size_t)direction;
+
+    if (!face->render) return;
+
+    FaceVertices vertices;
+
+    Build(registry, bordered_chunk, model, element, chunk_base, relative_base, direction, &vertices);
+    Push(context, face, vertices);
   }
 };
 
+// Models that the greedy pass meshes. Every face of them is handled there, even the ones that can't be merged.
+static inline bool IsGreedyModel(const BlockModel& model) {
+  return model.is_cube && model.element_count == 1 && !model.has_transparency && !model.has_leaves &&
+         !model.has_glass && !model.has_variant_rotation && !model.random_vertical_uv &&
+         !model.random_horizontal_offset && !model.random_vertical_offset;
+}
+
+// Tiled faces get their uv from the position in the shader, so they must show the whole texture without rotation.
+static inline bool IsTileableFace(const RenderableFace& face) {
+  return face.render_layer == (u32)RenderLayer::Standard && face.quad == nullptr && face.uv_from.x == 0.0f &&
+         face.uv_from.y == 0.0f && face.uv_to.x == 1.0f && face.uv_to.y == 1.0f;
+}
+
+struct GreedyAxes {
+  size_t normal;
+  // The axes of the slice that faces are merged along.
+  size_t u;
+  size_t v;
+  s32 step;
+};
+
+// Indexed by BlockFace.
+static const GreedyAxes kGreedyAxes[6] = {
+    {1, 0, 2, -1}, {1, 0, 2, 1}, {2, 0, 1, -1}, {2, 0, 1, 1}, {0, 2, 1, -1}, {0, 2, 1, 1},
+};
+
+struct GreedyCell {
+  // Zero when there's no face to merge. Faces merge when their keys match.
+  u64 key;
+  BlockElement* element;
+  u16 light;
+  u32 axis_data;
+};
+
+static inline u64 GetGreedyKey(const RenderableFace& face, u16 light, u32 axis_data) {
+  return (1ULL << 63) | (u64)face.texture_id | ((u64)face.tintindex << 32) | ((u64)face.random_flip << 38) |
+         ((u64)(face.frame_count > 1) << 39) | ((u64)light << 40) | ((u64)axis_data << 56);
+}
+
+static void PushGreedyQuad(PushContext& context, const GreedyCell& cell, BlockFace direction, const GreedyAxes& axes,
+                           const Vector3f& block_base, size_t width, size_t height) {
+  RenderableFace* face = cell.element->faces + (size_t)direction;
+  FaceQuad quad = GetFaceQuad(*cell.element, direction);
+  Vector3f* corners[4] = {&quad.bl_pos, &quad.br_pos, &quad.tr_pos, &quad.tl_pos};
+  u16 indices[4];
+
+  u32 packed_uv = (u32)direction | (face->random_flip << 3);
+
+  // Stretch the corners on the far side of the first block's face to the end of the merged area.
+  for (size_t i = 0; i < 4; ++i) {
+    Vector3f position = block_base + *corners[i];
+
+    if ((*corners[i])[axes.u] > 0.5f) position[axes.u] += (float)(width - 1);
+    if ((*corners[i])[axes.v] > 0.5f) position[axes.v] += (float)(height - 1);
+
+    indices[i] = PushPackedVertex(context, position, packed_uv, true, face, cell.light, cell.axis_data);
+  }
+
+  PushQuadIndices(context, face->render_layer, indices[0], indices[1], indices[2], indices[3]);
+}
+
+// Meshes every face of the greedy models one slice at a time. Evenly lit faces are merged with matching neighbors
+// into larger tiled quads and the rest are pushed the same way MeshBlock would.
+static void MeshGreedy(BlockRegistry& block_registry, const u8* state_flags, const VisibilityMasks& masks,
+                       BorderedChunk* bordered_chunk, PushContext& context, const Vector3f& chunk_base) {
+  constexpr ptrdiff_t kStrides[3] = {1, 18 * 18, 18};
+
+  GreedyCell cells[16 * 16];
+
+  for (size_t d = 0; d < 6; ++d) {
+    BlockFace direction = (BlockFace)d;
+    const GreedyAxes& axes = kGreedyAxes[d];
+
+    Vector3f normal;
+    normal[axes.normal] = (float)axes.step;
+
+    ptrdiff_t neighbor_offset = axes.step * kStrides[axes.normal];
+
+    for (size_t slice = 0; slice < 16; ++slice) {
+      size_t cell_count = 0;
+      size_t relative[3];
+
+      relative[axes.normal] = slice;
+
+      for (size_t v = 0; v < 16; ++v) {
+        for (size_t u = 0; u < 16; ++u) {
+          GreedyCell* cell = cells + v * 16 + u;
+
+          cell->key = 0;
+
+          relative[axes.u] = u;
+          relative[axes.v] = v;
+
+          size_t index = (relative[1] + 1) * 18 * 18 + (relative[2] + 1) * 18 + (relative[0] + 1);
+          u32 bid = bordered_chunk->blocks[index];
+
+          if (!(state_flags[bid] & BlockStateFlag_Greedy)) continue;
+
+          FaceVisibility visibility = masks.GetFaceVisibility(relative[0] + 1, relative[1] + 1, relative[2] + 1);
+
+          if (visibility.hidden & (1 << d)) continue;
+
+          BlockModel* model = &block_registry.states[bid].model;
+          BlockElement* element = model->elements;
+          RenderableFace* face = element->faces + d;
+
+          if (!face->render) continue;
+
+          u32 neighbor_id = bordered_chunk->blocks[index + neighbor_offset];
+
+          if (!IsFaceVisible(block_registry, model, neighbor_id, visibility, direction)) continue;
+
+          Vector3f relative_pos((float)relative[0], (float)relative[1], (float)relative[2]);
+          FaceMesh face_mesh = {normal};
+          FaceVertices vertices;
+
+          face_mesh.Build(block_registry, bordered_chunk, model, element, chunk_base, relative_pos, direction,
+                          &vertices);
+
+          bool even_light = vertices.bl_light == vertices.br_light && vertices.bl_light == vertices.tl_light &&
+                            vertices.bl_light == vertices.tr_light;
+
+          if (!even_light || !IsTileableFace(*face)) {
+            face_mesh.Push(context, face, vertices);
+            continue;
+          }
+
+          cell->key = GetGreedyKey(*face, vertices.bl_light, vertices.axis_data);
+          cell->element = element;
+          cell->light = vertices.bl_light;
+          cell->axis_data = vertices.axis_data;
+          ++cell_count;
+        }
+      }
+
+      if (cell_count == 0) continue;
+
+      for (size_t v = 0; v < 16; ++v) {
+        for (size_t u = 0; u < 16; ++u) {
+          GreedyCell* cell = cells + v * 16 + u;
+          u64 key = cell->key;
+
+          if (key == 0) continue;
+
+          size_t width = 1;
+
+          while (u + width < 16 && cell[width].key == key) {
+            ++width;
+          }
+
+          size_t height = 1;
+
+          while (v + height < 16) {
+            GreedyCell* row = cell + height * 16;
+            size_t i = 0;
+
+            while (i < width && row[i].key == key) {
+              ++i;
+            }
+
+            if (i < width) break;
+
+            ++height;
+          }
+
+          for (size_t j = 0; j < height; ++j) {
+            for (size_t i = 0; i < width; ++i) {
+              cell[j * 16 + i].key = 0;
+            }
+          }
+
+          relative[axes.u] = u;
+          relative[axes.v] = v;
+
+          Vector3f block_base = chunk_base + Vector3f((float)relative[0], (float)relative[1], (float)relative[2]);
+
+          PushGreedyQuad(context, *cell, direction, axes, block_base, width, height);
+        }
+      }
+    }
+  }
+}
+
 static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry& block_registry,
                       BorderedChunk* bordered_chunk, u32 bid, size_t relative_x, size_t relative_y, size_t relative_z,
-                      const Vector3f& chunk_base) {
+                      const Vector3f& chunk_base, const FaceVisibility& visibility) {
   BlockModel* model = &block_registry.states[bid].model;
 
   if (model->element_count == 0) {
@@ -621,18 +935,10 @@ static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry&
   u32 east_id = bordered_chunk->blocks[east_index];
   u32 west_id = bordered_chunk->blocks[west_index];
 
-  BlockModel* above_model = &block_registry.states[above_id].model;
-  BlockModel* below_model = &block_registry.states[below_id].model;
-
-  BlockModel* north_model = &block_registry.states[north_id].model;
-  BlockModel* south_model = &block_registry.states[south_id].model;
-  BlockModel* east_model = &block_registry.states[east_id].model;
-  BlockModel* west_model = &block_registry.states[west_id].model;
-
   Vector3f relative_pos((float)relative_x, (float)relative_y, (float)relative_z);
   Vector3f world_pos = chunk_base + relative_pos;
 
-  if (!IsOccluding(model, above_model, BlockFace::Up)) {
+  if (IsFaceVisible(block_registry, model, above_id, visibility, BlockFace::Up)) {
     for (size_t i = 0; i < model->element_count; ++i) {
       BlockElement* element = model->elements + i;
 
@@ -648,7 +954,7 @@ static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry&
     }
   }
 
-  if (!IsOccluding(model, below_model, BlockFace::Down)) {
+  if (IsFaceVisible(block_registry, model, below_id, visibility, BlockFace::Down)) {
     for (size_t i = 0; i < model->element_count; ++i) {
       BlockElement* element = model->elements + i;
       FaceMesh face_mesh = {
@@ -660,7 +966,7 @@ static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry&
     }
   }
 
-  if (!IsOccluding(model, north_model, BlockFace::North)) {
+  if (IsFaceVisible(block_registry, model, north_id, visibility, BlockFace::North)) {
     for (size_t i = 0; i < model->element_count; ++i) {
       BlockElement* element = model->elements + i;
       FaceMesh face_mesh = {
@@ -672,7 +978,7 @@ static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry&
     }
   }
 
-  if (!IsOccluding(model, south_model, BlockFace::South)) {
+  if (IsFaceVisible(block_registry, model, south_id, visibility, BlockFace::South)) {
     for (size_t i = 0; i < model->element_count; ++i) {
       BlockElement* element = model->elements + i;
       FaceMesh face_mesh = {
@@ -684,7 +990,7 @@ static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry&
     }
   }
 
-  if (!IsOccluding(model, west_model, BlockFace::West)) {
+  if (IsFaceVisible(block_registry, model, west_id, visibility, BlockFace::West)) {
     for (size_t i = 0; i < model->element_count; ++i) {
       BlockElement* element = model->elements + i;
       FaceMesh face_mesh = {
@@ -696,7 +1002,7 @@ static void MeshBlock(BlockMesher& mesher, PushContext& context, BlockRegistry&
     }
   }
 
-  if (!IsOccluding(model, east_model, BlockFace::East)) {
+  if (IsFaceVisible(block_registry, model, east_id, visibility, BlockFace::East)) {
     for (size_t i = 0; i < model->element_count; ++i) {
       BlockElement* element = model->elements + i;
       FaceMesh face_mesh = {
@@ -1092,14 +1398,77 @@ struct FluidTextures {
   asset::BlockTextureDescriptor lava_flow_texture;
 };
 
-ChunkVertexData BlockMesher::CreateMesh(ChunkBuildContext* ctx, s32 chunk_y) {
-  ChunkVertexData vertex_data;
+// A full cube that hides the face of any neighboring opaque cube, matching what IsOccluding checks for.
+static bool IsOpaqueCube(const BlockModel& model) {
+  if (model.element_count != 1 || model.has_variant_rotation || model.has_leaves || !model.has_shaded) return false;
 
-  s32 chunk_x = ctx->chunk_x;
-  s32 chunk_z = ctx->chunk_z;
+  const BlockElement& element = model.elements[0];
 
+  if (element.rescale) return false;
+  if (element.from.x != 0.0f || element.from.y != 0.0f || element.from.z != 0.0f) return false;
+  if (element.to.x != 1.0f || element.to.y != 1.0f || element.to.z != 1.0f) return false;
+
+  for (size_t i = 0; i < 6; ++i) {
+    const RenderableFace& face = element.faces[i];
+
+    if (!face.render || face.transparency || !face.full_occlusion) return false;
+  }
+
+  return true;
+}
+
+// IsOccluding only ever compares an opaque cube's face against the first element of the neighbor.
+static bool CanHideOpaqueFace(const BlockModel& model) {
+  if (model.element_count == 0 || model.has_variant_rotation || model.has_leaves || !model.has_shaded) return false;
+
+  for (size_t i = 0; i < 6; ++i) {
+    const RenderableFace& face = model.elements[0].faces[i];
+
+    if (face.render && !face.transparency && face.full_occlusion) return true;
+  }
+
+  return false;
+}
+
+u8* CreateBlockStateFlags(MemoryArena& perm_arena, BlockRegistry& registry) {
+  u8* flags = memory_arena_push_type_count(&perm_arena, u8, registry.state_count);
+
+  for (size_t bid = 0; bid < registry.state_count; ++bid) {
+    BlockModel& model = registry.states[bid].model;
+    u8 state_flags = 0;
+
+    if (model.element_count == 0) state_flags |= BlockStateFlag_Empty;
+    if (IsOpaqueCube(model)) state_flags |= BlockStateFlag_Opaque;
+    if (!CanHideOpaqueFace(model)) state_flags |= BlockStateFlag_Transparent;
+    if (IsGreedyModel(model)) state_flags |= BlockStateFlag_Greedy;
+
+    flags[bid] = state_flags;
+  }
+
+  return flags;
+}
+
+ChunkVertexData BlockMesher::CreateMesh(ChunkBuildContext* ctx, s32 chunk_y) {
   BorderedChunk* bordered_chunk = CreateBorderedChunk(trans_arena, ctx, chunk_y);
-  if (!bordered_chunk) return vertex_data;
+  if (!bordered_chunk) return ChunkVertexData();
+
+  return CreateMesh(bordered_chunk, ctx->chunk_x, chunk_y, ctx->chunk_z);
+}
+
+bool BlockMesher::HasMeshCapacity() const {
+  for (size_t i = 0; i < kRenderLayerCount; ++i) {
+    const MemoryArena& vertex_arena = vertex_arenas[i];
+    const MemoryArena& index_arena = index_arenas[i];
+
+    if ((size_t)(vertex_arena.base + vertex_arena.max_size - vertex_arena.current) < kMaxMeshVertexSize) return false;
+    if ((size_t)(index_arena.base + index_arena.max_size - index_arena.current) < kMaxMeshIndexSize) return false;
+  }
+
+  return true;
+}
+
+ChunkVertexData BlockMesher::CreateMesh(BorderedChunk* bordered_chunk, s32 chunk_x, s32 chunk_y, s32 chunk_z) {
+  ChunkVertexData vertex_data;
 
   FluidTextures fluid_textures = {};
 
@@ -1114,14 +1483,26 @@ ChunkVertexData BlockMesher::CreateMesh(ChunkBuildContext* ctx, s32 chunk_y) {
   Vector3f chunk_base(chunk_x * 16.0f, chunk_y * 16.0f - 64.0f, chunk_z * 16.0f);
 
   PushContext context = {};
+  u8* index_starts[kRenderLayerCount];
+
+  context.origin = chunk_base;
+  context.texture_animation_indices = assets.block_assets->texture_animation_indices;
 
   for (size_t i = 0; i < kRenderLayerCount; ++i) {
     RenderLayer layer = (RenderLayer)i;
     context.SetLayerData(layer, &vertex_arenas[i], &index_arenas[i]);
+    index_starts[i] = index_arenas[i].current;
   }
 
+  VisibilityMasks masks;
+
+  masks.Build(state_flags, *bordered_chunk);
+
   for (size_t relative_y = 0; relative_y < 16; ++relative_y) {
     for (size_t relative_z = 0; relative_z < 16; ++relative_z) {
+      // Blocks with nothing to mesh. Fluids have no elements, so they're still checked before skipping.
+      u32 skip_row = masks.empty[relative_y + 1][relative_z + 1] | masks.GetHiddenRow(relative_y + 1, relative_z + 1);
+
       for (size_t relative_x = 0; relative_x < 16; ++relative_x) {
         size_t index = (relative_y + 1) * 18 * 18 + (relative_z + 1) * 18 + (relative_x + 1);
 
@@ -1144,30 +1525,60 @@ ChunkVertexData BlockMesher::CreateMesh(ChunkBuildContext* ctx, s32 chunk_y) {
                     texture_range, tintindex, layer);
         }
 
+        if (skip_row & (1 << (relative_x + 1))) continue;
+
+        // The greedy pass meshes these after every other block.
+        if (greedy_meshing && (state_flags[bid] & BlockStateFlag_Greedy)) continue;
+
+        FaceVisibility visibility = masks.GetFaceVisibility(relative_x + 1, relative_y + 1, relative_z + 1);
+
         // Always mesh block even if it's a fluid because the plants have both
-        MeshBlock(*this, context, block_registry, bordered_chunk, bid, relative_x, relative_y, relative_z, chunk_base);
+        MeshBlock(*this, context, block_registry, bordered_chunk, bid, relative_x, relative_y, relative_z, chunk_base,
+                  visibility);
       }
     }
   }
 
+  if (greedy_meshing) {
+    MeshGreedy(block_registry, state_flags, masks, bordered_chunk, context, chunk_base);
+  }
+
   for (size_t i = 0; i < kRenderLayerCount; ++i) {
     MemoryArena& vertex_arena = vertex_arenas[i];
     MemoryArena& index_arena = index_arenas[i];
     RenderLayer layer = (RenderLayer)i;
 
-    u32 vertex_count = (u32)(((ptrdiff_t)vertex_arena.current - (ptrdiff_t)vertex_arena.base) / sizeof(ChunkVertex));
-    u32 index_count = (u32)(((ptrdiff_t)index_arena.current - (ptrdiff_t)index_arena.base) / sizeof(u16));
+    u8* vertex_start = (u8*)context.vertex_bases[i];
+    u8* index_start = index_starts[i];
 
-    vertex_data.SetVertices(layer, vertex_arenas[i].base, vertex_count);
-    vertex_data.SetIndices(layer, (u16*)index_arenas[i].base, index_count);
+    u32 vertex_count = (u32)(((ptrdiff_t)vertex_arena.current - (ptrdiff_t)vertex_start) / sizeof(ChunkVertex));
+    u32 index_count = (u32)(((ptrdiff_t)index_arena.current - (ptrdiff_t)index_start) / sizeof(u16));
+
+    vertex_data.SetVertices(layer, vertex_start, vertex_count);
+    vertex_data.SetIndices(layer, (u16*)index_start, index_count);
   }
 
   return vertex_data;
 }
 
+static inline void CopyBorderBlock(BorderedChunk* bordered_chunk, size_t index, const Chunk& chunk, size_t x, size_t y,
+                                   size_t z) {
+  size_t chunk_index = world::GetChunkBlockIndex(x, y, z);
+
+  bordered_chunk->blocks[index] = chunk.GetBlock(chunk_index);
+  bordered_chunk->lightmap[index] = chunk.GetLight(chunk_index);
+}
+
 BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s32 chunk_y) {
   BorderedChunk* bordered_chunk = memory_arena_push_type(&arena, BorderedChunk);
+  if (!bordered_chunk) return nullptr;
 
+  SnapshotBorderedChunk(bordered_chunk, ctx, chunk_y);
+
+  return bordered_chunk;
+}
+
+void SnapshotBorderedChunk(BorderedChunk* bordered_chunk, ChunkBuildContext* ctx, s32 chunk_y) {
   memset(bordered_chunk->blocks, 0, sizeof(bordered_chunk->blocks));
   // Default lightmap to fully bright skylight so we can ignore completely empty chunks surrounding it.
   memset(bordered_chunk->lightmap, 0x0F, sizeof(bordered_chunk->lightmap));
@@ -1182,15 +1593,15 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
   ChunkSection* south_east_section = ctx->south_east_section;
   ChunkSection* south_west_section = ctx->south_west_section;
 
-  for (s64 y = 0; y < 16; ++y) {
-    for (s64 z = 0; z < 16; ++z) {
-      for (s64 x = 0; x < 16; ++x) {
-        size_t index = (size_t)((y + 1) * 18 * 18 + (z + 1) * 18 + (x + 1));
+  if (section->chunks[chunk_y]) {
+    Chunk* chunk = section->chunks[chunk_y];
 
-        if (!section->chunks[chunk_y]) continue;
+    for (size_t y = 0; y < 16; ++y) {
+      for (size_t z = 0; z < 16; ++z) {
+        size_t index = (y + 1) * 18 * 18 + (z + 1) * 18 + 1;
 
-        bordered_chunk->blocks[index] = section->chunks[chunk_y]->blocks[y][z][x];
-        bordered_chunk->lightmap[index] = section->chunks[chunk_y]->lightmap[y][z][x];
+        chunk->GetBlockRow(y, z, bordered_chunk->blocks + index);
+        chunk->GetLightRow(y, z, bordered_chunk->lightmap + index);
       }
     }
   }
@@ -1202,8 +1613,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!west_section->chunks[chunk_y]) continue;
 
-      bordered_chunk->blocks[index] = west_section->chunks[chunk_y]->blocks[y][z][15];
-      bordered_chunk->lightmap[index] = west_section->chunks[chunk_y]->lightmap[y][z][15];
+      CopyBorderBlock(bordered_chunk, index, *west_section->chunks[chunk_y], 15, y, z);
     }
   }
 
@@ -1214,8 +1624,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!east_section->chunks[chunk_y]) continue;
 
-      bordered_chunk->blocks[index] = east_section->chunks[chunk_y]->blocks[y][z][0];
-      bordered_chunk->lightmap[index] = east_section->chunks[chunk_y]->lightmap[y][z][0];
+      CopyBorderBlock(bordered_chunk, index, *east_section->chunks[chunk_y], 0, y, z);
     }
   }
 
@@ -1226,8 +1635,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!north_section->chunks[chunk_y]) continue;
 
-      bordered_chunk->blocks[index] = north_section->chunks[chunk_y]->blocks[y][15][x];
-      bordered_chunk->lightmap[index] = north_section->chunks[chunk_y]->lightmap[y][15][x];
+      CopyBorderBlock(bordered_chunk, index, *north_section->chunks[chunk_y], x, y, 15);
     }
   }
 
@@ -1238,8 +1646,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!south_section->chunks[chunk_y]) continue;
 
-      bordered_chunk->blocks[index] = south_section->chunks[chunk_y]->blocks[y][0][x];
-      bordered_chunk->lightmap[index] = south_section->chunks[chunk_y]->lightmap[y][0][x];
+      CopyBorderBlock(bordered_chunk, index, *south_section->chunks[chunk_y], x, y, 0);
     }
   }
 
@@ -1249,8 +1656,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
     if (!south_east_section->chunks[chunk_y]) continue;
 
-    bordered_chunk->blocks[index] = south_east_section->chunks[chunk_y]->blocks[y][0][0];
-    bordered_chunk->lightmap[index] = south_east_section->chunks[chunk_y]->lightmap[y][0][0];
+    CopyBorderBlock(bordered_chunk, index, *south_east_section->chunks[chunk_y], 0, y, 0);
   }
 
   // North-east corner
@@ -1259,8 +1665,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
     if (!north_east_section->chunks[chunk_y]) continue;
 
-    bordered_chunk->blocks[index] = north_east_section->chunks[chunk_y]->blocks[y][15][0];
-    bordered_chunk->lightmap[index] = north_east_section->chunks[chunk_y]->lightmap[y][15][0];
+    CopyBorderBlock(bordered_chunk, index, *north_east_section->chunks[chunk_y], 0, y, 15);
   }
 
   // South-west corner
@@ -1269,8 +1674,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
     if (!south_west_section->chunks[chunk_y]) continue;
 
-    bordered_chunk->blocks[index] = south_west_section->chunks[chunk_y]->blocks[y][0][15];
-    bordered_chunk->lightmap[index] = south_west_section->chunks[chunk_y]->lightmap[y][0][15];
+    CopyBorderBlock(bordered_chunk, index, *south_west_section->chunks[chunk_y], 15, y, 0);
   }
 
   // North-west corner
@@ -1279,11 +1683,10 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
     if (!north_west_section->chunks[chunk_y]) continue;
 
-    bordered_chunk->blocks[index] = north_west_section->chunks[chunk_y]->blocks[y][15][15];
-    bordered_chunk->lightmap[index] = north_west_section->chunks[chunk_y]->lightmap[y][15][15];
+    CopyBorderBlock(bordered_chunk, index, *north_west_section->chunks[chunk_y], 15, y, 15);
   }
 
-  if (chunk_y < kChunkColumnCount) {
+  if (chunk_y + 1 < kChunkColumnCount) {
     // Load above blocks
     for (s64 z = 0; z < 16; ++z) {
       for (s64 x = 0; x < 16; ++x) {
@@ -1291,8 +1694,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
         if (!section->chunks[chunk_y + 1]) continue;
 
-        bordered_chunk->blocks[index] = section->chunks[chunk_y + 1]->blocks[0][z][x];
-        bordered_chunk->lightmap[index] = section->chunks[chunk_y + 1]->lightmap[0][z][x];
+        CopyBorderBlock(bordered_chunk, index, *section->chunks[chunk_y + 1], x, 0, z);
       }
     }
 
@@ -1302,8 +1704,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!south_section->chunks[chunk_y + 1]) continue;
 
-      bordered_chunk->blocks[index] = south_section->chunks[chunk_y + 1]->blocks[0][0][x];
-      bordered_chunk->lightmap[index] = south_section->chunks[chunk_y + 1]->lightmap[0][0][x];
+      CopyBorderBlock(bordered_chunk, index, *south_section->chunks[chunk_y + 1], x, 0, 0);
     }
 
     // Load above-north
@@ -1312,8 +1713,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!north_section->chunks[chunk_y + 1]) continue;
 
-      bordered_chunk->blocks[index] = north_section->chunks[chunk_y + 1]->blocks[0][15][x];
-      bordered_chunk->lightmap[index] = north_section->chunks[chunk_y + 1]->lightmap[0][15][x];
+      CopyBorderBlock(bordered_chunk, index, *north_section->chunks[chunk_y + 1], x, 0, 15);
     }
 
     // Load above-east
@@ -1322,8 +1722,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!east_section->chunks[chunk_y + 1]) continue;
 
-      bordered_chunk->blocks[index] = east_section->chunks[chunk_y + 1]->blocks[0][z][0];
-      bordered_chunk->lightmap[index] = east_section->chunks[chunk_y + 1]->lightmap[0][z][0];
+      CopyBorderBlock(bordered_chunk, index, *east_section->chunks[chunk_y + 1], 0, 0, z);
     }
 
     // Load above-west
@@ -1332,8 +1731,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!west_section->chunks[chunk_y + 1]) continue;
 
-      bordered_chunk->blocks[index] = west_section->chunks[chunk_y + 1]->blocks[0][z][15];
-      bordered_chunk->lightmap[index] = west_section->chunks[chunk_y + 1]->lightmap[0][z][15];
+      CopyBorderBlock(bordered_chunk, index, *west_section->chunks[chunk_y + 1], 15, 0, z);
     }
 
     {
@@ -1341,8 +1739,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(17 * 18 * 18 + 17 * 18 + 17);
 
       if (south_east_section->chunks[chunk_y + 1]) {
-        bordered_chunk->blocks[index] = south_east_section->chunks[chunk_y + 1]->blocks[0][0][0];
-        bordered_chunk->lightmap[index] = south_east_section->chunks[chunk_y + 1]->lightmap[0][0][0];
+        CopyBorderBlock(bordered_chunk, index, *south_east_section->chunks[chunk_y + 1], 0, 0, 0);
       }
     }
 
@@ -1351,8 +1748,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(17 * 18 * 18 + 17 * 18 + 0);
 
       if (south_west_section->chunks[chunk_y + 1]) {
-        bordered_chunk->blocks[index] = south_west_section->chunks[chunk_y + 1]->blocks[0][0][15];
-        bordered_chunk->lightmap[index] = south_west_section->chunks[chunk_y + 1]->lightmap[0][0][15];
+        CopyBorderBlock(bordered_chunk, index, *south_west_section->chunks[chunk_y + 1], 15, 0, 0);
       }
     }
 
@@ -1361,8 +1757,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(17 * 18 * 18 + 0 * 18 + 17);
 
       if (north_east_section->chunks[chunk_y + 1]) {
-        bordered_chunk->blocks[index] = north_east_section->chunks[chunk_y + 1]->blocks[0][15][0];
-        bordered_chunk->lightmap[index] = north_east_section->chunks[chunk_y + 1]->lightmap[0][15][0];
+        CopyBorderBlock(bordered_chunk, index, *north_east_section->chunks[chunk_y + 1], 0, 0, 15);
       }
     }
 
@@ -1371,8 +1766,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(17 * 18 * 18 + 0 * 18 + 0);
 
       if (north_west_section->chunks[chunk_y + 1]) {
-        bordered_chunk->blocks[index] = north_west_section->chunks[chunk_y + 1]->blocks[0][15][15];
-        bordered_chunk->lightmap[index] = north_west_section->chunks[chunk_y + 1]->lightmap[0][15][15];
+        CopyBorderBlock(bordered_chunk, index, *north_west_section->chunks[chunk_y + 1], 15, 0, 15);
       }
     }
   }
@@ -1385,8 +1779,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
         if (!section->chunks[chunk_y - 1]) continue;
 
-        bordered_chunk->blocks[index] = section->chunks[chunk_y - 1]->blocks[15][z][x];
-        bordered_chunk->lightmap[index] = section->chunks[chunk_y - 1]->lightmap[15][z][x];
+        CopyBorderBlock(bordered_chunk, index, *section->chunks[chunk_y - 1], x, 15, z);
       }
     }
 
@@ -1396,8 +1789,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!south_section->chunks[chunk_y - 1]) continue;
 
-      bordered_chunk->blocks[index] = south_section->chunks[chunk_y - 1]->blocks[15][0][x];
-      bordered_chunk->lightmap[index] = south_section->chunks[chunk_y - 1]->lightmap[15][0][x];
+      CopyBorderBlock(bordered_chunk, index, *south_section->chunks[chunk_y - 1], x, 15, 0);
     }
 
     // Load below-north
@@ -1406,8 +1798,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!north_section->chunks[chunk_y - 1]) continue;
 
-      bordered_chunk->blocks[index] = north_section->chunks[chunk_y - 1]->blocks[15][15][x];
-      bordered_chunk->lightmap[index] = north_section->chunks[chunk_y - 1]->lightmap[15][15][x];
+      CopyBorderBlock(bordered_chunk, index, *north_section->chunks[chunk_y - 1], x, 15, 15);
     }
 
     // Load below-east
@@ -1416,8 +1807,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!east_section->chunks[chunk_y - 1]) continue;
 
-      bordered_chunk->blocks[index] = east_section->chunks[chunk_y - 1]->blocks[15][z][0];
-      bordered_chunk->lightmap[index] = east_section->chunks[chunk_y - 1]->lightmap[15][z][0];
+      CopyBorderBlock(bordered_chunk, index, *east_section->chunks[chunk_y - 1], 0, 15, z);
     }
 
     // Load below-west
@@ -1426,8 +1816,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
 
       if (!west_section->chunks[chunk_y - 1]) continue;
 
-      bordered_chunk->blocks[index] = west_section->chunks[chunk_y - 1]->blocks[15][z][15];
-      bordered_chunk->lightmap[index] = west_section->chunks[chunk_y - 1]->lightmap[15][z][15];
+      CopyBorderBlock(bordered_chunk, index, *west_section->chunks[chunk_y - 1], 15, 15, z);
     }
 
     {
@@ -1435,8 +1824,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(0 * 18 * 18 + 17 * 18 + 17);
 
       if (south_east_section->chunks[chunk_y - 1]) {
-        bordered_chunk->blocks[index] = south_east_section->chunks[chunk_y - 1]->blocks[15][0][0];
-        bordered_chunk->lightmap[index] = south_east_section->chunks[chunk_y - 1]->lightmap[15][0][0];
+        CopyBorderBlock(bordered_chunk, index, *south_east_section->chunks[chunk_y - 1], 0, 15, 0);
       }
     }
 
@@ -1445,8 +1833,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(0 * 18 * 18 + 17 * 18 + 0);
 
       if (south_west_section->chunks[chunk_y - 1]) {
-        bordered_chunk->blocks[index] = south_west_section->chunks[chunk_y - 1]->blocks[15][0][15];
-        bordered_chunk->lightmap[index] = south_west_section->chunks[chunk_y - 1]->lightmap[15][0][15];
+        CopyBorderBlock(bordered_chunk, index, *south_west_section->chunks[chunk_y - 1], 15, 15, 0);
       }
     }
 
@@ -1455,8 +1842,7 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(0 * 18 * 18 + 0 * 18 + 17);
 
       if (north_east_section->chunks[chunk_y - 1]) {
-        bordered_chunk->blocks[index] = north_east_section->chunks[chunk_y - 1]->blocks[15][15][0];
-        bordered_chunk->lightmap[index] = north_east_section->chunks[chunk_y - 1]->lightmap[15][15][0];
+        CopyBorderBlock(bordered_chunk, index, *north_east_section->chunks[chunk_y - 1], 0, 15, 15);
       }
     }
 
@@ -1465,13 +1851,10 @@ BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s
       size_t index = (size_t)(0 * 18 * 18 + 0 * 18 + 0);
 
       if (north_west_section->chunks[chunk_y - 1]) {
-        bordered_chunk->blocks[index] = north_west_section->chunks[chunk_y - 1]->blocks[15][15][15];
-        bordered_chunk->lightmap[index] = north_west_section->chunks[chunk_y - 1]->lightmap[15][15][15];
+        CopyBorderBlock(bordered_chunk, index, *north_west_section->chunks[chunk_y - 1], 15, 15, 15);
       }
     }
   }
-
-  return bordered_chunk;
 }
 
 } // namespace render
@@ -41,6 +41,45 @@ struct ChunkBuildContext {
   bool GetNeighbors(world::World* world);
 };
 
+// A copy of a section's blocks and light along with a one block border from its neighbors.
+struct BorderedChunk {
+  constexpr static size_t kElementCount = 18 * 18 * 18;
+
+  u32 blocks[kElementCount];
+
+  // The bottom 4 bits contain the skylight data and the upper 4 bits contain the block
+  u8 lightmap[kElementCount];
+
+  // Position is chunk relative
+  inline u8 GetBlockLight(size_t index) const {
+    return lightmap[index] >> 4;
+  }
+
+  // Position is chunk relative
+  inline u8 GetSkyLight(size_t index) const {
+    return lightmap[index] & 0x0F;
+  }
+};
+
+// Flags for each block state so the mesher can find hidden faces without reading the large block models.
+enum BlockStateFlags {
+  // No elements, so there's nothing to mesh and it never hides a neighbor's face.
+  BlockStateFlag_Empty = (1 << 0),
+  // A full cube with opaque faces. Faces between two of these are never visible.
+  BlockStateFlag_Opaque = (1 << 1),
+  // Never hides a face of an opaque cube.
+  BlockStateFlag_Transparent = (1 << 2),
+  // Meshed by the greedy pass when it's enabled.
+  BlockStateFlag_Greedy = (1 << 3),
+};
+
+// Returns one byte of BlockStateFlags for every block state.
+u8* CreateBlockStateFlags(MemoryArena& perm_arena, world::BlockRegistry& registry);
+
+BorderedChunk* CreateBorderedChunk(MemoryArena& arena, ChunkBuildContext* ctx, s32 chunk_y);
+// Copies the section and its border out of the world so it can be meshed without touching the world again.
+void SnapshotBorderedChunk(BorderedChunk* bordered_chunk, ChunkBuildContext* ctx, s32 chunk_y);
+
 struct ChunkVertexData {
   u8* vertices[render::kRenderLayerCount];
   size_t vertex_count[render::kRenderLayerCount];
@@ -103,6 +142,10 @@ private:
 };
 
 struct BlockMesher {
+  // Indices are 16 bits, so one layer of a mesh can never be larger than this.
+  constexpr static size_t kMaxMeshVertexSize = 65536 * sizeof(render::ChunkVertex);
+  constexpr static size_t kMaxMeshIndexSize = 65536 * 2 * sizeof(u16);
+
   MemoryArena& trans_arena;
   asset::AssetSystem& assets;
   world::BlockRegistry& block_registry;
@@ -111,6 +154,11 @@ struct BlockMesher {
   MemoryArena index_arenas[render::kRenderLayerCount];
 
   BlockMesherMapping mapping;
+  // Created by CreateBlockStateFlags. It's never written after that, so every mesher can share it.
+  const u8* state_flags = nullptr;
+
+  // Merges evenly lit faces of full cubes into larger quads that tile their texture.
+  bool greedy_meshing = false;
 
   BlockMesher(MemoryArena& trans_arena, asset::AssetSystem& assets, world::BlockRegistry& block_registry)
       : trans_arena(trans_arena), assets(assets), block_registry(block_registry) {
@@ -134,7 +182,13 @@ struct BlockMesher {
     }
   }
 
+  // The returned vertex data lives in the mesher's arenas until the next Reset.
   ChunkVertexData CreateMesh(ChunkBuildContext* ctx, s32 chunk_y);
+  // Meshes are appended after any that haven't been reset yet, so several can be held at once.
+  ChunkVertexData CreateMesh(BorderedChunk* bordered_chunk, s32 chunk_x, s32 chunk_y, s32 chunk_z);
+
+  // Returns true if there's room for another mesh of any size without resetting.
+  bool HasMeshCapacity() const;
 };
 
 } // namespace render
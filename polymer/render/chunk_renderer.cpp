@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <stdio.h>
+#include <string.h>
 
 #pragma warning(disable : 26812) // disable unscoped enum warning
 
@@ -42,12 +43,17 @@ bool ChunkRenderLayout::Create(VkDevice device) {
     return false;
   }
 
+  VkPushConstantRange push_constant_range = {};
+  push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  push_constant_range.offset = 0;
+  push_constant_range.size = sizeof(ChunkPushConstants);
+
   VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
   pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipeline_layout_create_info.setLayoutCount = 1;
   pipeline_layout_create_info.pSetLayouts = &descriptor_layout;
-  pipeline_layout_create_info.pushConstantRangeCount = 0;
-  pipeline_layout_create_info.pPushConstantRanges = nullptr;
+  pipeline_layout_create_info.pushConstantRangeCount = 1;
+  pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
 
   if (vkCreatePipelineLayout(device, &pipeline_layout_create_info, nullptr, &pipeline_layout) != VK_SUCCESS) {
     fprintf(stderr, "Failed to create pipeline layout.\n");
@@ -151,31 +157,17 @@ void ChunkRenderer::CreatePipeline(MemoryArena& trans_arena, VkDevice device, Vk
   binding_description.stride = sizeof(ChunkVertex);
   binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-  VkVertexInputAttributeDescription attribute_descriptions[5];
+  // The position and light are read together because three component 16-bit formats aren't required to be supported.
+  VkVertexInputAttributeDescription attribute_descriptions[2];
   attribute_descriptions[0].binding = 0;
   attribute_descriptions[0].location = 0;
-  attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-  attribute_descriptions[0].offset = offsetof(ChunkVertex, position);
+  attribute_descriptions[0].format = VK_FORMAT_R16G16B16A16_UINT;
+  attribute_descriptions[0].offset = offsetof(ChunkVertex, x);
 
   attribute_descriptions[1].binding = 0;
   attribute_descriptions[1].location = 1;
   attribute_descriptions[1].format = VK_FORMAT_R32_UINT;
-  attribute_descriptions[1].offset = offsetof(ChunkVertex, texture_id);
-
-  attribute_descriptions[2].binding = 0;
-  attribute_descriptions[2].location = 2;
-  attribute_descriptions[2].format = VK_FORMAT_R32_UINT;
-  attribute_descriptions[2].offset = offsetof(ChunkVertex, packed_light);
-
-  attribute_descriptions[3].binding = 0;
-  attribute_descriptions[3].location = 3;
-  attribute_descriptions[3].format = VK_FORMAT_R16_UINT;
-  attribute_descriptions[3].offset = offsetof(ChunkVertex, packed_uv);
-
-  attribute_descriptions[4].binding = 0;
-  attribute_descriptions[4].location = 4;
-  attribute_descriptions[4].format = VK_FORMAT_R16_UINT;
-  attribute_descriptions[4].offset = offsetof(ChunkVertex, packed_frametime);
+  attribute_descriptions[1].offset = offsetof(ChunkVertex, packed_texture);
 
   VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
   vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -468,6 +460,14 @@ void ChunkRenderer::Draw(VkCommandBuffer command_buffer, size_t current_frame, w
   ubo.sunlight = sunlight;
   ubo.alpha_discard = true;
 
+  // The first animation is always a single static frame.
+  memset(ubo.animations, 0, sizeof(ubo.animations));
+  ubo.animations[0] = 1 | (1 << 8);
+
+  if (texture_animations) {
+    memcpy(ubo.animations, texture_animations, sizeof(u32) * texture_animation_count);
+  }
+
   opaque_ubo.Set(current_frame, &ubo, sizeof(ubo));
 
   ubo.alpha_discard = false;
@@ -512,6 +512,7 @@ void ChunkRenderer::Draw(VkCommandBuffer command_buffer, size_t current_frame, w
     VkBuffer vertex_buffer;
     VkBuffer index_buffer;
     u32 index_count;
+    ChunkPushConstants push_constants;
 
     float z_dot;
   };
@@ -521,41 +522,19 @@ void ChunkRenderer::Draw(VkCommandBuffer command_buffer, size_t current_frame, w
     world.connectivity_graph.Update(*renderer->trans_arena, world, camera);
   }
 
+  renderer->BeginMeshAllocation();
+  world.mesh_scheduler.Schedule(*renderer->trans_arena, world, camera);
+  renderer->EndMeshAllocation();
+
+  mesh_backlog = world.mesh_scheduler.backlog_count + world.mesh_pipeline.GetPendingCount();
+  ++draw_count;
+
   MemoryRevert trans_revert = renderer->trans_arena->GetReverter();
   AlphaRenderElement* alpha_elements = (AlphaRenderElement*)renderer->trans_arena->Allocate(0, 8);
   size_t alpha_element_count = 0;
 
   Vector3f forward = camera.GetForward();
 
-  constexpr size_t kMaxMeshBuildPerFrame = 24;
-  size_t mesh_build_count = 0;
-
-  renderer->BeginMeshAllocation();
-  // Loop through the chunks and build any dirty meshes up to a certain amount.
-  // TODO: This part could be threaded eventually.
-  for (size_t chunk_index = 0;
-       chunk_index < world.connectivity_graph.visible_count && mesh_build_count < kMaxMeshBuildPerFrame;
-       ++chunk_index) {
-    world::VisibleChunk* visible_chunk = world.connectivity_graph.visible_set + chunk_index;
-    s32 chunk_x = visible_chunk->chunk_x;
-    s32 chunk_y = visible_chunk->chunk_y;
-    s32 chunk_z = visible_chunk->chunk_z;
-    size_t x_index = world::GetChunkCacheIndex(chunk_x);
-    size_t z_index = world::GetChunkCacheIndex(chunk_z);
-
-    if (world.chunk_infos[z_index][x_index].dirty_mesh_set & (1 << chunk_y)) {
-      ChunkBuildContext ctx(chunk_x, chunk_z);
-
-      if (ctx.GetNeighbors(&world)) {
-        world.BuildChunkMesh(&ctx, chunk_x, chunk_y, chunk_z);
-        world.chunk_infos[z_index][x_index].dirty_mesh_set &= ~(1 << chunk_y);
-        ++mesh_build_count;
-      }
-    }
-  }
-
-  renderer->EndMeshAllocation();
-
   for (size_t chunk_index = 0; chunk_index < world.connectivity_graph.visible_count; ++chunk_index) {
     world::VisibleChunk* visible_chunk = world.connectivity_graph.visible_set + chunk_index;
     s32 chunk_x = visible_chunk->chunk_x;
@@ -566,6 +545,12 @@ void ChunkRenderer::Draw(VkCommandBuffer command_buffer, size_t current_frame, w
 
     world::ChunkMesh* mesh = &world.meshes[z_index][x_index][chunk_y];
 
+    ChunkPushConstants push_constants;
+    push_constants.section_offset = Vector4f(chunk_x * 16.0f - camera.position.x,
+                                             chunk_y * 16.0f - 64.0f - camera.position.y,
+                                             chunk_z * 16.0f - camera.position.z, 0.0f);
+    push_constants.section_seed = ((u32)chunk_x * 73856093u) ^ ((u32)chunk_y * 19349663u) ^ ((u32)chunk_z * 83492791u);
+
     for (s32 i = 0; i < render::kRenderLayerCount; ++i) {
       render::RenderMesh* layer_mesh = &mesh->meshes[i];
 
@@ -576,11 +561,14 @@ void ChunkRenderer::Draw(VkCommandBuffer command_buffer, size_t current_frame, w
           element->vertex_buffer = layer_mesh->vertex_buffer;
           element->index_buffer = layer_mesh->index_buffer;
           element->index_count = layer_mesh->index_count;
+          element->push_constants = push_constants;
           element->z_dot = Vector3f(chunk_x * 16.0f, chunk_y * 16.0f, chunk_z * 16.0f).Dot(forward);
           ++alpha_element_count;
         } else {
           VkCommandBuffer current_buffer = buffers.command_buffers[i];
 
+          vkCmdPushConstants(current_buffer, this->layout.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                             sizeof(push_constants), &push_constants);
           vkCmdBindVertexBuffers(current_buffer, 0, 1, &layer_mesh->vertex_buffer, offsets);
           vkCmdBindIndexBuffer(current_buffer, layer_mesh->index_buffer, offset, VK_INDEX_TYPE_UINT16);
           vkCmdDrawIndexed(current_buffer, layer_mesh->index_count, 1, 0, 0, 0);
@@ -596,6 +584,8 @@ void ChunkRenderer::Draw(VkCommandBuffer command_buffer, size_t current_frame, w
     AlphaRenderElement* element = alpha_elements + i;
     VkCommandBuffer current_buffer = buffers.command_buffers[(size_t)RenderLayer::Alpha];
 
+    vkCmdPushConstants(current_buffer, this->layout.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                       sizeof(element->push_constants), &element->push_constants);
     vkCmdBindVertexBuffers(current_buffer, 0, 1, &element->vertex_buffer, offsets);
     vkCmdBindIndexBuffer(current_buffer, element->index_buffer, offset, VK_INDEX_TYPE_UINT16);
     vkCmdDrawIndexed(current_buffer, element->index_count, 1, 0, 0, 0);
@@ -32,24 +32,51 @@ extern const char* kRenderLayerNames[kRenderLayerCount];
 
 struct VulkanTexture;
 
+// Unique texture animations that chunk vertices can reference by index. Index zero is a static texture.
+constexpr size_t kMaxTextureAnimations = 64;
+
 struct ChunkRenderUBO {
   mat4 mvp;
   Vector4f camera;
   float anim_time;
   float sunlight;
   u32 alpha_discard;
+  // Packed as frame count | frametime << 8 | interpolated << 23. Read as a uvec4 array in the shader.
+  alignas(16) u32 animations[kMaxTextureAnimations];
 };
 
-struct ChunkVertex {
-  Vector3f position;
+// Pushed before each section is drawn.
+struct ChunkPushConstants {
+  // Section origin relative to the camera, so vertex positions stay small no matter how far from the world origin.
+  Vector4f section_offset;
+  // Hash of the section position. Tiled faces use it to randomize their texture per block.
+  u32 section_seed;
+};
+
+// Section-relative position in 1/2048 block units, biased by 8 blocks so model elements can hang outside the section.
+constexpr float kChunkVertexPositionScale = 2048.0f;
+constexpr float kChunkVertexPositionBias = 8.0f;
 
-  u32 texture_id;
-  u32 packed_light;
+constexpr u32 kChunkVertexTextureBits = 12;
+constexpr u32 kChunkVertexMaxTextures = 1 << kChunkVertexTextureBits;
 
-  u16 packed_uv;
-  u16 packed_frametime;
+// Tint indices are remapped to fit in three bits.
+constexpr u32 kChunkVertexWaterTint = 4;
+constexpr u32 kChunkVertexPlainTint = 5;
+constexpr u32 kChunkVertexNoTint = 7;
+
+struct ChunkVertex {
+  u16 x;
+  u16 y;
+  u16 z;
+  // ao 2 | skylight 6 | blocklight 6 | shaded axis 1 | vertical face 1
+  u16 packed_light;
+  // texture id 12 | uv 5+5 | tiled 1 | animation index 6 | tint 3
+  u32 packed_texture;
 };
 
+static_assert(sizeof(ChunkVertex) == 12, "ChunkVertex should be tightly packed.");
+
 struct ChunkRenderLayout {
   VkDescriptorSetLayout descriptor_layout;
   VkPipelineLayout pipeline_layout;
@@ -82,6 +109,14 @@ struct ChunkRenderer {
   ChunkFrameCommandBuffers frame_command_buffers[kMaxFramesInFlight];
 
   VulkanTexture* block_textures;
+  // Animation table built with the block textures. Copied into the uniform buffer each frame.
+  const u32* texture_animations = nullptr;
+  size_t texture_animation_count = 0;
+
+  // Dirty sections that the mesh scheduler didn't get to in the last draw, along with the meshes that are still in
+  // the mesh pipeline.
+  size_t mesh_backlog = 0;
+  u64 draw_count = 0;
 
   void Draw(VkCommandBuffer command_buffer, size_t current_frame, world::World& world, Camera& camera, float anim_time,
             float sunlight);
@@ -0,0 +1,121 @@
+#include <polymer/render/mesh_benchmark.h>
+
+#include <polymer/render/block_mesher.h>
+#include <polymer/world/world.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace polymer {
+namespace render {
+
+using Clock = std::chrono::steady_clock;
+
+struct MeshBenchmarkResult {
+  size_t section_count;
+  size_t vertex_count;
+  size_t index_count;
+  // Only the standard layer is affected by greedy meshing.
+  size_t standard_vertex_count;
+  float milliseconds;
+};
+
+static MeshBenchmarkResult MeshWorld(BlockMesher& mesher, BorderedChunk* bordered_chunk, world::World& world) {
+  MeshBenchmarkResult result = {};
+
+  for (u32 z_index = 0; z_index < world::kChunkCacheSize; ++z_index) {
+    for (u32 x_index = 0; x_index < world::kChunkCacheSize; ++x_index) {
+      world::ChunkSectionInfo* section_info = &world.chunk_infos[z_index][x_index];
+
+      if (!section_info->loaded) continue;
+
+      ChunkBuildContext ctx(section_info->x, section_info->z);
+
+      if (!ctx.GetNeighbors(&world)) continue;
+
+      for (s32 chunk_y = 0; chunk_y < (s32)world::kChunkColumnCount; ++chunk_y) {
+        if (!(section_info->bitmask & (1 << chunk_y))) continue;
+
+        SnapshotBorderedChunk(bordered_chunk, &ctx, chunk_y);
+
+        Clock::time_point start = Clock::now();
+        ChunkVertexData vertex_data = mesher.CreateMesh(bordered_chunk, ctx.chunk_x, chunk_y, ctx.chunk_z);
+        Clock::time_point end = Clock::now();
+
+        result.milliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+
+        for (size_t i = 0; i < kRenderLayerCount; ++i) {
+          result.vertex_count += vertex_data.vertex_count[i];
+          result.index_count += vertex_data.index_count[i];
+        }
+
+        result.standard_vertex_count += vertex_data.vertex_count[(size_t)RenderLayer::Standard];
+        ++result.section_count;
+
+        mesher.Reset();
+      }
+    }
+  }
+
+  return result;
+}
+
+static void PrintResult(const char* name, const MeshBenchmarkResult& result) {
+  float vertex_mb = (result.vertex_count * sizeof(ChunkVertex)) / (1024.0f * 1024.0f);
+  float index_mb = (result.index_count * sizeof(u16)) / (1024.0f * 1024.0f);
+
+  printf("mesh: %-8s %zu sections, %zu vertices (%zu standard), %zu indices, %.2f MB in %.2f ms\n", name,
+         result.section_count, result.vertex_count, result.standard_vertex_count, result.index_count,
+         vertex_mb + index_mb, result.milliseconds);
+}
+
+bool RunMeshBenchmark(asset::AssetSystem& assets, world::BlockRegistry& block_registry, world::World& world) {
+  BorderedChunk* bordered_chunk = (BorderedChunk*)malloc(sizeof(BorderedChunk));
+
+  if (!bordered_chunk) {
+    fprintf(stderr, "mesh: Failed to allocate benchmark section.\n");
+    return false;
+  }
+
+  MemoryArena arena = CreateArena(Kilobytes(64));
+  BlockMesher mesher(arena, assets, block_registry);
+
+  mesher.mapping.Initialize(block_registry);
+  mesher.state_flags = world.block_mesher.state_flags;
+
+  // The first pass warms up the caches so the two timed passes are compared fairly.
+  MeshWorld(mesher, bordered_chunk, world);
+
+  mesher.greedy_meshing = false;
+  MeshBenchmarkResult standard = MeshWorld(mesher, bordered_chunk, world);
+
+  mesher.greedy_meshing = true;
+  MeshBenchmarkResult greedy = MeshWorld(mesher, bordered_chunk, world);
+
+  free(bordered_chunk);
+  arena.Destroy();
+
+  if (standard.section_count == 0) {
+    fprintf(stderr, "mesh: No loaded sections to benchmark.\n");
+    return false;
+  }
+
+  PrintResult("standard", standard);
+  PrintResult("greedy", greedy);
+
+  if (greedy.vertex_count > 0 && standard.milliseconds > 0.0f) {
+    printf("mesh: greedy meshing uses %.2fx fewer vertices (%.2fx in the standard layer) and %.2fx the time\n",
+           (float)standard.vertex_count / greedy.vertex_count,
+           greedy.standard_vertex_count > 0 ? (float)standard.standard_vertex_count / greedy.standard_vertex_count
+                                            : 0.0f,
+           greedy.milliseconds / standard.milliseconds);
+  }
+
+  fflush(stdout);
+
+  return true;
+}
+
+} // namespace render
+} // namespace polymer
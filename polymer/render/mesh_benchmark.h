@@ -0,0 +1,27 @@
+#ifndef POLYMER_RENDER_MESH_BENCHMARK_H_
+#define POLYMER_RENDER_MESH_BENCHMARK_H_
+
+namespace polymer {
+
+namespace asset {
+
+struct AssetSystem;
+
+} // namespace asset
+
+namespace world {
+
+struct BlockRegistry;
+struct World;
+
+} // namespace world
+
+namespace render {
+
+// Meshes every loaded section with the regular mesher and then the greedy mesher and prints their sizes and times.
+bool RunMeshBenchmark(asset::AssetSystem& assets, world::BlockRegistry& block_registry, world::World& world);
+
+} // namespace render
+} // namespace polymer
+
+#endif
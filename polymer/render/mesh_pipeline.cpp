@@ -0,0 +1,196 @@
+#include <polymer/render/mesh_pipeline.h>
+
+namespace polymer {
+namespace render {
+
+void MeshPipeline::Start(asset::AssetSystem& assets, world::BlockRegistry& block_registry, size_t worker_count) {
+  if (worker_count < 1) worker_count = 1;
+  if (worker_count > kMaxWorkers) worker_count = kMaxWorkers;
+
+  if (!arena.base) {
+    arena = CreateArena(kMaxJobs * sizeof(BorderedChunk) + kMaxWorkers * sizeof(BlockMesher) + Kilobytes(64));
+
+    for (size_t i = 0; i < kMaxJobs; ++i) {
+      jobs[i].bordered_chunk = memory_arena_push_type(&arena, BorderedChunk);
+    }
+  }
+
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    free_jobs[i] = kMaxJobs - i - 1;
+  }
+
+  this->free_count = kMaxJobs;
+  this->pending_count = 0;
+  this->next_queue = 0;
+  this->complete_read = this->complete_write = 0;
+  this->queued_count.store(0, std::memory_order_relaxed);
+  this->worker_count = worker_count;
+  this->running = true;
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    Worker& worker = workers[i];
+
+    if (!worker.mesher) {
+      worker.arena = CreateArena(kWorkerArenaSize);
+      worker.mesher = arena.Construct<BlockMesher>(worker.arena, assets, block_registry);
+      worker.mesher->mapping.Initialize(block_registry);
+    }
+
+    worker.mesher->Reset();
+    worker.mesher->greedy_meshing = greedy_meshing;
+    worker.mesher->state_flags = state_flags;
+    worker.queue.read_index = worker.queue.write_index = 0;
+    worker.outstanding.store(0, std::memory_order_relaxed);
+
+    worker.thread = std::thread([this, i]() { RunWorker(i); });
+  }
+}
+
+void MeshPipeline::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(work_mutex);
+    running = false;
+  }
+
+  work_cv.notify_all();
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    if (workers[i].thread.joinable()) {
+      workers[i].thread.join();
+    }
+  }
+
+  // Anything still queued or unreleased is dropped.
+  worker_count = 0;
+  free_count = 0;
+  pending_count = 0;
+}
+
+bool MeshPipeline::Submit(ChunkBuildContext* ctx, s32 chunk_y, u32 generation) {
+  if (!running || free_count == 0) return false;
+
+  size_t job_index = free_jobs[--free_count];
+  Job& job = jobs[job_index];
+
+  job.chunk_x = ctx->chunk_x;
+  job.chunk_y = chunk_y;
+  job.chunk_z = ctx->chunk_z;
+  job.generation = generation;
+  job.vertex_data = ChunkVertexData();
+
+  SnapshotBorderedChunk(job.bordered_chunk, ctx, chunk_y);
+
+  ++pending_count;
+
+  // Queues never fill because there are only as many jobs as a queue can hold.
+  WorkQueue& queue = workers[next_queue++ % worker_count].queue;
+
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs[queue.write_index++ % kMaxJobs] = job_index;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(work_mutex);
+    queued_count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  work_cv.notify_one();
+
+  return true;
+}
+
+MeshResult* MeshPipeline::PopResult() {
+  std::lock_guard<std::mutex> lock(complete_mutex);
+
+  if (complete_read == complete_write) return nullptr;
+
+  return jobs + complete[complete_read++ % kMaxJobs];
+}
+
+void MeshPipeline::Release(MeshResult* result) {
+  Job* job = static_cast<Job*>(result);
+  Worker& worker = workers[job->worker_index];
+
+  free_jobs[free_count++] = (size_t)(job - jobs);
+  --pending_count;
+
+  if (worker.outstanding.fetch_sub(1, std::memory_order_release) == 1) {
+    // The worker might be waiting for its arenas to be released before it can take more work.
+    {
+      std::lock_guard<std::mutex> lock(work_mutex);
+    }
+
+    work_cv.notify_all();
+  }
+}
+
+bool MeshPipeline::CanMesh(Worker& worker) {
+  return worker.outstanding.load(std::memory_order_acquire) == 0 || worker.mesher->HasMeshCapacity();
+}
+
+bool MeshPipeline::TakeJob(size_t worker_index, size_t* job_index) {
+  {
+    WorkQueue& queue = workers[worker_index].queue;
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.read_index != queue.write_index) {
+      *job_index = queue.jobs[queue.read_index++ % kMaxJobs];
+      return true;
+    }
+  }
+
+  // Steal the newest job from another worker so its owner keeps working through the oldest ones.
+  for (size_t i = 1; i < worker_count; ++i) {
+    WorkQueue& queue = workers[(worker_index + i) % worker_count].queue;
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.read_index != queue.write_index) {
+      *job_index = queue.jobs[--queue.write_index % kMaxJobs];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void MeshPipeline::RunWorker(size_t worker_index) {
+  Worker& worker = workers[worker_index];
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(work_mutex);
+
+      work_cv.wait(lock, [this, &worker]() {
+        return !running || (queued_count.load(std::memory_order_relaxed) > 0 && CanMesh(worker));
+      });
+
+      if (!running) break;
+    }
+
+    size_t job_index = 0;
+
+    // Another worker can take the job between the wake and here.
+    if (!TakeJob(worker_index, &job_index)) continue;
+
+    queued_count.fetch_sub(1, std::memory_order_relaxed);
+
+    // Every result that pointed into the arenas has been uploaded, so the meshes can start at the beginning again.
+    if (worker.outstanding.load(std::memory_order_acquire) == 0) {
+      worker.mesher->Reset();
+    }
+
+    Job& job = jobs[job_index];
+
+    job.vertex_data = worker.mesher->CreateMesh(job.bordered_chunk, job.chunk_x, job.chunk_y, job.chunk_z);
+    job.worker_index = worker_index;
+
+    worker.outstanding.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(complete_mutex);
+    complete[complete_write++ % kMaxJobs] = job_index;
+  }
+}
+
+} // namespace render
+} // namespace polymer
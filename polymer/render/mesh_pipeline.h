@@ -0,0 +1,109 @@
+#ifndef POLYMER_RENDER_MESH_PIPELINE_H_
+#define POLYMER_RENDER_MESH_PIPELINE_H_
+
+#include <polymer/memory.h>
+#include <polymer/render/block_mesher.h>
+#include <polymer/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace polymer {
+namespace render {
+
+struct MeshResult {
+  s32 chunk_x;
+  s32 chunk_y;
+  s32 chunk_z;
+  // Copied from the submit so stale results can be recognized after the column changes.
+  u32 generation;
+
+  ChunkVertexData vertex_data;
+};
+
+// Meshes chunk sections on a pool of worker threads.
+// The render thread snapshots each section with its border when it's submitted, so workers never read the world.
+// Every worker has its own BlockMesher and arenas, and it keeps appending meshes to them until the render thread has
+// released every result that points into them.
+//
+// Each worker has its own job queue. Submitted jobs are spread across the queues, and a worker that runs out steals
+// from the back of the others, so one slow section doesn't hold up the jobs behind it.
+struct MeshPipeline {
+  constexpr static size_t kMaxJobs = 128;
+  constexpr static size_t kMaxWorkers = 8;
+  // Only used by the snapshot path of BlockMesher, which the workers never take.
+  constexpr static size_t kWorkerArenaSize = Kilobytes(64);
+
+  // Copied to every worker's mesher on Start.
+  bool greedy_meshing = false;
+  const u8* state_flags = nullptr;
+
+  void Start(asset::AssetSystem& assets, world::BlockRegistry& block_registry, size_t worker_count);
+  void Stop();
+
+  // Render thread: snapshots the section and queues it for meshing. Returns false if every job is in use.
+  bool Submit(ChunkBuildContext* ctx, s32 chunk_y, u32 generation);
+
+  // Render thread: returns the next finished mesh or null. The vertex data stays valid until the result is released.
+  MeshResult* PopResult();
+  void Release(MeshResult* result);
+
+  // Render thread: number of submitted meshes that haven't been released yet.
+  inline size_t GetPendingCount() const {
+    return pending_count;
+  }
+
+private:
+  struct Job : MeshResult {
+    BorderedChunk* bordered_chunk;
+    size_t worker_index;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    size_t jobs[kMaxJobs];
+    size_t read_index = 0;
+    size_t write_index = 0;
+  };
+
+  struct Worker {
+    std::thread thread;
+    BlockMesher* mesher = nullptr;
+    MemoryArena arena;
+    WorkQueue queue;
+    // Results that point into the mesher's arenas. The arenas are only reset once this drops to zero.
+    std::atomic<size_t> outstanding{0};
+  };
+
+  void RunWorker(size_t worker_index);
+  bool TakeJob(size_t worker_index, size_t* job_index);
+  bool CanMesh(Worker& worker);
+
+  MemoryArena arena;
+
+  Job jobs[kMaxJobs];
+  size_t free_jobs[kMaxJobs];
+  size_t free_count = 0;
+  size_t pending_count = 0;
+  size_t next_queue = 0;
+
+  Worker workers[kMaxWorkers];
+  size_t worker_count = 0;
+  bool running = false;
+
+  std::mutex work_mutex;
+  std::condition_variable work_cv;
+  std::atomic<size_t> queued_count{0};
+
+  std::mutex complete_mutex;
+  size_t complete[kMaxJobs];
+  size_t complete_read = 0;
+  size_t complete_write = 0;
+};
+
+} // namespace render
+} // namespace polymer
+
+#endif
@@ -0,0 +1,170 @@
+#include <polymer/render/mesh_scheduler.h>
+
+#include <polymer/camera.h>
+#include <polymer/world/world.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace polymer {
+namespace render {
+
+using Clock = std::chrono::steady_clock;
+
+struct MeshCandidate {
+  float priority;
+  float distance;
+  s32 chunk_x;
+  s32 chunk_z;
+  s32 chunk_y;
+};
+
+// Orders the heap so the lowest priority value is at the front.
+static inline bool IsLowerPriority(const MeshCandidate& a, const MeshCandidate& b) {
+  return a.priority > b.priority;
+}
+
+void MeshScheduler::Schedule(MemoryArena& trans_arena, world::World& world, const Camera& camera) {
+  Clock::time_point start = Clock::now();
+  Clock::time_point deadline = start + std::chrono::microseconds(budget_us);
+
+  ++frame;
+
+  immediate_count = 0;
+  submit_count = 0;
+  backlog_count = 0;
+
+  // Finished meshes are the cheapest progress, so they get the budget first.
+  while (Clock::now() < deadline && world.ApplyChunkMesh()) {
+  }
+
+  MemoryRevert trans_revert = trans_arena.GetReverter();
+  MeshCandidate* candidates = (MeshCandidate*)trans_arena.Allocate(0, 8);
+  size_t candidate_count = 0;
+
+  Frustum frustum = camera.GetViewFrustum();
+
+  for (u32 z_index = 0; z_index < world::kChunkCacheSize; ++z_index) {
+    for (u32 x_index = 0; x_index < world::kChunkCacheSize; ++x_index) {
+      world::ChunkSectionInfo* section_info = &world.chunk_infos[z_index][x_index];
+      ColumnState* column = &columns[z_index][x_index];
+
+      if (column->generation != section_info->generation) {
+        column->generation = section_info->generation;
+        memset(column->dirty_frames, 0, sizeof(column->dirty_frames));
+      }
+
+      if (!section_info->loaded || !section_info->dirty_mesh_set) continue;
+
+      world::ChunkMesh* meshes = world.meshes[z_index][x_index];
+
+      // Empty sections without an old mesh to replace would only produce an empty mesh.
+      for (s32 chunk_y = 0; chunk_y < (s32)world::kChunkColumnCount; ++chunk_y) {
+        u32 bit = 1 << chunk_y;
+
+        if (!(section_info->dirty_mesh_set & bit) || (section_info->bitmask & bit)) continue;
+
+        bool has_mesh = false;
+
+        for (s32 i = 0; i < kRenderLayerCount; ++i) {
+          has_mesh |= meshes[chunk_y].meshes[i].vertex_count > 0;
+        }
+
+        if (!has_mesh) {
+          section_info->dirty_mesh_set &= ~bit;
+          column->dirty_frames[chunk_y] = 0;
+        }
+      }
+
+      if (!section_info->dirty_mesh_set) continue;
+
+      ChunkBuildContext ctx(section_info->x, section_info->z);
+
+      // Sections that are still missing neighbors can't be built yet, so they aren't part of the backlog.
+      if (!ctx.GetNeighbors(&world)) continue;
+
+      for (s32 chunk_y = 0; chunk_y < (s32)world::kChunkColumnCount; ++chunk_y) {
+        u32 bit = 1 << chunk_y;
+
+        if (!(section_info->dirty_mesh_set & bit)) continue;
+
+        if (column->dirty_frames[chunk_y] == 0) {
+          column->dirty_frames[chunk_y] = frame;
+        }
+
+        // A section that changed while it was being meshed waits for that result so they are applied in order.
+        if (section_info->meshing_set & bit) {
+          ++backlog_count;
+          continue;
+        }
+
+        Vector3f chunk_min(ctx.chunk_x * 16.0f, chunk_y * 16.0f - 64.0f, ctx.chunk_z * 16.0f);
+        Vector3f chunk_max = chunk_min + Vector3f(16.0f, 16.0f, 16.0f);
+        Vector3f center = chunk_min + Vector3f(8.0f, 8.0f, 8.0f);
+
+        float distance = (center - camera.position).Length() / 16.0f;
+        float age = (frame - column->dirty_frames[chunk_y]) / kAgeFramesPerSection;
+
+        MeshCandidate* candidate = memory_arena_push_type(&trans_arena, MeshCandidate);
+
+        candidate->distance = distance;
+        candidate->priority = distance - (age < kMaxAgeBonus ? age : kMaxAgeBonus);
+        candidate->chunk_x = ctx.chunk_x;
+        candidate->chunk_z = ctx.chunk_z;
+        candidate->chunk_y = chunk_y;
+
+        if (!frustum.Intersects(chunk_min, chunk_max)) {
+          candidate->priority += kOutOfViewPenalty;
+        }
+
+        ++candidate_count;
+      }
+    }
+  }
+
+  std::make_heap(candidates, candidates + candidate_count, IsLowerPriority);
+
+  size_t remaining = candidate_count;
+
+  while (remaining > 0 && Clock::now() < deadline) {
+    std::pop_heap(candidates, candidates + remaining, IsLowerPriority);
+
+    MeshCandidate* candidate = candidates + remaining - 1;
+    ChunkBuildContext ctx(candidate->chunk_x, candidate->chunk_z);
+
+    ctx.GetNeighbors(&world);
+
+    world::ChunkSectionInfo* section_info = &world.chunk_infos[ctx.z_index][ctx.x_index];
+
+    --remaining;
+
+    if (candidate->distance <= kImmediateDistance) {
+      world.BuildChunkMesh(&ctx, ctx.chunk_x, candidate->chunk_y, ctx.chunk_z);
+      section_info->dirty_mesh_set &= ~(1 << candidate->chunk_y);
+      ++immediate_count;
+    } else {
+      bool submitted =
+          submit_count < kMaxSubmitPerFrame && world.QueueChunkMesh(&ctx, candidate->chunk_y);
+
+      // Keep going when the pipeline is full because there might still be immediate sections left to build.
+      if (!submitted) {
+        ++backlog_count;
+
+        // Nothing that is built immediately can score worse than this.
+        if (candidate->priority > kImmediateDistance + kOutOfViewPenalty) break;
+        continue;
+      }
+
+      ++submit_count;
+    }
+
+    columns[ctx.z_index][ctx.x_index].dirty_frames[candidate->chunk_y] = 0;
+  }
+
+  backlog_count += remaining;
+
+  elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+} // namespace render
+} // namespace polymer
@@ -0,0 +1,64 @@
+#ifndef POLYMER_RENDER_MESH_SCHEDULER_H_
+#define POLYMER_RENDER_MESH_SCHEDULER_H_
+
+#include <polymer/memory.h>
+#include <polymer/types.h>
+#include <polymer/world/chunk.h>
+
+namespace polymer {
+
+struct Camera;
+
+namespace world {
+
+struct World;
+
+} // namespace world
+
+namespace render {
+
+// Picks which dirty sections get meshed each frame.
+// Every dirty section with loaded neighbors is scored by its distance to the camera, whether it's in the view frustum
+// and how long it has been dirty. Sections are taken from the best score down until the frame's time budget runs out.
+// Sections right around the camera are built on the render thread so edits there show up in the same frame. The rest
+// are submitted to the mesh pipeline.
+struct MeshScheduler {
+  constexpr static s64 kDefaultBudgetMicroseconds = 2000;
+  constexpr static size_t kMaxSubmitPerFrame = 64;
+  // Sections with a center this many sections from the camera are built immediately.
+  constexpr static float kImmediateDistance = 1.5f;
+  // Sections outside of the frustum are scored as if they were this many sections further away.
+  constexpr static float kOutOfViewPenalty = 8.0f;
+  // A section scores one section closer for every this many frames that it has been waiting.
+  constexpr static float kAgeFramesPerSection = 15.0f;
+  constexpr static float kMaxAgeBonus = 16.0f;
+
+  struct ColumnState {
+    // Used to notice when the column was reloaded, so the old dirty frames can be cleared.
+    u32 generation;
+    // The frame that each section was first seen dirty. Zero means it isn't being tracked.
+    u32 dirty_frames[world::kChunkColumnCount];
+  };
+
+  // CPU time that the render thread can spend uploading, snapshotting and building meshes each frame.
+  s64 budget_us = kDefaultBudgetMicroseconds;
+
+  // Results of the last Schedule.
+  size_t immediate_count = 0;
+  size_t submit_count = 0;
+  size_t backlog_count = 0;
+  s64 elapsed_us = 0;
+
+  // Uploads finished meshes and then builds or submits the highest priority dirty sections.
+  // Must be called between Begin and EndMeshAllocation.
+  void Schedule(MemoryArena& trans_arena, world::World& world, const Camera& camera);
+
+private:
+  ColumnState columns[world::kChunkCacheSize][world::kChunkCacheSize];
+  u32 frame = 0;
+};
+
+} // namespace render
+} // namespace polymer
+
+#endif
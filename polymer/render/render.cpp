@@ -631,6 +631,9 @@ bool VulkanRenderer::BeginFrame() {
 
   vkWaitForFences(device, 1, frame_fences + current_frame, VK_TRUE, UINT64_MAX);
 
+  // The queue finishes submissions in order, so everything up to the frame behind this fence is done.
+  DestroyRetiredBuffers(fence_frames[current_frame]);
+
   if (render_paused || invalid_swapchain) {
     RecreateSwapchain();
     return false;
@@ -662,6 +665,7 @@ void VulkanRenderer::Render() {
   }
 
   swapchain.image_fences[image_index] = frame_fences[current_frame];
+  fence_frames[current_frame] = ++submitted_frame_count;
 
   VkSwapchainKHR swapchains[] = {swapchain.swapchain};
   VkSemaphore render_semaphore = render_complete_semaphores[current_frame];
@@ -732,6 +736,8 @@ void VulkanRenderer::EndOneShotCommandBuffer() {
 
 void VulkanRenderer::WaitForIdle() {
   vkQueueWaitIdle(graphics_queue);
+
+  DestroyRetiredBuffers(submitted_frame_count);
 }
 
 bool VulkanRenderer::PushStagingBuffer(u8* data, size_t data_size, VkBuffer* buffer, VmaAllocation* allocation,
@@ -828,11 +834,41 @@ void VulkanRenderer::EndMeshAllocation() {
 
 void VulkanRenderer::FreeMesh(RenderMesh* mesh) {
   if (mesh->vertex_count > 0) {
-    vmaDestroyBuffer(allocator, mesh->vertex_buffer, mesh->vertex_allocation);
+    RetireBuffer(mesh->vertex_buffer, mesh->vertex_allocation);
   }
 
   if (mesh->index_count > 0) {
-    vmaDestroyBuffer(allocator, mesh->index_buffer, mesh->index_allocation);
+    RetireBuffer(mesh->index_buffer, mesh->index_allocation);
+  }
+}
+
+void VulkanRenderer::RetireBuffer(VkBuffer buffer, VmaAllocation allocation) {
+  if (retired_write_index - retired_read_index >= kMaxRetiredBuffers) {
+    // Draining the queue is the slow path, but it frees up everything that was retired before this frame.
+    WaitForIdle();
+
+    if (retired_write_index - retired_read_index >= kMaxRetiredBuffers) {
+      vmaDestroyBuffer(allocator, buffer, allocation);
+      return;
+    }
+  }
+
+  RetiredBuffer* retired = retired_buffers + (retired_write_index++ % kMaxRetiredBuffers);
+
+  retired->buffer = buffer;
+  retired->allocation = allocation;
+  // The frame being recorded hasn't been submitted yet, so it could still draw with the buffer.
+  retired->frame = submitted_frame_count + 1;
+}
+
+void VulkanRenderer::DestroyRetiredBuffers(u64 completed_frame) {
+  while (retired_read_index != retired_write_index) {
+    RetiredBuffer* retired = retired_buffers + (retired_read_index % kMaxRetiredBuffers);
+
+    if (retired->frame > completed_frame) break;
+
+    vmaDestroyBuffer(allocator, retired->buffer, retired->allocation);
+    ++retired_read_index;
   }
 }
 
@@ -1230,6 +1266,9 @@ bool VulkanRenderer::CreateInstance() {
 void VulkanRenderer::Shutdown() {
   vkDeviceWaitIdle(device);
 
+  // Nothing is in flight anymore, so every retired buffer can go, including ones retired after the last submit.
+  DestroyRetiredBuffers(~0ULL);
+
   VulkanTexture* current = texture_manager.textures;
   while (current) {
     vkDestroySampler(device, current->sampler, nullptr);
@@ -38,6 +38,14 @@ struct RenderMesh {
   u32 index_count;
 };
 
+// A buffer that was freed while frames that might still be drawing with it were in flight.
+struct RetiredBuffer {
+  VkBuffer buffer;
+  VmaAllocation allocation;
+  // The last frame that could have used the buffer.
+  u64 frame;
+};
+
 struct UniformBuffer {
   VmaAllocator allocator;
 
@@ -93,6 +101,9 @@ struct VulkanRenderer {
   VkSemaphore render_complete_semaphores[kMaxFramesInFlight];
   VkSemaphore image_available_semaphores[kMaxFramesInFlight];
   VkFence frame_fences[kMaxFramesInFlight];
+  // The number of the frame that was last submitted with each fence. Frames are numbered from one.
+  u64 fence_frames[kMaxFramesInFlight] = {};
+  u64 submitted_frame_count = 0;
 
   VulkanTextureManager texture_manager;
 
@@ -110,6 +121,14 @@ struct VulkanRenderer {
   VmaAllocation staging_allocs[2048];
   size_t staging_buffer_count = 0;
 
+  // Freed mesh buffers are kept in submission order until the fences of every frame that could use them have
+  // signaled, so freeing a mesh never has to wait for the queue to drain.
+  constexpr static size_t kMaxRetiredBuffers = 8192;
+
+  RetiredBuffer retired_buffers[kMaxRetiredBuffers];
+  size_t retired_read_index = 0;
+  size_t retired_write_index = 0;
+
   bool Initialize(PolymerWindow window, RenderConfig cfg);
   void RecreateSwapchain();
   bool BeginFrame();
@@ -120,6 +139,7 @@ struct VulkanRenderer {
   // Uses staging buffer to push data to the gpu and returns the allocation buffers.
   RenderMesh AllocateMesh(u8* vertex_data, size_t vertex_data_size, size_t vertex_count, u16* index_data,
                           size_t index_count);
+  // The buffers are destroyed once the frames in flight are done with them.
   void FreeMesh(RenderMesh* mesh);
 
   VulkanTexture* CreateTexture(TextureConfig cfg, u32 width, u32 height, VkImageType image_type,
@@ -144,6 +164,10 @@ struct VulkanRenderer {
   }
 
 private:
+  void RetireBuffer(VkBuffer buffer, VmaAllocation allocation);
+  // Destroys the retired buffers that were last usable by completed_frame or earlier.
+  void DestroyRetiredBuffers(u64 completed_frame);
+
   bool PushStagingBuffer(u8* data, size_t data_size, VkBuffer* buffer, VmaAllocation* allocation,
                          VkBufferUsageFlagBits usage_type);
 
@@ -16,6 +16,9 @@ struct RenderConfig {
 
   // Range: [1, 32]. This increases rendering and processing time by a lot.
   u8 view_distance = 16;
+
+  // Merges flat areas of full cubes into larger quads. Uses fewer vertices but changes how textures are sampled.
+  bool greedy_meshing = false;
 };
 
 } // namespace render
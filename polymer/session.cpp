@@ -0,0 +1,110 @@
+#include <polymer/session.h>
+
+#include <curl/curl.h>
+#include <stdio.h>
+
+namespace polymer {
+
+static size_t OnCurlDiscard(char* /*data*/, size_t n, size_t l, void* /*userp*/) {
+  return n * l;
+}
+
+bool JoinSession(const String& access_token, const u8* profile_id, const char* server_hash) {
+  constexpr const char* kJoinUrl = "https://sessionserver.mojang.com/session/minecraft/join";
+  constexpr const char* kHex = "0123456789abcdef";
+  constexpr long kConnectTimeoutSeconds = 5;
+  constexpr long kTimeoutSeconds = 10;
+
+  char undashed_id[kProfileIdSize * 2 + 1];
+
+  for (size_t i = 0; i < kProfileIdSize; ++i) {
+    undashed_id[i * 2] = kHex[profile_id[i] >> 4];
+    undashed_id[i * 2 + 1] = kHex[profile_id[i] & 0x0F];
+  }
+
+  undashed_id[kProfileIdSize * 2] = 0;
+
+  // Access tokens are base64 so they can go into the json without escaping.
+  char body[4096];
+  int body_size = snprintf(body, sizeof(body), "{\"accessToken\":\"%.*s\",\"selectedProfile\":\"%s\",\"serverId\":\"%s\"}",
+                           (int)access_token.size, access_token.data, undashed_id, server_hash);
+
+  if (body_size < 0 || body_size >= (int)sizeof(body)) {
+    fprintf(stderr, "session: Access token is too long.\n");
+    return false;
+  }
+
+  CURL* curl = curl_easy_init();
+
+  if (!curl) {
+    fprintf(stderr, "session: Failed to create curl handle.\n");
+    return false;
+  }
+
+  curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+
+  curl_easy_setopt(curl, CURLOPT_URL, kJoinUrl);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_size);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, OnCurlDiscard);
+  // The join blocks the game thread, so a stalled session server can only hold it up this long.
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kConnectTimeoutSeconds);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, kTimeoutSeconds);
+
+  CURLcode result = curl_easy_perform(curl);
+  long http_code = 0;
+
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+  curl_slist_free_all(headers);
+  curl_easy_cleanup(curl);
+
+  if (result != CURLE_OK) {
+    fprintf(stderr, "session: Join request failed: %s\n", curl_easy_strerror(result));
+    return false;
+  }
+
+  // The session server responds with no content when the join is accepted.
+  if (http_code != 204) {
+    fprintf(stderr, "session: Join request was rejected with status %ld.\n", http_code);
+    return false;
+  }
+
+  return true;
+}
+
+bool ParseProfileId(const String& str, u8* profile_id) {
+  size_t nibble_count = 0;
+
+  for (size_t i = 0; i < str.size; ++i) {
+    char c = str.data[i];
+    u8 nibble = 0;
+
+    if (c == '-') continue;
+
+    if (c >= '0' && c <= '9') {
+      nibble = (u8)(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      nibble = (u8)(c - 'a' + 10);
+    } else if (c >= 'A' && c <= 'F') {
+      nibble = (u8)(c - 'A' + 10);
+    } else {
+      return false;
+    }
+
+    if (nibble_count >= kProfileIdSize * 2) return false;
+
+    if (nibble_count % 2 == 0) {
+      profile_id[nibble_count / 2] = (u8)(nibble << 4);
+    } else {
+      profile_id[nibble_count / 2] |= nibble;
+    }
+
+    ++nibble_count;
+  }
+
+  return nibble_count == kProfileIdSize * 2;
+}
+
+} // namespace polymer
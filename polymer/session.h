@@ -0,0 +1,19 @@
+#ifndef POLYMER_SESSION_H_
+#define POLYMER_SESSION_H_
+
+#include <polymer/types.h>
+
+namespace polymer {
+
+constexpr size_t kProfileIdSize = 16;
+
+// Tells the session server that the profile is joining the server with this hash. Online-mode servers look for it
+// before they accept the login. This blocks until the request finishes.
+bool JoinSession(const String& access_token, const u8* profile_id, const char* server_hash);
+
+// Parses a profile id in hex, with or without dashes.
+bool ParseProfileId(const String& str, u8* profile_id);
+
+} // namespace polymer
+
+#endif
@@ -0,0 +1,181 @@
+#include <polymer/socket_poller.h>
+
+#include <chrono>
+#include <thread>
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <WS2tcpip.h>
+#include <Windows.h>
+#else
+#include <sys/select.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace polymer {
+
+#ifdef __linux__
+
+bool SocketPoller::Initialize(SocketType fd) {
+  this->fd = fd;
+  this->registered_events = 0;
+
+  poll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+  if (poll_fd < 0) {
+    fprintf(stderr, "socket_poller: Failed to create epoll instance: %d\n", errno);
+    return false;
+  }
+
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (wake_fd < 0) {
+    fprintf(stderr, "socket_poller: Failed to create eventfd: %d\n", errno);
+    Destroy();
+    return false;
+  }
+
+  epoll_event event = {};
+
+  event.events = EPOLLIN;
+  event.data.fd = wake_fd;
+
+  // The socket is registered with an empty interest set so later changes are always EPOLL_CTL_MOD.
+  epoll_event socket_event = {};
+
+  socket_event.data.fd = fd;
+
+  if (epoll_ctl(poll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0 ||
+      epoll_ctl(poll_fd, EPOLL_CTL_ADD, fd, &socket_event) != 0) {
+    fprintf(stderr, "socket_poller: Failed to register with epoll: %d\n", errno);
+    Destroy();
+    return false;
+  }
+
+  return true;
+}
+
+void SocketPoller::Destroy() {
+  if (wake_fd != -1) {
+    close(wake_fd);
+    wake_fd = -1;
+  }
+
+  if (poll_fd != -1) {
+    close(poll_fd);
+    poll_fd = -1;
+  }
+
+  fd = -1;
+}
+
+SocketEvents SocketPoller::Wait(bool want_read, bool want_write, int timeout_ms) {
+  u32 interest = (want_read ? (u32)EPOLLIN : 0) | (want_write ? (u32)EPOLLOUT : 0);
+
+  if (interest != registered_events) {
+    epoll_event event = {};
+
+    event.events = interest;
+    event.data.fd = fd;
+
+    if (epoll_ctl(poll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+      return SocketEvent_Error;
+    }
+
+    registered_events = interest;
+  }
+
+  epoll_event events[2];
+  int count = epoll_wait(poll_fd, events, 2, timeout_ms);
+
+  if (count < 0) {
+    return errno == EINTR ? 0 : (SocketEvents)SocketEvent_Error;
+  }
+
+  SocketEvents result = 0;
+
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == wake_fd) {
+      result |= SocketEvent_Woken;
+      continue;
+    }
+
+    // Hangups and errors are reported as readable so the following recv picks up the actual result.
+    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) result |= SocketEvent_Readable;
+    if (events[i].events & EPOLLOUT) result |= SocketEvent_Writable;
+  }
+
+  return result;
+}
+
+bool SocketPoller::Wake() {
+  u64 value = 1;
+
+  return write(wake_fd, &value, sizeof(value)) == sizeof(value);
+}
+
+void SocketPoller::ClearWake() {
+  u64 value = 0;
+
+  while (read(wake_fd, &value, sizeof(value)) == sizeof(value)) {
+  }
+}
+
+#else
+
+bool SocketPoller::Initialize(SocketType fd) {
+  this->fd = fd;
+  return true;
+}
+
+void SocketPoller::Destroy() {
+  fd = -1;
+}
+
+SocketEvents SocketPoller::Wait(bool want_read, bool want_write, int timeout_ms) {
+  // Winsock rejects a select without any sockets in it.
+  if (!want_read && !want_write) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+    return 0;
+  }
+
+  fd_set read_set;
+  fd_set write_set;
+
+  FD_ZERO(&read_set);
+  FD_ZERO(&write_set);
+
+  if (want_read) FD_SET(fd, &read_set);
+  if (want_write) FD_SET(fd, &write_set);
+
+  timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+
+  int count = select((int)fd + 1, &read_set, &write_set, nullptr, &timeout);
+
+  if (count <= 0) return 0;
+
+  SocketEvents result = 0;
+
+  if (FD_ISSET(fd, &read_set)) result |= SocketEvent_Readable;
+  if (FD_ISSET(fd, &write_set)) result |= SocketEvent_Writable;
+
+  return result;
+}
+
+bool SocketPoller::Wake() {
+  return false;
+}
+
+void SocketPoller::ClearWake() {}
+
+#endif
+
+} // namespace polymer
@@ -0,0 +1,52 @@
+#ifndef POLYMER_SOCKET_POLLER_H_
+#define POLYMER_SOCKET_POLLER_H_
+
+#include <polymer/types.h>
+
+namespace polymer {
+
+#ifdef _WIN64
+using SocketType = long long;
+#else
+using SocketType = int;
+#endif
+
+enum SocketEventFlags : u32 {
+  SocketEvent_Readable = (1 << 0),
+  SocketEvent_Writable = (1 << 1),
+  SocketEvent_Woken = (1 << 2),
+  SocketEvent_Error = (1 << 3),
+};
+using SocketEvents = u32;
+
+// Blocks the network thread until its socket is ready or another thread wakes it.
+// Linux uses epoll with an eventfd for wakeups, so the interest set is only changed when it actually changes and a
+// wait is a single syscall. Other platforms fall back to select and can't be woken, so they should wait with a short
+// timeout.
+struct SocketPoller {
+  bool Initialize(SocketType fd);
+  void Destroy();
+
+  // Waits up to timeout_ms for the requested readiness. Returns the events that fired, which is zero on timeout.
+  SocketEvents Wait(bool want_read, bool want_write, int timeout_ms);
+
+  // Safe to call from any thread. Wakes a current or upcoming Wait. Returns false if this platform can't wake.
+  bool Wake();
+  // Clears a pending wakeup. Only called by the thread that waits.
+  void ClearWake();
+
+  inline bool CanWake() const {
+    return wake_fd != -1;
+  }
+
+private:
+  SocketType fd = -1;
+  int poll_fd = -1;
+  int wake_fd = -1;
+  // The epoll interest that is currently registered for the socket.
+  u32 registered_events = 0;
+};
+
+} // namespace polymer
+
+#endif
@@ -182,6 +182,18 @@ bool ChunkConnectivitySet::Build(const World& world, const Chunk& chunk) {
 
   this->Clear();
 
+  if (chunk.IsSingleValue()) {
+    // A uniform chunk is either fully connected or fully blocked, so it doesn't need any flood fills.
+    BlockModel& model = world.block_registry.states[chunk.GetBlock(0)].model;
+    bool passable = model.element_count == 0 || model.HasTransparency();
+
+    if (passable && !(model.is_cube && !model.HasTransparency())) {
+      connectivity.set();
+    }
+
+    return old_connectivity != connectivity;
+  }
+
   MemoryRevert revert = world.trans_arena.GetReverter();
   // Allocate a buffer that can be used for every flood fill instead of being on the stack.
   Coord* queue = memory_arena_push_type_count(&world.trans_arena, Coord, 16 * 16 * 16);
@@ -192,7 +204,7 @@ bool ChunkConnectivitySet::Build(const World& world, const Chunk& chunk) {
         // Only begin flood fills from the outer edges because inside doesn't matter.
         if (!(x == 0 || y == 0 || z == 0 || x == 15 || y == 15 || z == 15)) continue;
 
-        u32 bid = chunk.blocks[y][z][x];
+        u32 bid = chunk.GetBlock(x, y, z);
         BlockModel& model = world.block_registry.states[bid].model;
 
         if (!(model.element_count == 0 || model.HasTransparency())) continue;
@@ -239,7 +251,7 @@ u8 ChunkConnectivitySet::FloodFill(const World& world, const Chunk& chunk, Visit
 
     ++queue_index;
 
-    u32 bid = chunk.blocks[y][z][x];
+    u32 bid = chunk.GetBlock(x, y, z);
     BlockModel& model = world.block_registry.states[bid].model;
 
     if (model.is_cube && !model.HasTransparency()) continue;
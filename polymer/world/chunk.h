@@ -8,6 +8,7 @@
 #include <polymer/render/chunk_renderer.h>
 #include <polymer/render/render.h>
 #include <polymer/types.h>
+#include <polymer/world/chunk_storage.h>
 #include <stdio.h>
 
 namespace polymer {
@@ -20,13 +21,6 @@ struct ChunkCoord {
   s32 z;
 };
 
-struct Chunk {
-  u32 blocks[16][16][16];
-
-  // The bottom 4 bits contain the skylight data and the upper 4 bits contain the block
-  u8 lightmap[16][16][16];
-};
-
 struct ChunkSectionInfo {
   u32 loaded : 1;
   u32 dirty_connectivity_set : 24;
@@ -35,6 +29,13 @@ struct ChunkSectionInfo {
   u32 dirty_mesh_set : 24;
   u32 padding_mesh : 8;
 
+  // Sections that have been submitted to the mesh pipeline and haven't had their result applied yet.
+  u32 meshing_set : 24;
+  u32 padding_meshing : 8;
+
+  // Changes every time the column is loaded or unloaded so results meshed from an old column can be dropped.
+  u32 generation;
+
   u32 bitmask;
   s32 x;
   s32 z;
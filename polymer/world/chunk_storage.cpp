@@ -0,0 +1,368 @@
+#include <polymer/world/chunk_storage.h>
+
+#include <polymer/world/paletted_container.h>
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace polymer {
+namespace world {
+
+void ChunkBlockData::Build(const PalettedContainer& container, u32* scratch) {
+  if (container.IsSingleValue()) {
+    type = BlockStorageType::Single;
+    palette_count = 1;
+    palette[0] = container.GetSingleValue();
+    return;
+  }
+
+  if (container.indirect) {
+    // The network palette is kept as is, so the indices don't need to be remapped.
+    size_t index_count = (size_t)1 << container.bits_per_entry;
+
+    container.UnpackIndices(scratch, kChunkBlockCount);
+
+    palette_count = (u16)container.palette_length;
+    memcpy(palette, container.palette, index_count * sizeof(u32));
+    memset(palette + index_count, 0, (polymer_array_count(palette) - index_count) * sizeof(u32));
+
+    if (index_count <= Chunk::kInlinePaletteSize) {
+      type = BlockStorageType::Index4;
+
+      for (size_t i = 0; i < kChunkBlockCount / 2; ++i) {
+        indices4[i] = (u8)(scratch[i * 2] | (scratch[i * 2 + 1] << 4));
+      }
+    } else {
+      type = BlockStorageType::Index8;
+
+      for (size_t i = 0; i < kChunkBlockCount; ++i) {
+        indices8[i] = (u8)scratch[i];
+      }
+    }
+
+    return;
+  }
+
+  container.Unpack(scratch, kChunkBlockCount);
+
+  type = BlockStorageType::Direct16;
+  palette_count = 0;
+
+  for (size_t i = 0; i < kChunkBlockCount; ++i) {
+    ids16[i] = scratch[i] <= 0xFFFF ? (u16)scratch[i] : 0;
+  }
+}
+
+bool ChunkLight::Load(ChunkStorageAllocator& allocator, const u8* data) {
+  bool dark = true;
+  bool bright = true;
+
+  for (size_t i = 0; i < sizeof(LightNibbles) && (dark || bright); i += sizeof(u64)) {
+    u64 value;
+    memcpy(&value, data + i, sizeof(value));
+
+    dark = dark && value == 0;
+    bright = bright && value == ~0ULL;
+  }
+
+  if (dark || bright) {
+    LightStorageType new_type = bright ? LightStorageType::Bright : LightStorageType::Dark;
+    bool changed = type != new_type;
+
+    Clear(allocator);
+    type = new_type;
+    return changed;
+  }
+
+  if (type == LightStorageType::Nibbles && memcmp(nibbles->data, data, sizeof(nibbles->data)) == 0) {
+    return false;
+  }
+
+  if (!nibbles) {
+    nibbles = allocator.light_pool.Allocate();
+
+    if (!nibbles) {
+      bool changed = type != LightStorageType::Dark;
+
+      type = LightStorageType::Dark;
+      return changed;
+    }
+  }
+
+  memcpy(nibbles->data, data, sizeof(nibbles->data));
+  type = LightStorageType::Nibbles;
+
+  return true;
+}
+
+bool ChunkLight::Clear(ChunkStorageAllocator& allocator) {
+  bool changed = type != LightStorageType::Dark;
+
+  if (nibbles) {
+    allocator.light_pool.Free(nibbles);
+    nibbles = nullptr;
+  }
+
+  type = LightStorageType::Dark;
+
+  return changed;
+}
+
+bool ChunkLight::Set(ChunkStorageAllocator& allocator, size_t index, u8 value) {
+  if (type != LightStorageType::Nibbles) {
+    bool bright = type == LightStorageType::Bright;
+
+    if (value == (bright ? 15 : 0)) return true;
+
+    nibbles = allocator.light_pool.Allocate();
+    if (!nibbles) return false;
+
+    memset(nibbles->data, bright ? 0xFF : 0x00, sizeof(nibbles->data));
+    type = LightStorageType::Nibbles;
+  }
+
+  u8 shift = (index & 1) * 4;
+  u8* data = nibbles->data + (index >> 1);
+
+  *data = (*data & ~(0x0F << shift)) | ((value & 0x0F) << shift);
+
+  return true;
+}
+
+void Chunk::GetBlockRow(size_t y, size_t z, u32* out) const {
+  size_t start = GetChunkBlockIndex(0, y, z);
+
+  switch (block_type) {
+  case BlockStorageType::Single: {
+    for (size_t i = 0; i < 16; ++i) {
+      out[i] = palette[0];
+    }
+  } break;
+  case BlockStorageType::Index4: {
+    const u8* indices = indices4->indices + start / 2;
+
+    for (size_t i = 0; i < 8; ++i) {
+      out[i * 2] = palette[indices[i] & 0x0F];
+      out[i * 2 + 1] = palette[indices[i] >> 4];
+    }
+  } break;
+  case BlockStorageType::Index8: {
+    const u8* indices = indices8->indices + start;
+
+    for (size_t i = 0; i < 16; ++i) {
+      out[i] = indices8->palette[indices[i]];
+    }
+  } break;
+  case BlockStorageType::Direct16: {
+    const u16* ids = ids16->ids + start;
+
+    for (size_t i = 0; i < 16; ++i) {
+      out[i] = ids[i];
+    }
+  } break;
+  }
+}
+
+// Uniform light is expanded to the same packed layout as the nibble arrays, so every row is merged the same way.
+static inline void LoadLightRow(const ChunkLight& light, size_t start, u8* out) {
+  if (light.type == LightStorageType::Nibbles) {
+    memcpy(out, light.nibbles->data + start / 2, 8);
+    return;
+  }
+
+  memset(out, light.type == LightStorageType::Bright ? 0xFF : 0x00, 8);
+}
+
+void Chunk::GetLightRow(size_t y, size_t z, u8* out) const {
+  size_t start = GetChunkBlockIndex(0, y, z);
+
+  u8 sky[8];
+  u8 block[8];
+
+  LoadLightRow(skylight, start, sky);
+  LoadLightRow(blocklight, start, block);
+
+#if defined(__x86_64__) || defined(_M_X64)
+  // Even blocks take the low nibbles and odd blocks take the high nibbles, so both are built with one mask and
+  // interleaved. The 16 bit shifts are safe because the mask removes anything shifted across a byte.
+  __m128i low_mask = _mm_set1_epi8(0x0F);
+  __m128i sky_nibbles = _mm_loadl_epi64((const __m128i*)sky);
+  __m128i block_nibbles = _mm_loadl_epi64((const __m128i*)block);
+
+  __m128i even = _mm_or_si128(_mm_and_si128(sky_nibbles, low_mask),
+                              _mm_slli_epi16(_mm_and_si128(block_nibbles, low_mask), 4));
+  __m128i odd = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(sky_nibbles, 4), low_mask),
+                             _mm_andnot_si128(low_mask, block_nibbles));
+
+  _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(even, odd));
+#else
+  for (size_t i = 0; i < 8; ++i) {
+    out[i * 2] = (sky[i] & 0x0F) | (block[i] << 4);
+    out[i * 2 + 1] = (sky[i] >> 4) | (block[i] & 0xF0);
+  }
+#endif
+}
+
+void Chunk::Load(ChunkStorageAllocator& allocator, const ChunkBlockData& data) {
+  ReleaseBlocks(allocator);
+
+  switch (data.type) {
+  case BlockStorageType::Single: {
+    palette[0] = data.palette[0];
+  } break;
+  case BlockStorageType::Index4: {
+    indices4 = allocator.indices4_pool.Allocate();
+    if (!indices4) return;
+
+    memcpy(indices4->indices, data.indices4, sizeof(indices4->indices));
+    memcpy(palette, data.palette, sizeof(palette));
+  } break;
+  case BlockStorageType::Index8: {
+    indices8 = allocator.indices8_pool.Allocate();
+    if (!indices8) return;
+
+    memcpy(indices8->indices, data.indices8, sizeof(indices8->indices));
+    memcpy(indices8->palette, data.palette, sizeof(indices8->palette));
+  } break;
+  case BlockStorageType::Direct16: {
+    ids16 = allocator.ids16_pool.Allocate();
+    if (!ids16) return;
+
+    memcpy(ids16->ids, data.ids16, sizeof(ids16->ids));
+  } break;
+  }
+
+  block_type = data.type;
+  palette_count = data.palette_count;
+}
+
+void Chunk::Fill(ChunkStorageAllocator& allocator, u32 bid) {
+  ReleaseBlocks(allocator);
+
+  palette[0] = bid;
+}
+
+static inline size_t FindPaletteIndex(const u32* palette, size_t palette_count, u32 bid) {
+  for (size_t i = 0; i < palette_count; ++i) {
+    if (palette[i] == bid) return i;
+  }
+
+  return palette_count;
+}
+
+void Chunk::SetBlock(ChunkStorageAllocator& allocator, size_t index, u32 bid) {
+  if (block_type == BlockStorageType::Single) {
+    if (palette[0] == bid) return;
+
+    // The pool clears new storage, so every index starts out pointing at the old single value.
+    indices4 = allocator.indices4_pool.Allocate();
+    if (!indices4) return;
+
+    block_type = BlockStorageType::Index4;
+    palette_count = 1;
+  }
+
+  if (block_type == BlockStorageType::Index4) {
+    size_t palette_index = FindPaletteIndex(palette, palette_count, bid);
+
+    if (palette_index == palette_count && palette_count < kInlinePaletteSize) {
+      palette[palette_count++] = bid;
+    }
+
+    if (palette_index < palette_count) {
+      u8* pair = indices4->indices + (index >> 1);
+      u8 shift = (index & 1) * 4;
+
+      *pair = (u8)((*pair & ~(0x0F << shift)) | (palette_index << shift));
+      return;
+    }
+
+    if (!GrowIndices8(allocator)) return;
+  }
+
+  if (block_type == BlockStorageType::Index8) {
+    size_t palette_index = FindPaletteIndex(indices8->palette, palette_count, bid);
+
+    if (palette_index == palette_count && palette_count < polymer_array_count(indices8->palette)) {
+      indices8->palette[palette_count++] = bid;
+    }
+
+    if (palette_index < palette_count) {
+      indices8->indices[index] = (u8)palette_index;
+      return;
+    }
+
+    if (!GrowDirect16(allocator)) return;
+  }
+
+  ids16->ids[index] = bid <= 0xFFFF ? (u16)bid : 0;
+}
+
+bool Chunk::GrowIndices8(ChunkStorageAllocator& allocator) {
+  BlockIndices8* grown = allocator.indices8_pool.Allocate();
+  if (!grown) return false;
+
+  for (size_t i = 0; i < kChunkBlockCount; ++i) {
+    grown->indices[i] = (indices4->indices[i >> 1] >> ((i & 1) * 4)) & 0x0F;
+  }
+
+  memcpy(grown->palette, palette, sizeof(palette));
+
+  allocator.indices4_pool.Free(indices4);
+
+  indices8 = grown;
+  block_type = BlockStorageType::Index8;
+
+  return true;
+}
+
+bool Chunk::GrowDirect16(ChunkStorageAllocator& allocator) {
+  BlockIds16* grown = allocator.ids16_pool.Allocate();
+  if (!grown) return false;
+
+  for (size_t i = 0; i < kChunkBlockCount; ++i) {
+    grown->ids[i] = (u16)indices8->palette[indices8->indices[i]];
+  }
+
+  allocator.indices8_pool.Free(indices8);
+
+  ids16 = grown;
+  block_type = BlockStorageType::Direct16;
+  palette_count = 0;
+
+  return true;
+}
+
+void Chunk::ReleaseBlocks(ChunkStorageAllocator& allocator) {
+  switch (block_type) {
+  case BlockStorageType::Single: {
+  } break;
+  case BlockStorageType::Index4: {
+    allocator.indices4_pool.Free(indices4);
+  } break;
+  case BlockStorageType::Index8: {
+    allocator.indices8_pool.Free(indices8);
+  } break;
+  case BlockStorageType::Direct16: {
+    allocator.ids16_pool.Free(ids16);
+  } break;
+  }
+
+  block_type = BlockStorageType::Single;
+  palette_count = 1;
+  palette[0] = 0;
+  indices4 = nullptr;
+}
+
+void Chunk::Release(ChunkStorageAllocator& allocator) {
+  ReleaseBlocks(allocator);
+
+  skylight.Clear(allocator);
+  blocklight.Clear(allocator);
+}
+
+} // namespace world
+} // namespace polymer
@@ -0,0 +1,163 @@
+#ifndef POLYMER_WORLD_CHUNK_STORAGE_H_
+#define POLYMER_WORLD_CHUNK_STORAGE_H_
+
+#include <polymer/memory.h>
+#include <polymer/types.h>
+
+namespace polymer {
+namespace world {
+
+struct PalettedContainer;
+
+constexpr size_t kChunkBlockCount = 16 * 16 * 16;
+
+// Blocks in a chunk are ordered by y, then z, then x, which matches the network order.
+inline constexpr size_t GetChunkBlockIndex(size_t x, size_t y, size_t z) {
+  return y * 16 * 16 + z * 16 + x;
+}
+
+// The zero values are the defaults for a freshly allocated chunk, which is all air and completely dark.
+enum class BlockStorageType : u8 { Single, Index4, Index8, Direct16 };
+enum class LightStorageType : u8 { Dark, Bright, Nibbles };
+
+struct BlockIndices4 {
+  // Two indices per byte with the even index in the low nibble.
+  u8 indices[kChunkBlockCount / 2];
+};
+
+struct BlockIndices8 {
+  u8 indices[kChunkBlockCount];
+  u32 palette[256];
+};
+
+// Sections with more than 256 states store the block state ids directly.
+struct BlockIds16 {
+  u16 ids[kChunkBlockCount];
+};
+
+// Same layout as the light arrays that the server sends.
+struct LightNibbles {
+  u8 data[kChunkBlockCount / 2];
+};
+
+// Pools for the variable sized parts of chunk storage. These are only used from the game thread.
+struct ChunkStorageAllocator {
+  MemoryPool<BlockIndices4> indices4_pool;
+  MemoryPool<BlockIndices8> indices8_pool;
+  MemoryPool<BlockIds16> ids16_pool;
+  MemoryPool<LightNibbles> light_pool;
+};
+
+// Block data packed the same way that chunks store it. This is built by the decode workers, so the game thread only
+// has to copy it into pooled storage.
+struct ChunkBlockData {
+  BlockStorageType type;
+  u16 palette_count;
+  u32 palette[256];
+
+  union {
+    u8 indices4[kChunkBlockCount / 2];
+    u8 indices8[kChunkBlockCount];
+    u16 ids16[kChunkBlockCount];
+  };
+
+  // The scratch buffer needs room for kChunkBlockCount values.
+  void Build(const PalettedContainer& container, u32* scratch);
+};
+
+struct ChunkLight {
+  LightStorageType type;
+  LightNibbles* nibbles;
+
+  inline u8 Get(size_t index) const {
+    if (type == LightStorageType::Nibbles) {
+      return (nibbles->data[index >> 1] >> ((index & 1) * 4)) & 0x0F;
+    }
+
+    return type == LightStorageType::Bright ? 15 : 0;
+  }
+
+  // Loads a 2048 byte light array in the network format. Uniform arrays are stored as flags.
+  // Returns true if any light value changed.
+  bool Load(ChunkStorageAllocator& allocator, const u8* data);
+  // Returns true if any light value changed.
+  bool Clear(ChunkStorageAllocator& allocator);
+  // Changes a single value, expanding uniform light into nibbles if needed. Returns false if there wasn't any storage
+  // left to expand into.
+  bool Set(ChunkStorageAllocator& allocator, size_t index, u8 value);
+};
+
+// A 16x16x16 section of blocks. Blocks are stored as a single value, as 4 or 8 bit indices into a palette, or as 16
+// bit block state ids once a section has too many states for a palette. Chunks only ever grow into wider storage
+// until they are reloaded.
+struct Chunk {
+  constexpr static size_t kInlinePaletteSize = 16;
+
+  BlockStorageType block_type;
+  u16 palette_count;
+
+  // Used for single value and 4 bit chunks. The 8 bit palette lives with its indices.
+  u32 palette[kInlinePaletteSize];
+
+  union {
+    BlockIndices4* indices4;
+    BlockIndices8* indices8;
+    BlockIds16* ids16;
+  };
+
+  ChunkLight skylight;
+  ChunkLight blocklight;
+
+  inline u32 GetBlock(size_t index) const {
+    switch (block_type) {
+    case BlockStorageType::Single:
+      return palette[0];
+    case BlockStorageType::Index4:
+      return palette[(indices4->indices[index >> 1] >> ((index & 1) * 4)) & 0x0F];
+    case BlockStorageType::Index8:
+      return indices8->palette[indices8->indices[index]];
+    case BlockStorageType::Direct16:
+      return ids16->ids[index];
+    }
+
+    return 0;
+  }
+
+  inline u32 GetBlock(size_t x, size_t y, size_t z) const {
+    return GetBlock(GetChunkBlockIndex(x, y, z));
+  }
+
+  // Packed with the skylight in the bottom 4 bits and the block light in the upper 4 bits.
+  inline u8 GetLight(size_t index) const {
+    return skylight.Get(index) | (blocklight.Get(index) << 4);
+  }
+
+  inline u8 GetLight(size_t x, size_t y, size_t z) const {
+    return GetLight(GetChunkBlockIndex(x, y, z));
+  }
+
+  inline bool IsSingleValue() const {
+    return block_type == BlockStorageType::Single;
+  }
+
+  // Unpacks the 16 blocks or lights along x for a row.
+  void GetBlockRow(size_t y, size_t z, u32* out) const;
+  void GetLightRow(size_t y, size_t z, u8* out) const;
+
+  void Load(ChunkStorageAllocator& allocator, const ChunkBlockData& data);
+  void Fill(ChunkStorageAllocator& allocator, u32 bid);
+  void SetBlock(ChunkStorageAllocator& allocator, size_t index, u32 bid);
+
+  // Returns all storage to the allocator. The chunk itself still needs to be freed by the owner.
+  void Release(ChunkStorageAllocator& allocator);
+
+private:
+  void ReleaseBlocks(ChunkStorageAllocator& allocator);
+  bool GrowIndices8(ChunkStorageAllocator& allocator);
+  bool GrowDirect16(ChunkStorageAllocator& allocator);
+};
+
+} // namespace world
+} // namespace polymer
+
+#endif
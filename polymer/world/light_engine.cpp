@@ -0,0 +1,409 @@
+#include <polymer/world/light_engine.h>
+
+#include <polymer/world/block.h>
+#include <polymer/world/world.h>
+
+#include <string.h>
+
+namespace polymer {
+namespace world {
+
+enum EmitterFlags {
+  EmitterFlag_Always = 0,
+  // Only emits in states with lit=true.
+  EmitterFlag_Lit = 1,
+  // Only emits in states with berries=true.
+  EmitterFlag_Berries = 2,
+};
+
+struct LightEmitter {
+  const char* name;
+  u8 level;
+  u8 flags;
+};
+
+// The block assets don't include luminance, so the common emitters are listed with their vanilla levels.
+static const LightEmitter kLightEmitters[] = {
+    {"minecraft:beacon", 15, EmitterFlag_Always},
+    {"minecraft:conduit", 15, EmitterFlag_Always},
+    {"minecraft:end_gateway", 15, EmitterFlag_Always},
+    {"minecraft:end_portal", 15, EmitterFlag_Always},
+    {"minecraft:fire", 15, EmitterFlag_Always},
+    {"minecraft:glowstone", 15, EmitterFlag_Always},
+    {"minecraft:jack_o_lantern", 15, EmitterFlag_Always},
+    {"minecraft:lantern", 15, EmitterFlag_Always},
+    {"minecraft:lava", 15, EmitterFlag_Always},
+    {"minecraft:lava_cauldron", 15, EmitterFlag_Always},
+    {"minecraft:ochre_froglight", 15, EmitterFlag_Always},
+    {"minecraft:pearlescent_froglight", 15, EmitterFlag_Always},
+    {"minecraft:sea_lantern", 15, EmitterFlag_Always},
+    {"minecraft:shroomlight", 15, EmitterFlag_Always},
+    {"minecraft:verdant_froglight", 15, EmitterFlag_Always},
+    {"minecraft:campfire", 15, EmitterFlag_Lit},
+    {"minecraft:redstone_lamp", 15, EmitterFlag_Lit},
+    {"minecraft:end_rod", 14, EmitterFlag_Always},
+    {"minecraft:torch", 14, EmitterFlag_Always},
+    {"minecraft:wall_torch", 14, EmitterFlag_Always},
+    {"minecraft:cave_vines", 14, EmitterFlag_Berries},
+    {"minecraft:cave_vines_plant", 14, EmitterFlag_Berries},
+    {"minecraft:blast_furnace", 13, EmitterFlag_Lit},
+    {"minecraft:furnace", 13, EmitterFlag_Lit},
+    {"minecraft:smoker", 13, EmitterFlag_Lit},
+    {"minecraft:nether_portal", 11, EmitterFlag_Always},
+    {"minecraft:crying_obsidian", 10, EmitterFlag_Always},
+    {"minecraft:soul_fire", 10, EmitterFlag_Always},
+    {"minecraft:soul_lantern", 10, EmitterFlag_Always},
+    {"minecraft:soul_torch", 10, EmitterFlag_Always},
+    {"minecraft:soul_wall_torch", 10, EmitterFlag_Always},
+    {"minecraft:soul_campfire", 10, EmitterFlag_Lit},
+    {"minecraft:deepslate_redstone_ore", 9, EmitterFlag_Lit},
+    {"minecraft:redstone_ore", 9, EmitterFlag_Lit},
+    {"minecraft:enchanting_table", 7, EmitterFlag_Always},
+    {"minecraft:ender_chest", 7, EmitterFlag_Always},
+    {"minecraft:glow_lichen", 7, EmitterFlag_Always},
+    {"minecraft:redstone_torch", 7, EmitterFlag_Lit},
+    {"minecraft:redstone_wall_torch", 7, EmitterFlag_Lit},
+    {"minecraft:amethyst_cluster", 5, EmitterFlag_Always},
+    {"minecraft:large_amethyst_bud", 4, EmitterFlag_Always},
+    {"minecraft:magma_block", 3, EmitterFlag_Always},
+    {"minecraft:medium_amethyst_bud", 2, EmitterFlag_Always},
+    {"minecraft:brewing_stand", 1, EmitterFlag_Always},
+    {"minecraft:brown_mushroom", 1, EmitterFlag_Always},
+    {"minecraft:dragon_egg", 1, EmitterFlag_Always},
+    {"minecraft:end_portal_frame", 1, EmitterFlag_Always},
+    {"minecraft:sculk_sensor", 1, EmitterFlag_Always},
+    {"minecraft:small_amethyst_bud", 1, EmitterFlag_Always},
+};
+
+// Water slows light down like leaves do.
+static const char* kDampeningBlocks[] = {"minecraft:water", "minecraft:bubble_column"};
+
+enum class LightType { Sky, Block };
+
+struct LightDirection {
+  s32 x;
+  s32 y;
+  s32 z;
+};
+
+static const LightDirection kLightDirections[] = {
+    {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0},
+};
+
+// Index of the downward direction, which sky light travels without losing any level.
+constexpr size_t kDownDirection = 0;
+
+void LightEngine::Initialize(MemoryArena& perm_arena, BlockRegistry& registry) {
+  state_count = registry.state_count;
+
+  emission = memory_arena_push_type_count(&perm_arena, u8, state_count);
+  opacity = memory_arena_push_type_count(&perm_arena, u8, state_count);
+
+  for (size_t bid = 0; bid < state_count; ++bid) {
+    BlockModel& model = registry.states[bid].model;
+
+    emission[bid] = 0;
+
+    // Full cubes without any transparent faces block light just like they block visibility.
+    if (model.is_cube && !model.HasTransparency()) {
+      opacity[bid] = 15;
+    } else if (model.has_leaves) {
+      opacity[bid] = 1;
+    } else {
+      opacity[bid] = 0;
+    }
+  }
+
+  for (size_t i = 0; i < polymer_array_count(kLightEmitters); ++i) {
+    const LightEmitter& emitter = kLightEmitters[i];
+    BlockIdRange* range = registry.name_map.Find(String((char*)emitter.name, strlen(emitter.name)));
+
+    if (!range) continue;
+
+    for (u32 bid = range->base; bid < range->base + range->count && bid < state_count; ++bid) {
+      const String& properties = registry.properties[bid];
+
+      if ((emitter.flags & EmitterFlag_Lit) && !poly_contains(properties, POLY_STR("lit=true"))) continue;
+      if ((emitter.flags & EmitterFlag_Berries) && !poly_contains(properties, POLY_STR("berries=true"))) continue;
+
+      emission[bid] = emitter.level;
+    }
+  }
+
+  for (size_t i = 0; i < polymer_array_count(kDampeningBlocks); ++i) {
+    BlockIdRange* range = registry.name_map.Find(String((char*)kDampeningBlocks[i], strlen(kDampeningBlocks[i])));
+
+    if (!range) continue;
+
+    for (u32 bid = range->base; bid < range->base + range->count && bid < state_count; ++bid) {
+      opacity[bid] = 1;
+    }
+  }
+
+  removal_queue.nodes = memory_arena_push_type_count(&perm_arena, LightNode, kQueueSize);
+  removal_queue.read_index = removal_queue.write_index = 0;
+
+  add_queue.nodes = memory_arena_push_type_count(&perm_arena, LightNode, kQueueSize);
+  add_queue.read_index = add_queue.write_index = 0;
+}
+
+void LightEngine::OnBlockChange(s32 x, s32 y, s32 z, u32 old_bid, u32 new_bid) {
+  if (!emission || old_bid >= state_count || new_bid >= state_count) return;
+
+  // Most edits, like redstone power changes, don't change the light at all.
+  if (emission[old_bid] == emission[new_bid] && opacity[old_bid] == opacity[new_bid]) return;
+
+  // The server's light update still arrives for anything that doesn't fit.
+  if (pending_edit_count >= kMaxPendingEdits) return;
+
+  pending_edits[pending_edit_count++] = {x, y, z};
+}
+
+// Resolves block positions to chunks and records which sections had their light changed.
+struct LightAccess {
+  constexpr static size_t kMaxChangedColumns = 32;
+
+  struct ChangedColumn {
+    s32 chunk_x;
+    s32 chunk_z;
+    u32 changed_set;
+  };
+
+  World& world;
+  LightType type;
+  bool has_skylight;
+
+  ChangedColumn changed_columns[kMaxChangedColumns];
+  size_t changed_column_count = 0;
+
+  LightAccess(World& world, bool has_skylight) : world(world), type(LightType::Block), has_skylight(has_skylight) {}
+
+  // Returns false if the position isn't in a loaded column. The chunk is null for sections without any blocks.
+  inline bool GetChunk(s32 x, s32 y, s32 z, Chunk** chunk, size_t* index) {
+    s32 chunk_x = x >> 4;
+    s32 chunk_z = z >> 4;
+    s32 section_y = (y >> 4) + 4;
+
+    if (section_y < 0 || section_y >= (s32)kChunkColumnCount) return false;
+
+    u32 x_index = GetChunkCacheIndex(chunk_x);
+    u32 z_index = GetChunkCacheIndex(chunk_z);
+
+    ChunkSectionInfo* info = &world.chunk_infos[z_index][x_index];
+
+    if (!info->loaded || info->x != chunk_x || info->z != chunk_z) return false;
+
+    *chunk = world.chunks[z_index][x_index].chunks[section_y];
+    *index = GetChunkBlockIndex(x & 15, y & 15, z & 15);
+
+    return true;
+  }
+
+  inline u32 GetBlock(Chunk* chunk, size_t index) const {
+    return chunk ? chunk->GetBlock(index) : 0;
+  }
+
+  // Sections without blocks aren't stored, so they are treated as open sky like the mesher does.
+  inline u8 GetLight(Chunk* chunk, size_t index) const {
+    if (!chunk) return (type == LightType::Sky && has_skylight) ? 15 : 0;
+
+    return type == LightType::Sky ? chunk->skylight.Get(index) : chunk->blocklight.Get(index);
+  }
+
+  // Returns false if the light couldn't be stored, which stops it from spreading any further.
+  inline bool SetLight(Chunk* chunk, size_t index, s32 x, s32 y, s32 z, u8 value) {
+    if (!chunk) return false;
+
+    ChunkLight& light = type == LightType::Sky ? chunk->skylight : chunk->blocklight;
+
+    if (!light.Set(world.chunk_storage, index, value)) return false;
+
+    MarkChanged(x >> 4, z >> 4, 1 << ((y >> 4) + 4));
+    return true;
+  }
+
+  inline void MarkChanged(s32 chunk_x, s32 chunk_z, u32 section_bit) {
+    // Light spreads out from a single edit, so the same column is usually hit repeatedly.
+    for (size_t i = changed_column_count; i > 0; --i) {
+      ChangedColumn* column = changed_columns + i - 1;
+
+      if (column->chunk_x == chunk_x && column->chunk_z == chunk_z) {
+        column->changed_set |= section_bit;
+        return;
+      }
+    }
+
+    if (changed_column_count >= kMaxChangedColumns) {
+      Flush();
+    }
+
+    changed_columns[changed_column_count++] = {chunk_x, chunk_z, section_bit};
+  }
+
+  void Flush() {
+    for (size_t i = 0; i < changed_column_count; ++i) {
+      ChangedColumn* column = changed_columns + i;
+
+      world.OnLightChange(column->chunk_x, column->chunk_z, column->changed_set);
+    }
+
+    changed_column_count = 0;
+  }
+};
+
+// Clears light that came from a removed source or through a newly blocked position. Neighbors that are at least as
+// bright as the light being removed have their own source, so they are queued to spread back in afterwards.
+static void RunRemoval(LightEngine& engine, LightAccess& access) {
+  while (!engine.removal_queue.IsEmpty()) {
+    LightEngine::LightNode node = engine.removal_queue.Pop();
+
+    for (size_t i = 0; i < polymer_array_count(kLightDirections); ++i) {
+      const LightDirection& direction = kLightDirections[i];
+
+      s32 x = node.x + direction.x;
+      s32 y = node.y + direction.y;
+      s32 z = node.z + direction.z;
+
+      Chunk* chunk = nullptr;
+      size_t index = 0;
+
+      if (!access.GetChunk(x, y, z, &chunk, &index)) continue;
+
+      u8 level = access.GetLight(chunk, index);
+
+      if (level == 0) continue;
+
+      // Full sky light is carried straight down, so it's removed the whole way down the column too.
+      bool sky_column = access.type == LightType::Sky && i == kDownDirection && node.level == 15 && level == 15;
+
+      if (level < node.level || sky_column) {
+        if (!access.SetLight(chunk, index, x, y, z, 0)) continue;
+
+        engine.removal_queue.Push(x, y, z, level);
+
+        // Sources that were cleared on the way relight themselves.
+        if (access.type == LightType::Block) {
+          u8 emitted = engine.emission[access.GetBlock(chunk, index)];
+
+          if (emitted > 0 && access.SetLight(chunk, index, x, y, z, emitted)) {
+            engine.add_queue.Push(x, y, z, emitted);
+          }
+        }
+      } else {
+        engine.add_queue.Push(x, y, z, level);
+      }
+    }
+  }
+}
+
+static void RunPropagation(LightEngine& engine, LightAccess& access) {
+  while (!engine.add_queue.IsEmpty()) {
+    LightEngine::LightNode node = engine.add_queue.Pop();
+
+    Chunk* chunk = nullptr;
+    size_t index = 0;
+
+    if (!access.GetChunk(node.x, node.y, node.z, &chunk, &index)) continue;
+
+    // The light could have been lowered since the node was queued.
+    u8 level = access.GetLight(chunk, index);
+
+    if (level <= 1) continue;
+
+    for (size_t i = 0; i < polymer_array_count(kLightDirections); ++i) {
+      const LightDirection& direction = kLightDirections[i];
+
+      s32 x = node.x + direction.x;
+      s32 y = node.y + direction.y;
+      s32 z = node.z + direction.z;
+
+      Chunk* neighbor = nullptr;
+      size_t neighbor_index = 0;
+
+      if (!access.GetChunk(x, y, z, &neighbor, &neighbor_index)) continue;
+
+      u8 neighbor_opacity = engine.opacity[access.GetBlock(neighbor, neighbor_index)];
+
+      if (neighbor_opacity >= 15) continue;
+
+      u8 new_level = 0;
+
+      if (access.type == LightType::Sky && i == kDownDirection && level == 15 && neighbor_opacity == 0) {
+        new_level = 15;
+      } else {
+        u8 loss = neighbor_opacity > 1 ? neighbor_opacity : 1;
+
+        if (level <= loss) continue;
+
+        new_level = level - loss;
+      }
+
+      if (new_level <= access.GetLight(neighbor, neighbor_index)) continue;
+
+      if (access.SetLight(neighbor, neighbor_index, x, y, z, new_level)) {
+        engine.add_queue.Push(x, y, z, new_level);
+      }
+    }
+  }
+}
+
+static void RelightEdit(LightEngine& engine, LightAccess& access, const LightEngine::LightEdit& edit) {
+  Chunk* chunk = nullptr;
+  size_t index = 0;
+
+  if (!access.GetChunk(edit.x, edit.y, edit.z, &chunk, &index)) return;
+
+  u8 old_level = access.GetLight(chunk, index);
+
+  if (old_level > 0 && access.SetLight(chunk, index, edit.x, edit.y, edit.z, 0)) {
+    engine.removal_queue.Push(edit.x, edit.y, edit.z, old_level);
+  }
+
+  RunRemoval(engine, access);
+
+  u32 new_bid = access.GetBlock(chunk, index);
+
+  if (access.type == LightType::Block) {
+    u8 emitted = engine.emission[new_bid];
+
+    if (emitted > 0 && access.SetLight(chunk, index, edit.x, edit.y, edit.z, emitted)) {
+      engine.add_queue.Push(edit.x, edit.y, edit.z, emitted);
+    }
+  }
+
+  // Light from the neighbors can flow into the position now that it's no longer blocked.
+  if (engine.opacity[new_bid] < 15) {
+    for (size_t i = 0; i < polymer_array_count(kLightDirections); ++i) {
+      const LightDirection& direction = kLightDirections[i];
+
+      engine.add_queue.Push(edit.x + direction.x, edit.y + direction.y, edit.z + direction.z, 0);
+    }
+  }
+
+  RunPropagation(engine, access);
+}
+
+void LightEngine::Update(World& world, bool has_skylight) {
+  if (pending_edit_count == 0) return;
+
+  LightAccess access(world, has_skylight);
+
+  for (size_t i = 0; i < pending_edit_count; ++i) {
+    const LightEdit& edit = pending_edits[i];
+
+    access.type = LightType::Block;
+    RelightEdit(*this, access, edit);
+
+    if (has_skylight) {
+      access.type = LightType::Sky;
+      RelightEdit(*this, access, edit);
+    }
+  }
+
+  access.Flush();
+
+  pending_edit_count = 0;
+}
+
+} // namespace world
+} // namespace polymer
@@ -0,0 +1,81 @@
+#ifndef POLYMER_WORLD_LIGHT_ENGINE_H_
+#define POLYMER_WORLD_LIGHT_ENGINE_H_
+
+#include <polymer/memory.h>
+#include <polymer/types.h>
+
+namespace polymer {
+namespace world {
+
+struct BlockRegistry;
+struct World;
+
+// Predicts block and sky light after block edits instead of waiting for the server's UpdateLight. Light spreads with
+// the vanilla rules, so the server's update usually matches and doesn't cause another remesh.
+//
+// Edits are queued as they are applied and relit together when the world flushes its block edits. Both queues have a
+// fixed size, so one batch can only do a bounded amount of work. Anything that doesn't fit is left for the server.
+struct LightEngine {
+  constexpr static size_t kMaxPendingEdits = 1024;
+  constexpr static size_t kQueueSize = 32768;
+
+  struct LightEdit {
+    s32 x;
+    s32 y;
+    s32 z;
+  };
+
+  struct LightNode {
+    s32 x;
+    s32 y;
+    s32 z;
+    u32 level;
+  };
+
+  // Breadth first queue of light nodes. Pushing into a full queue drops the node.
+  struct NodeQueue {
+    LightNode* nodes;
+    size_t read_index;
+    size_t write_index;
+
+    inline bool IsEmpty() const {
+      return read_index == write_index;
+    }
+
+    inline bool Push(s32 x, s32 y, s32 z, u32 level) {
+      if (write_index - read_index >= kQueueSize) return false;
+
+      nodes[write_index++ % kQueueSize] = {x, y, z, level};
+      return true;
+    }
+
+    inline LightNode Pop() {
+      return nodes[read_index++ % kQueueSize];
+    }
+  };
+
+  // Light emitted by each block state.
+  u8* emission = nullptr;
+  // How much light is lost passing through each block state. 15 blocks light completely.
+  u8* opacity = nullptr;
+  size_t state_count = 0;
+
+  LightEdit pending_edits[kMaxPendingEdits];
+  size_t pending_edit_count = 0;
+
+  NodeQueue removal_queue;
+  NodeQueue add_queue;
+
+  void Initialize(MemoryArena& perm_arena, BlockRegistry& registry);
+
+  // Queues an edit if the new block changes how light is emitted or blocked at that position.
+  void OnBlockChange(s32 x, s32 y, s32 z, u32 old_bid, u32 new_bid);
+
+  // Relights every queued edit and queues the sections whose light changed for rebuilding.
+  void Update(World& world, bool has_skylight);
+};
+
+} // namespace world
+} // namespace polymer
+
+#endif
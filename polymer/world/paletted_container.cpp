@@ -0,0 +1,334 @@
+#include <polymer/world/paletted_container.h>
+
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define POLYMER_X64_KERNELS 1
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// The vector kernels are compiled for AVX2 and BMI2 on their own and only selected if the cpu supports them, so the
+// rest of the build doesn't need those instruction sets.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define POLYMER_TARGET_AVX2
+#else
+#define POLYMER_TARGET_AVX2 __attribute__((target("avx2,bmi2")))
+#endif
+#endif
+
+namespace polymer {
+namespace world {
+
+using UnpackFunction = void (*)(const u8* data, size_t long_count, u32* out, size_t count);
+using MapFunction = void (*)(u32* ids, size_t count, const u32* palette);
+
+constexpr size_t kMaxBitsPerEntry = 32;
+
+// Entries never span two longs, so each long holds 64 / bits entries with the leftover high bits unused.
+// This finishes the partially used long at the end of the data and zeroes anything the data array didn't cover.
+static void UnpackRemainder(const u8* data, size_t long_count, size_t long_index, u32 bits, u32* out, size_t count) {
+  size_t per_long = 64 / bits;
+  u64 mask = (1ULL << bits) - 1;
+  size_t index = long_index * per_long;
+
+  if (long_index < long_count) {
+    u64 value = LoadBigEndianU64(data + long_index * 8);
+
+    for (size_t j = 0; j < per_long && index < count; ++j) {
+      out[index++] = (u32)((value >> (j * bits)) & mask);
+    }
+  }
+
+  for (; index < count; ++index) {
+    out[index] = 0;
+  }
+}
+
+template <u32 kBits>
+static void UnpackIndices(const u8* data, size_t long_count, u32* out, size_t count) {
+  constexpr size_t kPerLong = 64 / kBits;
+  constexpr u64 kMask = (1ULL << kBits) - 1;
+
+  size_t full_count = count / kPerLong;
+  if (full_count > long_count) full_count = long_count;
+
+  for (size_t i = 0; i < full_count; ++i) {
+    u64 value = LoadBigEndianU64(data + i * 8);
+    u32* dest = out + i * kPerLong;
+
+    for (size_t j = 0; j < kPerLong; ++j) {
+      dest[j] = (u32)((value >> (j * kBits)) & kMask);
+    }
+  }
+
+  UnpackRemainder(data, long_count, full_count, kBits, out, count);
+}
+
+static void MapPalette(u32* ids, size_t count, const u32* palette) {
+  for (size_t i = 0; i < count; ++i) {
+    ids[i] = palette[ids[i]];
+  }
+}
+
+struct UnpackKernels {
+  // Indexed by bits per entry.
+  UnpackFunction unpack[kMaxBitsPerEntry + 1];
+  MapFunction map;
+};
+
+template <u32... kBits>
+static UnpackKernels CreateScalarKernels(std::integer_sequence<u32, kBits...>) {
+  return UnpackKernels{{nullptr, &UnpackIndices<kBits + 1>...}, &MapPalette};
+}
+
+#ifdef POLYMER_X64_KERNELS
+
+// Deposits a group of entries into 8-bit lanes, or 16-bit lanes for wide entries, with one pdep and widens the lanes
+// to 32 bits in a vector register.
+template <u32 kBits>
+POLYMER_TARGET_AVX2 static void UnpackIndicesDeposit(const u8* data, size_t long_count, u32* out, size_t count) {
+  constexpr size_t kPerLong = 64 / kBits;
+  constexpr u64 kMask = (1ULL << kBits) - 1;
+  constexpr size_t kLaneBits = kBits <= 8 ? 8 : 16;
+  constexpr size_t kPerDeposit = 64 / kLaneBits;
+  constexpr u64 kDepositMask = kMask * (kLaneBits == 8 ? 0x0101010101010101ULL : 0x0001000100010001ULL);
+
+  size_t full_count = count / kPerLong;
+  if (full_count > long_count) full_count = long_count;
+
+  for (size_t i = 0; i < full_count; ++i) {
+    u64 value = LoadBigEndianU64(data + i * 8);
+    u32* dest = out + i * kPerLong;
+    size_t j = 0;
+
+    for (; j + kPerDeposit <= kPerLong; j += kPerDeposit) {
+      __m128i lanes = _mm_cvtsi64_si128((long long)_pdep_u64(value >> (j * kBits), kDepositMask));
+
+      if (kLaneBits == 8) {
+        _mm256_storeu_si256((__m256i*)(dest + j), _mm256_cvtepu8_epi32(lanes));
+      } else {
+        _mm_storeu_si128((__m128i*)(dest + j), _mm_cvtepu16_epi32(lanes));
+      }
+    }
+
+    for (; j < kPerLong; ++j) {
+      dest[j] = (u32)((value >> (j * kBits)) & kMask);
+    }
+  }
+
+  UnpackRemainder(data, long_count, full_count, kBits, out, count);
+}
+
+POLYMER_TARGET_AVX2 static void MapPaletteGather(u32* ids, size_t count, const u32* palette) {
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m256i indices = _mm256_loadu_si256((const __m256i*)(ids + i));
+    __m256i values = _mm256_i32gather_epi32((const int*)palette, indices, 4);
+
+    _mm256_storeu_si256((__m256i*)(ids + i), values);
+  }
+
+  for (; i < count; ++i) {
+    ids[i] = palette[ids[i]];
+  }
+}
+
+static void Cpuid(u32 leaf, u32 subleaf, u32 regs[4]) {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuidex(info, (int)leaf, (int)subleaf);
+
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = (u32)info[i];
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static bool HasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  u32 regs[4];
+
+  Cpuid(0, 0, regs);
+  if (regs[0] < 7) return false;
+
+  // The os needs to save the ymm registers on context switches.
+  Cpuid(1, 0, regs);
+  if (!(regs[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+
+  Cpuid(7, 0, regs);
+  return (regs[1] & (1 << 5)) && (regs[1] & (1 << 8));
+#else
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+#endif
+}
+
+// pdep is microcoded on AMD cpus before Zen 3 and is much slower than the scalar shifts there.
+static bool HasFastDeposit() {
+  u32 regs[4];
+
+  Cpuid(0, 0, regs);
+
+  bool amd = regs[1] == 0x68747541 && regs[3] == 0x69746e65 && regs[2] == 0x444d4163;
+  if (!amd) return true;
+
+  Cpuid(1, 0, regs);
+
+  u32 family = (regs[0] >> 8) & 0x0F;
+  if (family == 0x0F) family += (regs[0] >> 20) & 0xFF;
+
+  return family >= 0x19;
+}
+
+template <u32... kBits>
+static void SetDepositKernels(UnpackKernels& kernels, std::integer_sequence<u32, kBits...>) {
+  // Only entries of 4 bits or more are deposited. Smaller ones only show up in biome containers.
+  UnpackFunction deposit[] = {&UnpackIndicesDeposit<kBits + 4>...};
+
+  for (size_t i = 0; i < sizeof(deposit) / sizeof(*deposit); ++i) {
+    kernels.unpack[i + 4] = deposit[i];
+  }
+}
+
+#endif
+
+static UnpackKernels SelectKernels() {
+  UnpackKernels kernels = CreateScalarKernels(std::make_integer_sequence<u32, kMaxBitsPerEntry>());
+
+#ifdef POLYMER_X64_KERNELS
+  if (HasAvx2()) {
+    kernels.map = &MapPaletteGather;
+
+    if (HasFastDeposit()) {
+      SetDepositKernels(kernels, std::make_integer_sequence<u32, 13>());
+    }
+  }
+#endif
+
+  return kernels;
+}
+
+static const UnpackKernels g_kernels = SelectKernels();
+
+// Returns the inclusive range of bits per entry that use an indirect palette. Anything above it is direct.
+static inline void GetIndirectRange(PalettedContainerType type, u8* min_bits, u8* max_bits) {
+  if (type == PalettedContainerType::Blocks) {
+    *min_bits = 4;
+    *max_bits = 8;
+  } else {
+    *min_bits = 1;
+    *max_bits = 3;
+  }
+}
+
+static bool ReadDataSpan(RingBuffer& rb, const u8** data, size_t* long_count) {
+  u64 length = 0;
+
+  if (!rb.ReadVarInt(&length) || length > rb.GetReadAmount() / 8) return false;
+
+  *long_count = (size_t)length;
+  *data = length > 0 ? rb.ReadSpan(*long_count * 8) : nullptr;
+
+  return length == 0 || *data != nullptr;
+}
+
+bool PalettedContainer::Read(RingBuffer& rb, PalettedContainerType type) {
+  if (rb.GetReadAmount() < 1) return false;
+
+  u8 min_bits, max_bits;
+  GetIndirectRange(type, &min_bits, &max_bits);
+
+  bits_per_entry = rb.ReadU8();
+  indirect = bits_per_entry <= max_bits;
+  palette_length = 0;
+  data = nullptr;
+  long_count = 0;
+
+  if (bits_per_entry == 0) {
+    u64 value = 0;
+
+    if (!rb.ReadVarInt(&value)) return false;
+
+    palette[0] = (u32)value;
+    palette_length = 1;
+  } else if (indirect) {
+    if (bits_per_entry < min_bits) bits_per_entry = min_bits;
+
+    size_t index_count = (size_t)1 << bits_per_entry;
+    u64 length = 0;
+
+    if (!rb.ReadVarInt(&length) || length > index_count) return false;
+
+    palette_length = (size_t)length;
+
+    if (!rb.ReadVarInts(palette, palette_length)) return false;
+
+    for (size_t i = palette_length; i < index_count; ++i) {
+      palette[i] = 0;
+    }
+  } else if (bits_per_entry > kMaxBitsPerEntry) {
+    return false;
+  }
+
+  return ReadDataSpan(rb, &data, &long_count);
+}
+
+bool PalettedContainer::Skip(RingBuffer& rb, PalettedContainerType type) {
+  if (rb.GetReadAmount() < 1) return false;
+
+  u8 min_bits, max_bits;
+  GetIndirectRange(type, &min_bits, &max_bits);
+
+  u8 bits = rb.ReadU8();
+  u32 values[kMaxPaletteSize];
+
+  if (bits == 0) {
+    if (!rb.ReadVarInts(values, 1)) return false;
+  } else if (bits <= max_bits) {
+    u64 length = 0;
+
+    if (!rb.ReadVarInt(&length) || length > kMaxPaletteSize) return false;
+    if (!rb.ReadVarInts(values, (size_t)length)) return false;
+  }
+
+  const u8* data = nullptr;
+  size_t long_count = 0;
+
+  return ReadDataSpan(rb, &data, &long_count);
+}
+
+void PalettedContainer::Unpack(u32* out, size_t count) const {
+  if (bits_per_entry == 0) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = palette[0];
+    }
+    return;
+  }
+
+  g_kernels.unpack[bits_per_entry](data, long_count, out, count);
+
+  if (indirect) {
+    g_kernels.map(out, count, palette);
+  }
+}
+
+void PalettedContainer::UnpackIndices(u32* out, size_t count) const {
+  if (bits_per_entry == 0) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = 0;
+    }
+    return;
+  }
+
+  g_kernels.unpack[bits_per_entry](data, long_count, out, count);
+}
+
+} // namespace world
+} // namespace polymer
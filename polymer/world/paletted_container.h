@@ -0,0 +1,52 @@
+#ifndef POLYMER_WORLD_PALETTED_CONTAINER_H_
+#define POLYMER_WORLD_PALETTED_CONTAINER_H_
+
+#include <polymer/buffer.h>
+#include <polymer/types.h>
+
+namespace polymer {
+namespace world {
+
+enum class PalettedContainerType { Blocks, Biomes };
+
+// A paletted container read from a chunk section. The data array is referenced in place from the packet buffer.
+struct PalettedContainer {
+  constexpr static size_t kBlockCount = 16 * 16 * 16;
+  constexpr static size_t kBiomeCount = 4 * 4 * 4;
+  constexpr static size_t kMaxPaletteSize = 256;
+
+  u8 bits_per_entry;
+  // Set when entries index into the palette. Direct containers store the ids themselves.
+  bool indirect;
+  size_t palette_length;
+  // Padded to the full index range with zeroes so unpacking never has to check indices.
+  u32 palette[kMaxPaletteSize];
+
+  const u8* data;
+  size_t long_count;
+
+  // Reads the container header, palette and data array. The buffer must be mirrored.
+  // Returns false if the container runs past the end of the buffer.
+  bool Read(RingBuffer& rb, PalettedContainerType type);
+
+  // Reads the container and skips past its data without unpacking it.
+  static bool Skip(RingBuffer& rb, PalettedContainerType type);
+
+  inline bool IsSingleValue() const {
+    return bits_per_entry == 0;
+  }
+
+  inline u32 GetSingleValue() const {
+    return palette[0];
+  }
+
+  // Unpacks count ids into out. Entries missing from a short data array are filled with zero.
+  void Unpack(u32* out, size_t count) const;
+  // Same as Unpack, but indirect containers output the palette indices instead of the ids.
+  void UnpackIndices(u32* out, size_t count) const;
+};
+
+} // namespace world
+} // namespace polymer
+
+#endif
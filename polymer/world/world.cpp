@@ -4,8 +4,8 @@ namespace polymer {
 namespace world {
 
 World::World(MemoryArena& trans_arena, render::VulkanRenderer& renderer, asset::AssetSystem& assets,
-             BlockRegistry& block_registry)
-    : trans_arena(trans_arena), renderer(renderer), block_registry(block_registry),
+             BlockRegistry& block_registry, DimensionType& dimension)
+    : trans_arena(trans_arena), renderer(renderer), block_registry(block_registry), dimension(dimension),
       block_mesher(trans_arena, assets, block_registry) {
   for (u32 chunk_z = 0; chunk_z < kChunkCacheSize; ++chunk_z) {
     for (u32 chunk_x = 0; chunk_x < kChunkCacheSize; ++chunk_x) {
@@ -28,80 +28,147 @@ World::World(MemoryArena& trans_arena, render::VulkanRenderer& renderer, asset::
 
 void World::Update(float dt) {}
 
+void World::FreeChunk(Chunk* chunk) {
+  chunk->Release(chunk_storage);
+  chunk_pool.Free(chunk);
+}
+
 void World::OnBlockChange(s32 x, s32 y, s32 z, u32 new_bid) {
-  s32 chunk_x = (s32)floorf(x / 16.0f);
-  s32 chunk_z = (s32)floorf(z / 16.0f);
-  s32 chunk_y = (s32)floorf(y / 16.0f) + 4;
+  u64 record = ((u64)new_bid << 12) | ((u64)(x & 15) << 8) | ((u64)(z & 15) << 4) | (u64)(y & 15);
+
+  // Arithmetic shifts floor negative coordinates to their chunk.
+  OnSectionBlockChanges(x >> 4, y >> 4, z >> 4, &record, 1);
+}
+
+void World::OnSectionBlockChanges(s32 chunk_x, s32 chunk_y, s32 chunk_z, const u64* records, size_t count) {
+  enum BorderFlags { Border_West = 1, Border_East = 2, Border_North = 4, Border_South = 8, Border_Down = 16, Border_Up = 32 };
+
+  // Sections are stored from the bottom of the world at y = -64.
+  s32 section_y = chunk_y + 4;
+
+  if (section_y < 0 || section_y >= (s32)kChunkColumnCount) return;
 
   u32 x_index = GetChunkCacheIndex(chunk_x);
   u32 z_index = GetChunkCacheIndex(chunk_z);
 
   ChunkSection* section = &chunks[z_index][x_index];
+  ChunkSectionInfo* section_info = &chunk_infos[z_index][x_index];
 
-  if (!section->info->loaded || (section->info->x != chunk_x || section->info->z != chunk_z)) return;
+  if (!section_info->loaded || (section_info->x != chunk_x || section_info->z != chunk_z)) return;
 
-  s32 relative_x = x % 16;
-  s32 relative_y = y % 16;
-  s32 relative_z = z % 16;
+  Chunk* chunk = section->chunks[section_y];
+  u32 borders = 0;
+  bool changed = false;
 
-  if (relative_x < 0) {
-    relative_x += 16;
-  }
+  for (size_t i = 0; i < count; ++i) {
+    u64 data = records[i];
 
-  if (relative_y < 0) {
-    relative_y += 16;
-  }
+    u32 new_bid = (u32)(data >> 12);
+    u32 relative_x = (data >> 8) & 0x0F;
+    u32 relative_z = (data >> 4) & 0x0F;
+    u32 relative_y = data & 0x0F;
 
-  if (relative_z < 0) {
-    relative_z += 16;
-  }
+    if (!chunk) {
+      // Missing sections are all air.
+      if (new_bid == 0) continue;
+
+      chunk = chunk_pool.Allocate();
+      if (!chunk) break;
+
+      // Missing sections are drawn as open sky, so the new one starts out that way.
+      if (dimension.flags & DimensionFlag_HasSkylight) {
+        chunk->skylight.type = LightStorageType::Bright;
+      }
+
+      section->chunks[section_y] = chunk;
+      section_info->bitmask |= (1 << section_y);
+    }
 
-  u32 old_bid = 0;
+    size_t index = GetChunkBlockIndex(relative_x, relative_y, relative_z);
 
-  if (section->chunks[chunk_y]) {
-    old_bid = section->chunks[chunk_y]->blocks[relative_y][relative_z][relative_x];
+    u32 old_bid = chunk->GetBlock(index);
+
+    if (old_bid == new_bid) continue;
+
+    chunk->SetBlock(chunk_storage, index, new_bid);
+    changed = true;
+
+    light_engine.OnBlockChange(chunk_x * 16 + relative_x, chunk_y * 16 + relative_y, chunk_z * 16 + relative_z, old_bid,
+                               new_bid);
+
+    borders |= (relative_x == 0 ? Border_West : 0) | (relative_x == 15 ? Border_East : 0);
+    borders |= (relative_z == 0 ? Border_North : 0) | (relative_z == 15 ? Border_South : 0);
+    borders |= (relative_y == 0 ? Border_Down : 0) | (relative_y == 15 ? Border_Up : 0);
   }
 
-  if (new_bid != 0) {
-    ChunkSectionInfo* section_info = &chunk_infos[z_index][x_index];
+  if (!changed) return;
+
+  u32 section_bit = 1 << section_y;
+  u32 column_set = section_bit;
 
-    section_info->bitmask |= (1 << chunk_y);
-    section_info->loaded = true;
+  if ((borders & Border_Down) && section_y > 0) column_set |= section_bit >> 1;
+  if ((borders & Border_Up) && section_y < (s32)kChunkColumnCount - 1) column_set |= section_bit << 1;
 
-    if (!section->chunks[chunk_y]) {
-      section->chunks[chunk_y] = chunk_pool.Allocate();
+  QueueRebuild(chunk_x, chunk_z, column_set);
+
+  if (borders & Border_West) QueueRebuild(chunk_x - 1, chunk_z, section_bit);
+  if (borders & Border_East) QueueRebuild(chunk_x + 1, chunk_z, section_bit);
+  if (borders & Border_North) QueueRebuild(chunk_x, chunk_z - 1, section_bit);
+  if (borders & Border_South) QueueRebuild(chunk_x, chunk_z + 1, section_bit);
+}
+
+void World::OnLightChange(s32 chunk_x, s32 chunk_z, u32 changed_set) {
+  if (changed_set == 0) return;
+
+  constexpr u32 kColumnMask = (1 << kChunkColumnCount) - 1;
+
+  QueueRebuild(chunk_x, chunk_z, (changed_set | (changed_set << 1) | (changed_set >> 1)) & kColumnMask);
+  QueueRebuild(chunk_x - 1, chunk_z, changed_set);
+  QueueRebuild(chunk_x + 1, chunk_z, changed_set);
+  QueueRebuild(chunk_x, chunk_z - 1, changed_set);
+  QueueRebuild(chunk_x, chunk_z + 1, changed_set);
+}
+
+void World::QueueRebuild(s32 chunk_x, s32 chunk_z, u32 dirty_set) {
+  for (size_t i = 0; i < pending_rebuild_count; ++i) {
+    PendingRebuild* rebuild = pending_rebuilds + i;
+
+    if (rebuild->chunk_x == chunk_x && rebuild->chunk_z == chunk_z) {
+      rebuild->dirty_set |= dirty_set;
+      return;
     }
   }
 
-  if (section->chunks[chunk_y]) {
-    section->chunks[chunk_y]->blocks[relative_y][relative_z][relative_x] = (u32)new_bid;
+  if (pending_rebuild_count >= kMaxPendingRebuilds) {
+    ApplyPendingRebuilds();
   }
 
-  EnqueueChunk(chunk_x, chunk_y, chunk_z);
+  pending_rebuilds[pending_rebuild_count++] = {chunk_x, chunk_z, dirty_set};
+}
+
+void World::FlushBlockEdits() {
+  light_engine.Update(*this, dimension.flags & DimensionFlag_HasSkylight);
 
-  if (relative_x == 0) {
-    // Rebuild west
-    EnqueueChunk(chunk_x - 1, chunk_y, chunk_z);
-  } else if (relative_x == 15) {
-    // Rebuild east
-    EnqueueChunk(chunk_x + 1, chunk_y, chunk_z);
-  }
+  ApplyPendingRebuilds();
+}
 
-  if (relative_z == 0) {
-    // Rebuild north
-    EnqueueChunk(chunk_x, chunk_y, chunk_z - 1);
-  } else if (relative_z == 15) {
-    // Rebuild south
-    EnqueueChunk(chunk_x, chunk_y, chunk_z + 1);
-  }
+void World::ApplyPendingRebuilds() {
+  for (size_t i = 0; i < pending_rebuild_count; ++i) {
+    PendingRebuild* rebuild = pending_rebuilds + i;
+
+    u32 x_index = GetChunkCacheIndex(rebuild->chunk_x);
+    u32 z_index = GetChunkCacheIndex(rebuild->chunk_z);
+
+    ChunkSectionInfo* section_info = &chunk_infos[z_index][x_index];
+
+    // Neighbours that aren't loaded get fully rebuilt when they arrive.
+    if (!section_info->loaded || section_info->x != rebuild->chunk_x || section_info->z != rebuild->chunk_z) continue;
 
-  if (relative_y == 0 && chunk_y > 0) {
-    // Rebuild below
-    EnqueueChunk(chunk_x, chunk_y - 1, chunk_z);
-  } else if (relative_y == 15 && chunk_y < 15) {
-    // Rebuild above
-    EnqueueChunk(chunk_x, chunk_y + 1, chunk_z);
+    section_info->dirty_mesh_set |= rebuild->dirty_set;
+    section_info->dirty_connectivity_set |= rebuild->dirty_set;
   }
+
+  pending_rebuild_count = 0;
 }
 
 void World::OnChunkLoad(s32 chunk_x, s32 chunk_z) {
@@ -113,7 +180,6 @@ void World::OnChunkLoad(s32 chunk_x, s32 chunk_z) {
 
   if (section_info->loaded) {
     printf("Got chunk %d, %d with existing chunk %d, %d.\n", chunk_x, chunk_z, section_info->x, section_info->z);
-    renderer.WaitForIdle();
 
     // Force clear any existing meshes
     for (s32 chunk_y = 0; chunk_y < kChunkColumnCount; ++chunk_y) {
@@ -131,6 +197,8 @@ void World::OnChunkLoad(s32 chunk_x, s32 chunk_z) {
   section_info->loaded = true;
   section_info->x = chunk_x;
   section_info->z = chunk_z;
+  section_info->meshing_set = 0;
+  ++section_info->generation;
 
   section_info->dirty_connectivity_set = 0xFFFFFF;
   section_info->dirty_mesh_set = 0xFFFFFF;
@@ -152,18 +220,18 @@ void World::OnChunkUnload(s32 chunk_x, s32 chunk_z) {
   section_info->bitmask = 0;
   section_info->dirty_connectivity_set = 0xFFFFFF;
   section_info->dirty_mesh_set = 0;
+  section_info->meshing_set = 0;
+  ++section_info->generation;
 
   for (s32 chunk_y = 0; chunk_y < kChunkColumnCount; ++chunk_y) {
     if (section->chunks[chunk_y]) {
-      chunk_pool.Free(section->chunks[chunk_y]);
+      FreeChunk(section->chunks[chunk_y]);
       section->chunks[chunk_y] = nullptr;
     }
   }
 
   ChunkMesh* meshes = this->meshes[z_index][x_index];
 
-  renderer.WaitForIdle();
-
   for (s32 chunk_y = 0; chunk_y < kChunkColumnCount; ++chunk_y) {
     for (s32 i = 0; i < render::kRenderLayerCount; ++i) {
       if (meshes[chunk_y].meshes[i].vertex_count > 0) {
@@ -175,7 +243,9 @@ void World::OnChunkUnload(s32 chunk_x, s32 chunk_z) {
 }
 
 void World::OnDimensionChange() {
-  renderer.WaitForIdle();
+  // Queued edits belong to the old dimension.
+  light_engine.pending_edit_count = 0;
+  pending_rebuild_count = 0;
 
   for (s32 chunk_z = 0; chunk_z < kChunkCacheSize; ++chunk_z) {
     for (s32 chunk_x = 0; chunk_x < kChunkCacheSize; ++chunk_x) {
@@ -185,7 +255,9 @@ void World::OnDimensionChange() {
       section_info->loaded = false;
       section_info->dirty_connectivity_set = 0xFFFFFF;
       section_info->dirty_mesh_set = 0;
+      section_info->meshing_set = 0;
       section_info->bitmask = 0;
+      ++section_info->generation;
 
       for (s32 chunk_y = 0; chunk_y < kChunkColumnCount; ++chunk_y) {
         ChunkMesh* mesh = meshes + chunk_y;
@@ -206,13 +278,47 @@ void World::BuildChunkMesh(render::ChunkBuildContext* ctx, s32 chunk_x, s32 chun
 
   render::ChunkVertexData vertex_data = block_mesher.CreateMesh(ctx, chunk_y);
 
-  ChunkMesh* meshes = this->meshes[ctx->z_index][ctx->x_index];
+  UploadChunkMesh(&this->meshes[ctx->z_index][ctx->x_index][chunk_y], vertex_data);
+
+  block_mesher.Reset();
+}
+
+bool World::QueueChunkMesh(render::ChunkBuildContext* ctx, s32 chunk_y) {
+  ChunkSectionInfo* section_info = &chunk_infos[ctx->z_index][ctx->x_index];
 
+  if (!mesh_pipeline.Submit(ctx, chunk_y, section_info->generation)) return false;
+
+  section_info->dirty_mesh_set &= ~(1 << chunk_y);
+  section_info->meshing_set |= (1 << chunk_y);
+
+  return true;
+}
+
+bool World::ApplyChunkMesh() {
+  render::MeshResult* result = mesh_pipeline.PopResult();
+  if (!result) return false;
+
+  u32 x_index = GetChunkCacheIndex(result->chunk_x);
+  u32 z_index = GetChunkCacheIndex(result->chunk_z);
+  ChunkSectionInfo* section_info = &chunk_infos[z_index][x_index];
+
+  // The column was unloaded or replaced while this was being meshed.
+  if (section_info->loaded && section_info->generation == result->generation) {
+    UploadChunkMesh(&meshes[z_index][x_index][result->chunk_y], result->vertex_data);
+
+    section_info->meshing_set &= ~(1 << result->chunk_y);
+  }
+
+  mesh_pipeline.Release(result);
+
+  return true;
+}
+
+void World::UploadChunkMesh(ChunkMesh* mesh, const render::ChunkVertexData& vertex_data) {
   for (s32 i = 0; i < render::kRenderLayerCount; ++i) {
-    if (meshes[chunk_y].meshes[i].vertex_count > 0) {
-      renderer.WaitForIdle();
-      renderer.FreeMesh(&meshes[chunk_y].meshes[i]);
-      meshes[chunk_y].meshes[i].vertex_count = 0;
+    if (mesh->meshes[i].vertex_count > 0) {
+      renderer.FreeMesh(&mesh->meshes[i]);
+      mesh->meshes[i].vertex_count = 0;
     }
 
     if (vertex_data.vertex_count[i] > 0) {
@@ -220,13 +326,10 @@ void World::BuildChunkMesh(render::ChunkBuildContext* ctx, s32 chunk_x, s32 chun
 
       const size_t data_size = sizeof(render::ChunkVertex) * vertex_data.vertex_count[i];
 
-      meshes[chunk_y].meshes[i].vertex_count = (u32)vertex_data.vertex_count[i];
-      meshes[chunk_y].meshes[i] = renderer.AllocateMesh(vertex_data.vertices[i], data_size, vertex_data.vertex_count[i],
-                                                        vertex_data.indices[i], vertex_data.index_count[i]);
+      mesh->meshes[i] = renderer.AllocateMesh(vertex_data.vertices[i], data_size, vertex_data.vertex_count[i],
+                                              vertex_data.indices[i], vertex_data.index_count[i]);
     }
   }
-
-  block_mesher.Reset();
 }
 
 void World::EnqueueChunk(s32 chunk_x, s32 chunk_y, s32 chunk_z) {
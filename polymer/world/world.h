@@ -4,14 +4,27 @@
 #include <polymer/memory.h>
 #include <polymer/render/block_mesher.h>
 #include <polymer/render/chunk_renderer.h>
+#include <polymer/render/mesh_pipeline.h>
+#include <polymer/render/mesh_scheduler.h>
 #include <polymer/render/render.h>
 #include <polymer/types.h>
 #include <polymer/world/chunk.h>
+#include <polymer/world/dimension.h>
+#include <polymer/world/light_engine.h>
 
 namespace polymer {
 namespace world {
 
 struct World {
+  // Columns that block edits need rebuilt, collected until FlushBlockEdits.
+  struct PendingRebuild {
+    s32 chunk_x;
+    s32 chunk_z;
+    u32 dirty_set;
+  };
+
+  constexpr static size_t kMaxPendingRebuilds = 64;
+
   // Store the chunk data separately to make render iteration faster
   ChunkSection chunks[kChunkCacheSize][kChunkCacheSize];
   ChunkSectionInfo chunk_infos[kChunkCacheSize][kChunkCacheSize];
@@ -19,16 +32,24 @@ struct World {
   ChunkConnectivityGraph connectivity_graph;
 
   BlockRegistry& block_registry;
+  DimensionType& dimension;
   MemoryPool<Chunk> chunk_pool;
+  ChunkStorageAllocator chunk_storage;
   render::BlockMesher block_mesher;
+  render::MeshPipeline mesh_pipeline;
+  render::MeshScheduler mesh_scheduler;
+  LightEngine light_engine;
 
   MemoryArena& trans_arena;
   render::VulkanRenderer& renderer;
 
   u32 world_tick = 0;
 
+  PendingRebuild pending_rebuilds[kMaxPendingRebuilds];
+  size_t pending_rebuild_count = 0;
+
   World(MemoryArena& trans_arena, render::VulkanRenderer& renderer, asset::AssetSystem& assets,
-        BlockRegistry& block_registry);
+        BlockRegistry& block_registry, DimensionType& dimension);
 
   inline float GetCelestialAngle() const {
     float result = (((s32)world_tick - 6000) % 24000) / 24000.0f;
@@ -50,15 +71,39 @@ struct World {
 
   void Update(float dt);
 
+  // Frees the chunk along with its block and light storage.
+  void FreeChunk(Chunk* chunk);
+
   void OnDimensionChange();
+  // Block edits change the blocks right away, but the sections they dirty are only marked for rebuilding by
+  // FlushBlockEdits, so each section and neighbour is marked once no matter how many of its blocks changed.
+  // Edits that change light are relit by the light engine during the flush.
   void OnBlockChange(s32 x, s32 y, s32 z, u32 new_bid);
+  // Applies count records to one section. Records are packed like UpdateSectionBlocks, with the block id above the
+  // low 12 bits and x, z, y in the low 12 bits from high to low.
+  void OnSectionBlockChanges(s32 chunk_x, s32 chunk_y, s32 chunk_z, const u64* records, size_t count);
+  void FlushBlockEdits();
+  // Queues the sections whose light changed and the neighbours that sample light across their borders.
+  void OnLightChange(s32 chunk_x, s32 chunk_z, u32 changed_set);
   void OnChunkLoad(s32 chunk_x, s32 chunk_z);
   void OnChunkUnload(s32 chunk_x, s32 chunk_z);
 
   void BuildChunkMesh(render::ChunkBuildContext* ctx);
   void BuildChunkMesh(render::ChunkBuildContext* ctx, s32 chunk_x, s32 chunk_y, s32 chunk_z);
+  // Snapshots a dirty section and submits it to the mesh pipeline. Returns false if the pipeline is full.
+  bool QueueChunkMesh(render::ChunkBuildContext* ctx, s32 chunk_y);
+  // Uploads the next mesh that the pipeline has finished. Returns false once there are none left.
+  // Must be called between Begin and EndMeshAllocation.
+  bool ApplyChunkMesh();
   void EnqueueChunk(s32 chunk_x, s32 chunk_y, s32 chunk_z);
+  // Marks sections in a column to be rebuilt on the next FlushBlockEdits.
+  void QueueRebuild(s32 chunk_x, s32 chunk_z, u32 dirty_set);
+  // Marks the queued sections dirty without running the light engine.
+  void ApplyPendingRebuilds();
   void FreeMeshes();
+
+private:
+  void UploadChunkMesh(ChunkMesh* mesh, const render::ChunkVertexData& vertex_data);
 };
 
 } // namespace world
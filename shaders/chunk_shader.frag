@@ -16,6 +16,9 @@ layout(location = 1) flat in uint fragTexId;
 layout(location = 2) in vec4 fragColorMod;
 layout(location = 3) flat in uint fragTexIdInterpolate;
 layout(location = 4) flat in float interpolate_t;
+// Bit 0 is set for tiled faces and bit 1 is set when their texture is randomized per block.
+layout(location = 5) flat in uint fragTileInfo;
+layout(location = 6) flat in uint fragTileSeed;
 
 layout(location = 0) out vec4 outColor;
 
@@ -39,10 +42,42 @@ vec3 hsv2rgb(vec3 c) {
 const float saturation = 1.0;
 const float brightness = 1.0;
 
+uint Hash(uint x) {
+  x ^= x >> 16;
+  x *= 0x7FEB352Du;
+  x ^= x >> 15;
+  x *= 0x846CA68Bu;
+  x ^= x >> 16;
+  return x;
+}
+
 void main() {
-  vec4 diffuse = texture(texSampler, vec3(fragTexCoord, fragTexId));
+  // Take the gradients before wrapping so the mip level doesn't jump at the block edges of tiled faces.
+  vec2 uv = fragTexCoord;
+  vec2 uv_dx = dFdx(fragTexCoord);
+  vec2 uv_dy = dFdy(fragTexCoord);
+
+  if ((fragTileInfo & 1) != 0) {
+    uv = fract(fragTexCoord);
+
+    if ((fragTileInfo & 2) != 0) {
+      // Offset and flip the texture per block the same way the mesher does for single faces.
+      ivec2 tile = ivec2(floor(fragTexCoord)) + 32;
+      uint h = Hash(fragTileSeed ^ Hash(uint(tile.x) | (uint(tile.y) << 8)));
+
+      uv += vec2(float(h & 15), float((h >> 4) & 15)) / 16.0;
+
+      if ((h & 0x100) != 0) {
+        uv.x = 2.0 - uv.x;
+      } else {
+        uv.y = 2.0 - uv.y;
+      }
+    }
+  }
+
+  vec4 diffuse = textureGrad(texSampler, vec3(uv, fragTexId), uv_dx, uv_dy);
   if (fragTexIdInterpolate != 0xFFFFFFFF) {
-    vec4 next_diffuse = texture(texSampler, vec3(fragTexCoord, fragTexIdInterpolate));
+    vec4 next_diffuse = textureGrad(texSampler, vec3(uv, fragTexIdInterpolate), uv_dx, uv_dy);
     diffuse = mix(diffuse, next_diffuse, interpolate_t);
   }
   
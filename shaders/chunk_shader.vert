@@ -7,25 +7,35 @@ layout(binding = 0) uniform UniformBufferObject {
   float anim_time;
   float sunlight;
   uint alpha_discard;
+  // frame count 8 | frametime 15 | interpolated 1
+  uvec4 animations[16];
 } ubo;
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in uint inTexId;
-layout(location = 2) in uint inPackedLight;
-layout(location = 3) in uint inTexCoord;
-layout(location = 4) in uint inFrametime;
+layout(push_constant) uniform PushConstants {
+  vec4 section_offset;
+  uint section_seed;
+} push;
+
+// xyz is the section relative position in 1/2048 block units biased by 8 blocks, w is the packed light.
+layout(location = 0) in uvec4 inPositionLight;
+// texture id 12 | uv 5+5 | tiled 1 | animation index 6 | tint 3
+// Tiled faces store their direction and whether they are randomized in the uv bits.
+layout(location = 1) in uint inPackedTexture;
 
 layout(location = 0) out vec2 fragTexCoord;
 layout(location = 1) flat out uint fragTexId;
 layout(location = 2) out vec4 fragColorMod;
 layout(location = 3) flat out uint fragTexIdInterpolate;
 layout(location = 4) flat out float interpolate_t;
+layout(location = 5) flat out uint fragTileInfo;
+layout(location = 6) flat out uint fragTileSeed;
 
 #define GRASS_TINTINDEX 0
 #define LEAF_TINTINDEX 1
 #define SPRUCE_LEAF_TINTINDEX 2
 #define BIRCH_LEAF_TINTINDEX 3
-#define WATER_TINTINDEX 50
+#define WATER_TINTINDEX 4
+#define PLAIN_TINTINDEX 5
 
 #define WATER_TINT vec4(0.247, 0.463, 0.894, 1.0)
 
@@ -42,15 +52,72 @@ layout(location = 4) flat out float interpolate_t;
 #define SPRUCE_LEAF_TINT vec4(0.380, 0.600, 0.380, 1.0)
 #define BIRCH_LEAF_TINT vec4(0.502, 0.655, 0.333, 1.0)
 
+#define FACE_DOWN 0
+#define FACE_UP 1
+#define FACE_NORTH 2
+#define FACE_SOUTH 3
+#define FACE_WEST 4
+#define FACE_EAST 5
+
+uint Hash(uint x) {
+  x ^= x >> 16;
+  x *= 0x7FEB352Du;
+  x ^= x >> 15;
+  x *= 0x846CA68Bu;
+  x ^= x >> 16;
+  return x;
+}
+
 void main() {
-  uint animCount = inPackedLight >> 24;
-  
-  gl_Position = ubo.mvp * vec4(inPosition - ubo.camera.xyz, 1.0);
+  vec3 local = vec3(inPositionLight.xyz) / 2048.0 - 8.0;
+  vec3 position = push.section_offset.xyz + local;
+  uint inPackedLight = inPositionLight.w;
+
+  uint inTexId = inPackedTexture & 0xFFF;
+  uint inTexCoord = (inPackedTexture >> 12) & 0x3FF;
+  uint tiled = (inPackedTexture >> 22) & 1;
+  uint animIndex = (inPackedTexture >> 23) & 0x3F;
+  uint animation = ubo.animations[animIndex >> 2][animIndex & 3];
+  uint animCount = animation & 0xFF;
+
+  gl_Position = ubo.mvp * vec4(position, 1.0);
   fragTexCoord.x = (inTexCoord >> 5) / 16.0;
   fragTexCoord.y = (inTexCoord & 0x1F) / 16.0;
+  fragTileInfo = 0;
+  fragTileSeed = 0;
+
+  if (tiled != 0) {
+    // Use the position on the face's plane in blocks so the texture repeats once per block.
+    // These match the uvs of a full cube face.
+    uint direction = inTexCoord & 7;
+    float plane = 0.0;
+
+    if (direction == FACE_DOWN) {
+      fragTexCoord = vec2(local.x, -local.z);
+      plane = local.y;
+    } else if (direction == FACE_UP) {
+      fragTexCoord = vec2(local.x, local.z);
+      plane = local.y;
+    } else if (direction == FACE_NORTH) {
+      fragTexCoord = vec2(-local.x, -local.y);
+      plane = local.z;
+    } else if (direction == FACE_SOUTH) {
+      fragTexCoord = vec2(local.x, -local.y);
+      plane = local.z;
+    } else if (direction == FACE_WEST) {
+      fragTexCoord = vec2(local.z, -local.y);
+      plane = local.x;
+    } else {
+      fragTexCoord = vec2(-local.z, -local.y);
+      plane = local.x;
+    }
+
+    fragTileInfo = 1 | (((inTexCoord >> 3) & 1) << 1);
+    fragTileSeed = Hash(push.section_seed ^ Hash(direction | (uint(int(round(plane)) + 8) << 3)));
+  }
 
-  uint frametime = inFrametime & 0x7FFF;
-  uint interpolated = inFrametime >> 15;
+  uint frametime = (animation >> 8) & 0x7FFF;
+  uint interpolated = (animation >> 23) & 1;
 
   float frame_t = ubo.anim_time * (24.0f / frametime);
   uint frame = uint(frame_t) % animCount;
@@ -67,7 +134,7 @@ void main() {
   }
 
   // TODO: Remove this and sample biome from foliage/grass png
-  uint tintindex = (inPackedLight >> 16) & 0x7F;
+  uint tintindex = inPackedTexture >> 29;
   uint ao = inPackedLight & 3;
   
   uint skylight_value = (inPackedLight >> 2) & 0x3F;
@@ -86,7 +153,7 @@ void main() {
   }
 
   // Convert back down into correct brightness
-  if (tintindex <= WATER_TINTINDEX) {
+  if (tintindex <= PLAIN_TINTINDEX) {
     fragColorMod.rgb *= (1.0 / 0.9);
   }
 
@@ -99,7 +166,7 @@ void main() {
 
   // Vary shading of vertical faces by difference between camera and the vertex.
   if (vertical_face > 0) {
-      float height_difference = (ubo.camera.y - inPosition.y);
+      float height_difference = -position.y;
       float shading_modifier = max((abs(height_difference) / 15.0), 1.0);
       light_intensity *= max(1.0 - shading_modifier, 0.8);
   }